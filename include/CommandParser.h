@@ -0,0 +1,75 @@
+#ifndef COMMANDPARSER_H
+#define COMMANDPARSER_H
+
+#include <stdint.h>
+
+#ifndef COMMAND_MAX_LEN
+#define COMMAND_MAX_LEN 255
+#endif
+
+// a frame that stalls longer than this is discarded
+#ifndef COMMAND_TIMEOUT_MS
+#define COMMAND_TIMEOUT_MS 100
+#endif
+
+/*
+ * Length-prefixed command frames:
+ *
+ *   Length (1 byte, 1-255), Command, Parameters (Length - 1 bytes)
+ *
+ * Bytes are fed one at a time together with the current time in ms;
+ * feed() returns true when a full frame is in data()/length(). A frame
+ * that stops arriving for COMMAND_TIMEOUT_MS is dropped so the parser
+ * resynchronises on the next length byte. A zero length byte is ignored.
+ */
+class CommandParser
+{
+public:
+    CommandParser() : expected_(0), pos_(0), lastByte_(0), timeouts_(0) {}
+
+    bool feed(uint8_t b, uint32_t now)
+    {
+        if (expected_ != 0 && (now - lastByte_) > COMMAND_TIMEOUT_MS)
+        {
+            expected_ = 0;
+            timeouts_++;
+        }
+        lastByte_ = now;
+
+        if (expected_ == 0)
+        {
+            expected_ = b;
+            pos_ = 0;
+            return false;
+        }
+
+        buffer_[pos_++] = b;
+        if (pos_ < expected_)
+        {
+            return false;
+        }
+        expected_ = 0;
+        return true;
+    }
+
+    void reset()
+    {
+        expected_ = 0;
+        pos_ = 0;
+    }
+
+    const uint8_t *data() const { return buffer_; }
+    uint8_t length() const { return pos_; }
+
+    // frames dropped because they stalled
+    uint32_t timeouts() const { return timeouts_; }
+
+private:
+    uint8_t buffer_[COMMAND_MAX_LEN];
+    uint8_t expected_;
+    uint8_t pos_;
+    uint32_t lastByte_;
+    uint32_t timeouts_;
+};
+
+#endif /* COMMANDPARSER_H */
@@ -0,0 +1,29 @@
+#ifndef __CYCLE_COUNTER_H
+#define __CYCLE_COUNTER_H
+
+#include <stdint.h>
+
+/*
+ * DWT cycle counter of the Cortex-M3 debug unit, by address: the SPL's
+ * CMSIS core_cm3.h has no DWT block. CYCCNT counts core clocks and wraps
+ * after 59 s at 72 MHz. Shared by the MIFARE dump statistics and the
+ * PN5180 profiler (PN5180Profile.h).
+ */
+#define DEMCR                 (*(volatile uint32_t *)0xE000EDFC)
+#define DEMCR_TRCENA          (1UL << 24)
+#define DWT_CTRL              (*(volatile uint32_t *)0xE0001000)
+#define DWT_CTRL_CYCCNTENA    (1UL << 0)
+#define DWT_CYCCNT            (*(volatile uint32_t *)0xE0001004)
+
+// starts CYCCNT from 0 unless it already runs, so other users keep their spans
+static inline void CycleCounterStart(void)
+{
+    if (!(DWT_CTRL & DWT_CTRL_CYCCNTENA))
+    {
+        DEMCR |= DEMCR_TRCENA;
+        DWT_CYCCNT = 0;
+        DWT_CTRL |= DWT_CTRL_CYCCNTENA;
+    }
+}
+
+#endif
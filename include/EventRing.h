@@ -0,0 +1,147 @@
+#ifndef EVENTRING_H
+#define EVENTRING_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <atomic>
+#include "Uid.h"
+
+/*
+ * Lock-free single-producer / single-consumer ring.
+ *
+ * The producer (an ISR, or a thread on the host) only ever writes head_,
+ * the consumer (the main loop) only ever writes tail_. Both indices run
+ * freely and are masked on access, so a full ring holds exactly N items
+ * and no slot is wasted. Nothing here disables interrupts.
+ *
+ * EVENTRING_ALIGN keeps the two indices apart: the F103 has no data cache,
+ * so word alignment is enough there; on the host each index gets its own
+ * cache line to avoid false sharing between the two threads.
+ */
+#ifndef EVENTRING_ALIGN
+#if defined(__arm__)
+#define EVENTRING_ALIGN 4
+#else
+#define EVENTRING_ALIGN 64
+#endif
+#endif
+
+template <typename T, uint32_t N>
+class SpscRing
+{
+    static_assert(N >= 2 && (N & (N - 1)) == 0, "SpscRing capacity must be a power of two");
+
+public:
+    SpscRing() : head_(0), overflows_(0), highWater_(0), tail_(0) {}
+
+    SpscRing(const SpscRing &) = delete;
+    SpscRing &operator=(const SpscRing &) = delete;
+
+    static constexpr uint32_t capacity() { return N; }
+
+    /*
+     * producer side: returns false and counts an overflow when the ring is full
+     */
+    bool push(const T &item)
+    {
+        uint32_t head = head_.load(std::memory_order_relaxed);
+        uint32_t used = head - tail_.load(std::memory_order_acquire);
+        if (used >= N)
+        {
+            overflows_.store(overflows_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+            return false;
+        }
+        buffer_[head & (N - 1)] = item;
+        head_.store(head + 1, std::memory_order_release);
+        if (used + 1 > highWater_.load(std::memory_order_relaxed))
+        {
+            highWater_.store(used + 1, std::memory_order_relaxed);
+        }
+        return true;
+    }
+
+    /*
+     * consumer side: returns false when the ring is empty
+     */
+    bool pop(T &item)
+    {
+        uint32_t tail = tail_.load(std::memory_order_relaxed);
+        if (tail == head_.load(std::memory_order_acquire))
+        {
+            return false;
+        }
+        item = buffer_[tail & (N - 1)];
+        tail_.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    // consumer side: drop everything currently queued
+    void clear()
+    {
+        tail_.store(head_.load(std::memory_order_acquire), std::memory_order_release);
+    }
+
+    uint32_t size() const
+    {
+        return head_.load(std::memory_order_acquire) - tail_.load(std::memory_order_acquire);
+    }
+
+    bool empty() const
+    {
+        return size() == 0;
+    }
+
+    // pushes rejected because the ring was full
+    uint32_t overflows() const
+    {
+        return overflows_.load(std::memory_order_relaxed);
+    }
+
+    // largest fill level seen since construction
+    uint32_t highWater() const
+    {
+        return highWater_.load(std::memory_order_relaxed);
+    }
+
+private:
+    alignas(EVENTRING_ALIGN) std::atomic<uint32_t> head_; // written by producer only
+    std::atomic<uint32_t> overflows_;                     // written by producer only
+    std::atomic<uint32_t> highWater_;                     // written by producer only
+    alignas(EVENTRING_ALIGN) std::atomic<uint32_t> tail_; // written by consumer only
+    alignas(EVENTRING_ALIGN) T buffer_[N];
+};
+
+/*
+ * Reader events handed from interrupt context to the main loop
+ */
+enum ReaderEventType : uint8_t
+{
+    READER_EV_TAG_SEEN = 1,  // uid valid
+    READER_EV_READ_DONE = 2, // uid, code=block number, value=block data
+    READER_EV_ERROR = 3,     // code=error code of the failing layer
+    READER_EV_SPI_DONE = 4   // value=number of bytes transferred
+};
+
+struct ReaderEvent
+{
+    uint32_t timestamp; // micros() when the event was posted
+    uint8_t type;       // ReaderEventType
+    uint8_t code;
+    uint16_t reserved;
+    uint32_t value;
+    Uid uid;
+};
+
+/*
+ * Driver trace records (PN5180Debug.h), 12 bytes each
+ */
+struct PN5180TraceRecord
+{
+    uint32_t timestamp; // micros()
+    uint8_t event;      // PN5180TraceEvent
+    uint8_t arg;
+    uint16_t length;
+    uint32_t value;
+};
+
+#endif /* EVENTRING_H */
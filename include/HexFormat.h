@@ -0,0 +1,102 @@
+#ifndef HEXFORMAT_H
+#define HEXFORMAT_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+/*
+ * Hex formatting into caller buffers.
+ *
+ * Each byte is one lookup in a 512-character table of digit pairs and a
+ * two-byte copy, so a whole buffer is encoded in one pass with no sprintf
+ * and no shared static state: every function here is reentrant.
+ *
+ * Like ReportProtocol.h the encoders only depend on the C library, so host
+ * tools can use them too; hexDump below needs a Print sink.
+ */
+
+// characters hexEncode writes for len bytes, without the terminator
+#define HEX_ENCODED_LEN(len, sep) ((size_t)(len) * ((sep) ? 3 : 2))
+
+#define HEX_PAIR_ROW(h)                                                        \
+    h "0" h "1" h "2" h "3" h "4" h "5" h "6" h "7"                            \
+    h "8" h "9" h "A" h "B" h "C" h "D" h "E" h "F"
+
+// "000102...FF": the digits of byte b are at 2 * b
+inline const char *hexPairTable()
+{
+    static const char pairs[] =
+        HEX_PAIR_ROW("0") HEX_PAIR_ROW("1") HEX_PAIR_ROW("2") HEX_PAIR_ROW("3")
+        HEX_PAIR_ROW("4") HEX_PAIR_ROW("5") HEX_PAIR_ROW("6") HEX_PAIR_ROW("7")
+        HEX_PAIR_ROW("8") HEX_PAIR_ROW("9") HEX_PAIR_ROW("A") HEX_PAIR_ROW("B")
+        HEX_PAIR_ROW("C") HEX_PAIR_ROW("D") HEX_PAIR_ROW("E") HEX_PAIR_ROW("F");
+    return pairs;
+}
+
+/*
+ * Two uppercase digits per byte, each followed by sep unless sep is 0
+ * ("%02X " for sep ' '). out must hold HEX_ENCODED_LEN(len, sep) + 1
+ * chars; it is NUL terminated. Returns the characters written, without
+ * the terminator.
+ */
+inline size_t hexEncode(char *out, const uint8_t *data, size_t len, char sep = 0)
+{
+    const char *pairs = hexPairTable();
+    char *p = out;
+    for (size_t i = 0; i < len; i++)
+    {
+        memcpy(p, pairs + 2 * data[i], 2);
+        p += 2;
+        if (sep)
+        {
+            *p++ = sep;
+        }
+    }
+    *p = '\0';
+    return p - out;
+}
+
+/*
+ * The low `digits` (1..8) hex digits of val, most significant first, NUL
+ * terminated: hexEncodeWord(out, 0x1234, 4) gives "1234".
+ */
+inline size_t hexEncodeWord(char *out, uint32_t val, uint8_t digits)
+{
+    const char *pairs = hexPairTable();
+    size_t len = digits;
+    char *p = out + digits;
+    *p = '\0';
+    while (digits >= 2)
+    {
+        p -= 2;
+        memcpy(p, pairs + 2 * (val & 0xff), 2);
+        val >>= 8;
+        digits -= 2;
+    }
+    if (digits)
+    {
+        *--p = pairs[2 * (val & 0x0f) + 1];
+    }
+    return len;
+}
+
+#ifdef ARDUINO
+#include <Arduino.h>
+
+// bytes encoded per write in hexDump: 64 bytes are one 192-char write
+#define HEX_DUMP_CHUNK 64
+
+/*
+ * Hex dump of data to out, sep after every byte. Encodes HEX_DUMP_CHUNK
+ * bytes at a time into a stack buffer: a 512-byte receive buffer is
+ * eight writes. The writes are one message (reportBeginMessage), so on
+ * uartTx a dump that does not fit the free space is dropped and counted
+ * as a whole, and one larger than the whole ring waits for the DMA
+ * instead; other sinks get every write. Returns the characters written,
+ * 0 when the dump was dropped.
+ */
+size_t hexDump(Print &out, const uint8_t *data, size_t len, char sep = ' ');
+#endif
+
+#endif /* HEXFORMAT_H */
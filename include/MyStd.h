@@ -1,34 +1,42 @@
 #pragma once
 
 #include <Arduino.h>
+#include "StaticContainers.h"
+#include "Uid.h"
+
+/*
+ * The reader's containers, all built on the fixed-capacity templates in
+ * StaticContainers.h: no heap, capacity fixed at compile time.
+ */
+
+#define CARDS_CAPACITY 100
+
 class Cards {
 
 public:
-    int64_t array[100];
-    int size = 0;
-
     int length() {
-        return size;
+        return cards_.size();
     }
 
-    void insert(const int64_t& data) {
-        array[size] = data;
-        size++;
+    // false if all CARDS_CAPACITY entries are in use
+    bool insert(const int64_t& data) {
+        return cards_.push_back(data);
     }
 
     void clear() {
-        size=0;
+        cards_.clear();
     }
 
     int64_t get(int index){
-        return array[index];
+        return cards_[index];
     }
 
     int64_t& operator[](int index){
-        return array[index];
+        return cards_[index];
     }
 
-    //insert()
+private:
+    StaticVector<int64_t, CARDS_CAPACITY> cards_;
 };
 /*
 UidVec a;
@@ -40,158 +48,146 @@ a.clear();
 
 
  */
-struct SearchData
-{
-    SearchData(int64_t mask_value, uint8_t position, uint8_t current_bit_value) : mask(mask_value), position(position), current_bit_value(current_bit_value) {}
-    SearchData() : mask(0), position(0), current_bit_value(0) {}
-    int64_t mask = 0;
-    uint8_t position = 0;
-    uint8_t current_bit_value = 0;
-};
-
-class MyStack
+/*
+ * Stack with compile-time capacity, stored inline (no heap).
+ * push on a full stack and pop on an empty one fail and return false.
+ */
+template <typename T, int N>
+class StaticStack
 {
 public:
-    MyStack(int Size)
-    {
-        m_iSize = Size;
-        m_pBuffer = new SearchData[Size];
-        m_iTop = 0;
-    }
-    ~MyStack()
+    static constexpr int capacity()
     {
-        delete[] m_pBuffer;
-        m_pBuffer = NULL;
+        return N;
     }
-    bool empty()
+
+    bool empty() const
     {
-        if (0 == m_iTop)
-        {
-            return true;
-        }
-        return false;
+        return stack_.empty();
     }
-    bool isFull()
+
+    bool isFull() const
     {
-        if (m_iTop == m_iSize)
-        {
-            return true;
-        }
-        return false;
+        return stack_.full();
     }
+
     void clear()
     {
-        m_iTop = 0;
+        stack_.clear();
     }
 
-    int size()
+    int size() const
     {
-        return m_iTop;
+        return stack_.size();
     }
-    bool push(const SearchData& elem)
+
+    bool push(const T &elem)
     {
-        if (isFull())
-        {
-            return false;
-        }
-        if(m_iTop<0)return false;
-        m_pBuffer[m_iTop].current_bit_value = elem.current_bit_value;
-        m_pBuffer[m_iTop].mask = elem.mask;
-        m_pBuffer[m_iTop].position = elem.position;
-        m_iTop++;
-        return true;
+        return stack_.push_back(elem);
     }
-    bool pop(SearchData &elem)
+
+    bool pop(T &elem)
     {
-        if (empty())
+        if (stack_.empty())
         {
             return false;
         }
-        m_iTop--;
-        elem.current_bit_value = m_pBuffer[m_iTop].current_bit_value;
-        elem.mask = m_pBuffer[m_iTop].mask;
-        elem.position = m_pBuffer[m_iTop].position;
+        elem = stack_.back();
+        stack_.pop_back();
         return true;
     }
 
 private:
-    SearchData *m_pBuffer; //栈空间指针
-    int m_iSize;           //栈容量
-    int m_iTop;            //栈顶，栈中元素个数
+    StaticVector<T, N> stack_;
 };
 
-class UidVec
+/*
+ * One pending branch of the ISO15693 anticollision tree: the mask found so
+ * far and the bit position/value still to try. Position (0-63) and value
+ * share one byte, so a node is 9 bytes instead of a padded 16.
+ */
+struct __attribute__((packed)) SearchNode
 {
+    SearchNode() : mask(0), posbit(0) {}
+    SearchNode(uint64_t mask_value, uint8_t position, uint8_t bit_value)
+        : mask(mask_value), posbit((position & 0x3f) | (bit_value ? 0x80 : 0)) {}
+
+    uint8_t position() const { return posbit & 0x3f; }
+    uint8_t bit() const { return posbit >> 7; }
 
+    uint64_t mask;
+    uint8_t posbit;
+};
+
+/*
+ * Depth-first search over the 64-bit UID space: popping the 0-branch at
+ * position p pushes its 1-sibling and at most one child at p + 1 < 64, so
+ * the stack never holds more than one sibling per level: 64 entries.
+ */
+#define ISO15693_UID_BITS 64
+
+typedef StaticStack<SearchNode, ISO15693_UID_BITS> SearchStack;
+
+/*
+ * Fixed-capacity set of UIDs, statically sized.
+ *
+ * A FixedHashMap without values: UIDs are kept in insertion order, so
+ * operator[] iterates them in the order they were found, and insert and
+ * contains are O(1) hash lookups instead of a scan over all UIDs found so
+ * far.
+ */
+template <int Capacity>
+class UidHashSet
+{
 public:
-    UidVec()
+    UidHashSet()
     {
-        data_ = new int64_t[100];
-        memset(data_, 0, sizeof(int64_t)*100);
-        cnt_ = 0;
     }
 
-    ~UidVec(){
-        delete[] data_;
-    }
-
-    UidVec(const UidVec&) = delete;
+    UidHashSet(const UidHashSet&) = delete;
 
-    UidVec& operator=(const UidVec&) = delete;
+    UidHashSet& operator=(const UidHashSet&) = delete;
 
-    int8_t size() const
+    static constexpr int capacity()
     {
-        return cnt_;
+        return Capacity;
     }
 
-    bool contains(const int64_t &uid) const
+    int size() const
     {
-        for (int i = 0; i < cnt_; i++)
-        {
-            if (_cmp_(data_[i], uid) == 0)
-            {
-                return true;
-            }
-        }
-        return false;
+        return set_.size();
     }
 
-
-    bool insert(const int64_t& uid)
+    bool contains(const Uid &uid) const
     {
-        if(cnt_>=99){
-            return false;
-        }
-        if (contains(uid))
-        {
-            return false;
-        }
-        data_[cnt_++] = uid;
-        return true;
+        return set_.contains(uid);
     }
 
-    void clear()
+    bool insert(const Uid& uid)
     {
-        memset(data_, 0, sizeof(int64_t)*100);
-        cnt_ = 0;
+        return set_.insert(uid);
     }
 
-    int64_t& operator[](const int& index)
+    void clear()
     {
-        return data_[index];
+        set_.clear();
     }
 
-    const int64_t& operator[](const int& index) const
+    const Uid& operator[](const int& index) const
     {
-        return data_[index];
+        return set_.keyAt(index);
     }
 
-    bool operator=(const UidVec& oth) const{
-        if(cnt_!=oth.size()){
+    bool operator==(const UidHashSet& oth) const
+    {
+        if (size() != oth.size())
+        {
             return false;
         }
-        for(int i=0;i<cnt_;i++){
-            if(data_[i]!=oth[i]){
+        for (int i = 0; i < size(); i++)
+        {
+            if ((*this)[i] != oth[i])
+            {
                 return false;
             }
         }
@@ -199,131 +195,118 @@ public:
     }
 
 private:
-    int64_t _cmp_(const int64_t &a, const int64_t &b) const
-    {
-        return a - b;
-    }
-
-    //int64_t data_[100];
-    int64_t* data_;
-    int8_t cnt_;
+    FixedHashMap<Uid, FixedNoValue, Capacity, UidHash> set_;
 };
 
+#define UIDVEC_CAPACITY 100
+
+typedef UidHashSet<UIDVEC_CAPACITY> UidVec;
+
+#define UIDSET_CAPACITY 100
+
+/*
+ * Sorted set of UIDs in a StaticVector.
+ *
+ * A UID is loaded as one 64-bit word (memcpy, so unaligned input is fine)
+ * and compared word-wise; lookups are a binary search. insert and erase
+ * shift the tail of the vector. Nothing is ever allocated.
+ */
 class UidSet
 {
-    struct Node
-    {
-        Node() : next(nullptr)
-        {
-            memset(data_, 0, 8);
-        }
-        uint8_t data_[8];
-        Node *next;
-    };
-
 public:
-    UidSet()
+    static constexpr int capacity()
     {
-        root_ = new Node();
+        return UIDSET_CAPACITY;
+    }
 
-        cnt_ = 0;
+    int size() const
+    {
+        return data_.size();
     }
 
-    int size()
+    int contains(const uint8_t *uid) const
     {
-        return cnt_;
+        return contains(load(uid));
     }
 
-    int contains(uint8_t *uid)
+    int contains(const uint64_t &uid) const
     {
-        Node *p = root_->next;
-        while (p)
-        {
-            if (uid_cmp(uid, p->data_) == 0)
-            {
-                return 1;
-            }
-            p = p->next;
-        }
-        return 0;
+        int pos = lowerBound(uid);
+        return (pos < data_.size() && data_[pos] == uid) ? 1 : 0;
     }
 
-    int insert(uint8_t *uid)
+    // 0 if the uid is already present or the set is full
+    int insert(const uint8_t *uid)
     {
+        return insert(load(uid));
+    }
 
-        Node *p = root_;
-        while (p->next)
+    int insert(const uint64_t &uid)
+    {
+        int pos = lowerBound(uid);
+        if (pos < data_.size() && data_[pos] == uid)
         {
-            if (uid_cmp(p->next->data_, uid) == 0)
-            {
-                return 0;
-            }
-            p = p->next;
+            return 0;
         }
-        p->next = new Node();
-        uid_cpy(p->next->data_, uid);
-        cnt_++;
-        return 1;
+        return data_.insert(pos, uid) ? 1 : 0;
     }
 
-    int erase(uint8_t *uid)
+    int erase(const uint8_t *uid)
     {
+        return erase(load(uid));
+    }
 
-        Node *p = root_;
-        while (p->next && (uid_cmp(p->next->data_, uid)) != 0)
-        {
-            p = p->next;
-        }
-        if (p->next)
-        {
-            Node *tmp = p->next;
-            p->next = tmp->next;
-            delete tmp;
-            cnt_--;
-            return 1;
-        }
-        else
+    int erase(const uint64_t &uid)
+    {
+        int pos = lowerBound(uid);
+        if (pos >= data_.size() || data_[pos] != uid)
         {
             return 0;
         }
+        data_.erase(pos);
+        return 1;
     }
 
     void clear()
     {
-        Node *p = root_->next;
-        Node *tmp;
-        while (p)
-        {
-            tmp = p;
-            p = p->next;
-            delete tmp;
-        }
-        root_->next = nullptr;
-        cnt_ = 0;
+        data_.clear();
+    }
+
+    // i-th uid in ascending word order
+    const uint64_t &operator[](int index) const
+    {
+        return data_[index];
     }
 
 private:
-    int uid_cmp(uint8_t *a, uint8_t *b)
+    static uint64_t load(const uint8_t *uid)
     {
-        for (int i = 0; i < 8; i++)
-        {
-            if (a[i] != b[i])
-                return a[i] - b[i];
-        }
-        return 0;
+        uint64_t v;
+        memcpy(&v, uid, sizeof(v));
+        return v;
     }
 
-    uint8_t *uid_cpy(uint8_t *dst, uint8_t *src)
+    // first position whose uid is not less than the given one
+    int lowerBound(const uint64_t &uid) const
     {
-        for (int i = 0; i < 8; i++)
+        int lo = 0;
+        int hi = data_.size();
+        while (lo < hi)
         {
-            dst[i] = src[i];
+            int mid = (lo + hi) >> 1;
+            if (data_[mid] < uid)
+            {
+                lo = mid + 1;
+            }
+            else
+            {
+                hi = mid;
+            }
         }
-        return dst;
+        return lo;
     }
 
-    int cnt_;
-    Node *root_;
+    StaticVector<uint64_t, UIDSET_CAPACITY> data_;
 };
 
 //sample
@@ -340,9 +323,9 @@ private:
 		b[i] = 0x31 + i;
 	}
 	UidSet set;
-	set.addUid(a);
-	set.addUid(b);
-	set.delUid(a);
-	set.delUid(a);
+	set.insert(a);
+	set.insert(b);
+	set.erase(a);
+	set.erase(a);
 }
  */
\ No newline at end of file
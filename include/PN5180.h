@@ -65,8 +65,37 @@ enum PN5180TransceiveStat
 #define RFON_DET_IRQ_STAT (1 << 7)    // RF Field ON detection IRQ
 #define TX_RFOFF_IRQ_STAT (1 << 8)    // RF Field OFF in PCD IRQ
 #define TX_RFON_IRQ_STAT (1 << 9)     // RF Field ON in PCD IRQ
+#define TIMER1_IRQ_STAT (1 << 12)     // Timer 1 expired IRQ
 #define RX_SOF_DET_IRQ_STAT (1 << 14) // RF SOF Detection IRQ
 
+// PN5180 RX_STATUS
+#define RX_BYTES_RECEIVED_MASK (0x1ff)                 // bytes in the reception buffer
+#define RX_NUM_LAST_BITS(s) (((s) >> 13) & 0x07)       // valid bits in the last byte, 0 = all
+#define RX_DATA_INTEGRITY_ERROR (1 << 16)              // CRC or parity error
+#define RX_PROTOCOL_ERROR (1 << 17)
+#define RX_COLLISION_DETECTED (1 << 18)
+#define RX_COLL_POS(s) (((s) >> 19) & 0x7f)            // first collision, counts RX_BIT_ALIGN bits
+
+// PN5180 CRC_RX_CONFIG / CRC_TX_CONFIG
+#define RX_CRC_ENABLE (1 << 0)
+#define RX_BIT_ALIGN_SHIFT 6
+#define RX_BIT_ALIGN_MASK (0x07 << RX_BIT_ALIGN_SHIFT) // first received bit goes to this bit position
+#define TX_CRC_ENABLE (1 << 0)
+
+// PN5180 TIMER1_CONFIG / TIMER1_RELOAD
+#define T1_ENABLE (1 << 0)
+#define T1_PRESCALE_212KHZ (5 << 1)    // 6.78 MHz / 32, one tick is 64/fc = 4.72 us
+#define T1_START_ON_TX_ENDED (1 << 15)
+#define T1_STOP_ON_RX_STARTED (1 << 20)
+#define T1_RELOAD_MAX (0xfffff)        // 20-bit counter
+
+// transceive() results below zero
+#define PN5180_TRANSCEIVE_NO_ANSWER (-1)  // no RX_IRQ before the deadline
+#define PN5180_TRANSCEIVE_FAILED (-2)     // SEND_DATA refused, transceiver not in WaitTransmit
+#define PN5180_TRANSCEIVE_TIMEOUT_MS 100
+// TX_RFON_IRQ / TX_RFOFF_IRQ only come when the field changes state
+#define PN5180_RF_TIMEOUT_MS 10
+
 class PN5180
 {
 private:
@@ -111,11 +140,20 @@ public:
     /* cmd 0x11 */
     bool loadRFConfig(uint8_t txConf, uint8_t rxConf);
 
-    /* cmd 0x16 */
+    /* cmd 0x16, false when the field was already on */
     bool setRF_on();
-    /* cmd 0x17 */
+    /* cmd 0x17, false when the field was already off */
     bool setRF_off();
 
+    /*
+     * SEND_DATA, then waits for the end of reception (RX_IRQ) and reads
+     * the answer: at most rxMax bytes go to rx. Returns the number of
+     * bytes received, which may exceed rxMax, or PN5180_TRANSCEIVE_*;
+     * rxStatus, if given, receives RX_STATUS.
+     */
+    int16_t transceive(uint8_t *tx, uint8_t txLen, uint8_t *rx, uint16_t rxMax, uint32_t *rxStatus = 0,
+                       uint8_t validBits = 0, uint16_t timeoutMs = PN5180_TRANSCEIVE_TIMEOUT_MS);
+
     uint8_t finitepiSendData(uint8_t* params, uint16_t len, uint8_t* buffer, uint8_t wait = 5);
     bool activeTypeA(uint8_t *buffer, uint8_t kind);
     /*
@@ -134,8 +172,6 @@ public:
    */
 private:
     bool transceiveCommand(uint8_t *sendBuffer, size_t sendBufferLen, uint8_t *recvBuffer = 0, size_t recvBufferLen = 0);
-    
-    uint8_t rxByteReceived();
 };
 
 #endif /* PN5180_H */
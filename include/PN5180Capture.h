@@ -0,0 +1,119 @@
+// NAME: PN5180Capture.h
+//
+// DESC: SPI frame recorder for the PN5180 host interface.
+//
+// This file is part of the PN5180 library for the Arduino environment.
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// Lesser General Public License for more details.
+//
+#ifndef PN5180CAPTURE_H
+#define PN5180CAPTURE_H
+
+#include <Arduino.h>
+#include "ReportProtocol.h"
+
+/*
+ * Build with -DPN5180_CAPTURE to record every SPI frame of
+ * PN5180::transceiveCommand(); without it the macros below compile to
+ * nothing.
+ *
+ * A record is Flags, Length (2), BusyUs (2) and the bytes sent (MOSI) or
+ * read (MISO), packed back to back in a byte ring, so a 2-byte register
+ * read costs 7 + 9 bytes. BusyUs is the time from NSS high until BUSY was
+ * seen low, saturated at 65535; it includes the driver's delay(1), so it
+ * is an upper bound on the PN5180's own busy time. When the ring is full
+ * the oldest records are dropped: after a field failure the ring holds
+ * the frames that led up to it.
+ *
+ * dump() sends the ring as REPORT_CAPTURE frames and empties it;
+ * tools/pn5180_replay runs the driver against a capture.
+ */
+#ifndef PN5180_CAPTURE_SIZE
+#define PN5180_CAPTURE_SIZE 1024
+#endif
+
+/*
+ * Largest REPORT_CAPTURE frame the report port takes as a whole: on the
+ * firmware the empty UART TX ring (UART_TX_BUFFER_SIZE, checked in
+ * main.cpp). A larger frame is neither queued nor dropped but blocks the
+ * caller.
+ */
+#ifndef PN5180_CAPTURE_FRAME_MAX
+#define PN5180_CAPTURE_FRAME_MAX 512
+#endif
+
+/*
+ * Record bytes per REPORT_CAPTURE frame, after its Dropped (4). An SPI
+ * frame with a longer record is not recorded; with the default 512-byte
+ * frame that is a READ_DATA of more than 497 bytes.
+ */
+#if (PN5180_CAPTURE_FRAME_MAX - REPORT_OVERHEAD) < REPORT_MAX_PAYLOAD
+#define PN5180_CAPTURE_MAX_RECORD (PN5180_CAPTURE_FRAME_MAX - REPORT_OVERHEAD - 4)
+#else
+#define PN5180_CAPTURE_MAX_RECORD (REPORT_MAX_PAYLOAD - 4)
+#endif
+
+class PN5180CaptureRing
+{
+    static_assert((PN5180_CAPTURE_SIZE & (PN5180_CAPTURE_SIZE - 1)) == 0,
+                  "PN5180_CAPTURE_SIZE must be a power of two");
+
+public:
+    PN5180CaptureRing() : head_(0), tail_(0), dropped_(0) {}
+
+    // flags: 0 or REPORT_CAPTURE_MISO
+    void record(uint8_t flags, const uint8_t *data, uint16_t len, uint32_t busyUs);
+
+    /*
+     * Sends everything as REPORT_CAPTURE frames of whole records and
+     * empties the ring; an empty ring still sends one frame. Every frame
+     * carries the records dropped since the previous dump, which is then
+     * reset. On uartTx it waits for each frame to leave, as the default
+     * 1 KiB ring takes three frames. Returns the frames sent.
+     */
+    uint8_t dump(Print &out);
+
+    void clear()
+    {
+        tail_ = head_;
+        dropped_ = 0;
+    }
+
+    uint32_t dropped() const { return dropped_; }
+
+private:
+    uint8_t at(uint32_t i) const { return buffer_[i & (PN5180_CAPTURE_SIZE - 1)]; }
+    uint16_t recordLength(uint32_t i) const
+    {
+        return REPORT_CAPTURE_HEADER_LEN + (at(i + 1) | (at(i + 2) << 8));
+    }
+
+    uint8_t buffer_[PN5180_CAPTURE_SIZE];
+    uint32_t head_; // free running byte indices
+    uint32_t tail_;
+    uint32_t dropped_;
+};
+
+#ifdef PN5180_CAPTURE
+extern PN5180CaptureRing pn5180Capture;
+
+#define PN5180CAPTURE_MARK(var) uint32_t var = micros()
+// one frame, BUSY timed from the mark
+#define PN5180CAPTURE(flags, data, len, mark) pn5180Capture.record((flags), (data), (len), micros() - (mark))
+#else
+#define PN5180CAPTURE_MARK(var)
+#define PN5180CAPTURE(flags, data, len, mark) \
+    do                                        \
+    {                                         \
+    } while (0)
+#endif
+
+#endif /* PN5180CAPTURE_H */
@@ -19,16 +19,142 @@
 #ifndef DEBUG_H
 #define DEBUG_H
 
+#include <Arduino.h>
+
+/*
+ * Compile-time log levels, one per module. Set them with build flags,
+ * e.g. -DPN5180_LOG_CORE=PN5180_LOG_DEBUG; the old -DDEBUG switches every
+ * module to PN5180_LOG_DEBUG. A source file picks its module by defining
+ * PN5180_LOG_MODULE before including this header (default: core).
+ *
+ * Everything below the module's level compiles to nothing, arguments
+ * included. Cold paths print text to *pn5180LogOut, Serial unless the
+ * application sets its own port; the register, RF command and ISO15693
+ * command paths push 12-byte PN5180TraceRecords into a RAM ring instead,
+ * so enabling them costs a few microseconds per access rather than
+ * milliseconds of UART output. The ring exists as soon as one module logs at
+ * PN5180_LOG_ERROR, so error records are kept without DEBUG.
+ * pn5180TraceDrain() sends the ring as REPORT_TRACE frames.
+ */
+#define PN5180_LOG_NONE 0
+#define PN5180_LOG_ERROR 1
+#define PN5180_LOG_INFO 2
+#define PN5180_LOG_DEBUG 3   // trace records for register and RF commands
+#define PN5180_LOG_VERBOSE 4 // plus one record per SPI frame
+
 #ifdef DEBUG
-#define PN5180DEBUG(msg) Serial.print(msg)
+#define PN5180_LOG_DEFAULT PN5180_LOG_DEBUG
 #else
-#define PN5180DEBUG(msg)
+#define PN5180_LOG_DEFAULT PN5180_LOG_NONE
 #endif
 
-#ifdef DEBUG
+#ifndef PN5180_LOG_CORE
+#define PN5180_LOG_CORE PN5180_LOG_DEFAULT // PN5180.cpp
+#endif
+#ifndef PN5180_LOG_ISO15693
+#define PN5180_LOG_ISO15693 PN5180_LOG_DEFAULT // PN5180ISO15693.cpp
+#endif
+
+#ifndef PN5180_LOG_MODULE
+#define PN5180_LOG_MODULE PN5180_LOG_CORE
+#endif
+
+// usable in #if as well as in code
+#define PN5180_LOG_ON(level) ((level) <= PN5180_LOG_MODULE)
+
+// text sink; the firmware sets its report port so that only one driver writes to the USART
+extern Print *pn5180LogOut;
+
+#define PN5180LOG(level, msg)         \
+    do                                \
+    {                                 \
+        if (PN5180_LOG_ON(level))     \
+        {                             \
+            pn5180LogOut->print(msg); \
+        }                             \
+    } while (0)
+
+#define PN5180ERROR(msg) PN5180LOG(PN5180_LOG_ERROR, msg)
+#define PN5180DEBUG(msg) PN5180LOG(PN5180_LOG_DEBUG, msg)
+
 extern char * formatHex(const uint8_t val);
 extern char * formatHex(const uint16_t val);
 extern char * formatHex(const uint32_t val);
+
+enum PN5180TraceEvent : uint8_t
+{
+    PN5180_TRACE_WRITE_REG = 1,     // arg=register, value
+    PN5180_TRACE_WRITE_REG_OR = 2,  // arg=register, value=mask
+    PN5180_TRACE_WRITE_REG_AND = 3, // arg=register, value=mask
+    PN5180_TRACE_READ_REG = 4,      // arg=register, value
+    PN5180_TRACE_READ_EEPROM = 5,   // arg=address, length
+    PN5180_TRACE_SEND_DATA = 6,     // arg=valid bits, length, value=first 4 bytes
+    PN5180_TRACE_READ_DATA = 7,     // length, value=first 4 bytes
+    PN5180_TRACE_LOAD_RF_CONFIG = 8, // arg=TX config, value=RX config
+    PN5180_TRACE_RF_ON = 9,
+    PN5180_TRACE_RF_OFF = 10,
+    PN5180_TRACE_SPI_FRAME = 11,    // arg=command byte, length=bytes sent, value=bytes read
+    PN5180_TRACE_ISO15693_CMD = 12, // arg=command code, length=answer, value=RX_STATUS
+    PN5180_TRACE_ISO15693_ERROR = 13, // arg=command code, value=ISO15693 error code
+    PN5180_TRACE_ISO15693_INVENTORY = 14, // arg=UID byte 6, length=UID bytes 4-5, value=UID bytes 0-3
+    PN5180_TRACE_ISO15693_READ_BLOCK = 15, // arg=block number, length=block size, value=first 4 bytes
+    PN5180_TRACE_ISO15693_WRITE_BLOCK = 16 // arg=block number, length=block size, value=first 4 bytes
+};
+
+#define PN5180_TRACE_USED ((PN5180_LOG_CORE >= PN5180_LOG_ERROR) || (PN5180_LOG_ISO15693 >= PN5180_LOG_ERROR))
+
+#if PN5180_TRACE_USED
+#include "EventRing.h"
+
+#ifndef PN5180_TRACE_RING_SIZE
+#define PN5180_TRACE_RING_SIZE 64
+#endif
+// records per REPORT_TRACE frame: 5 + 16 * 12 = 197 payload bytes
+#define PN5180_TRACE_BATCH 16
+
+typedef SpscRing<PN5180TraceRecord, PN5180_TRACE_RING_SIZE> PN5180TraceRing;
+extern PN5180TraceRing pn5180Trace;
+
+// a full ring drops the newest record and counts it in overflows()
+inline void pn5180TracePush(uint8_t event, uint8_t arg, uint16_t length, uint32_t value)
+{
+    PN5180TraceRecord r = {(uint32_t)micros(), event, arg, length, value};
+    pn5180Trace.push(r);
+}
+
+// first (up to) four bytes of a buffer, little endian
+inline uint32_t traceHead(const uint8_t *data, uint16_t len)
+{
+    uint32_t v = 0;
+    for (uint8_t i = 0; (i < 4) && (i < len); i++)
+    {
+        v |= (uint32_t)data[i] << (8 * i);
+    }
+    return v;
+}
+
+/*
+ * Sends everything in the ring as REPORT_TRACE frames of up to
+ * PN5180_TRACE_BATCH records; an empty ring still sends one frame so the
+ * overflow count is seen. Each frame goes through reportFrameSent(), as
+ * a full trace ring does not fit into the UART TX ring. Returns the records
+ * sent.
+ */
+uint32_t pn5180TraceDrain(Print &out);
+
+#define PN5180TRACE(level, event, arg, length, value)              \
+    do                                                              \
+    {                                                               \
+        if (PN5180_LOG_ON(level))                                   \
+        {                                                           \
+            pn5180TracePush((event), (arg), (length), (value));     \
+        }                                                           \
+    } while (0)
+#else
+#define PN5180TRACE(level, event, arg, length, value) \
+    do                                                \
+    {                                                 \
+    } while (0)
 #endif
 
 #endif /* DEBUG_H */
@@ -0,0 +1,120 @@
+// NAME: PN5180ISO14443.h
+//
+// DESC: ISO14443A activation and anticollision on NXP Semiconductors PN5180 module for Arduino.
+//
+// This file is part of the PN5180 library for the Arduino environment.
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// Lesser General Public License for more details.
+//
+#ifndef PN5180ISO14443_H
+#define PN5180ISO14443_H
+
+#include "PN5180.h"
+
+// ISO14443-3 type A commands
+#define ISO14443_REQA 0x26
+#define ISO14443_WUPA 0x52
+#define ISO14443_SEL_CL1 0x93
+#define ISO14443_SEL_CL2 0x95
+#define ISO14443_SEL_CL3 0x97
+#define ISO14443_HLTA 0x50
+#define ISO14443_CASCADE_TAG 0x88
+#define ISO14443_SAK_CASCADE (1 << 2) // UID not complete
+
+#define ISO14443_UID_MAX 10
+
+// frame waiting deadline; a card answers REQA/ANTICOLLISION within 100 us
+#define ISO14443_TIMEOUT_MS 5
+// no answer to HLTA within 1 ms means it was accepted
+#define ISO14443_HALT_TIMEOUT_MS 1
+
+enum ISO14443ErrorCode
+{
+    ISO14443_EC_NO_CARD = -1,
+    ISO14443_EC_OK = 0,
+    ISO14443_EC_COLLISION = 0x01,  // bit collision, only seen inside the anticollision loop
+    ISO14443_EC_PROTOCOL = 0x02,   // framing error or an answer that makes no sense
+    ISO14443_EC_INTEGRITY = 0x03,  // CRC or parity error
+    ISO14443_EC_BCC = 0x04,        // UID check byte wrong
+    ISO14443_EC_CASCADE = 0x05,    // cascade bit still set after level 3
+    ISO14443_EC_OVERFLOW = 0x06    // answer does not fit the caller's buffer
+};
+
+// one activated card
+struct ISO14443Card
+{
+    uint16_t atqa;                 // ATQA, first byte received in the low byte
+    uint8_t sak;                   // SAK of the last cascade level
+    uint8_t uidLength;             // 4, 7 or 10
+    uint8_t uid[ISO14443_UID_MAX];
+};
+
+/*
+ * ISO14443A (106 kbit/s) on the PN5180.
+ *
+ * activate() runs REQA/WUPA, then bit-wise anticollision and SELECT for
+ * every cascade level; enumerate() repeats that, halting each selected
+ * card, until no card answers. Collisions are resolved by taking the
+ * 1-branch at RX_COLL_POS and resending the known bits, with
+ * RX_BIT_ALIGN placing the card's first bit behind them.
+ *
+ * CRC enable and RX_BIT_ALIGN are cached copies of CRC_RX_CONFIG and
+ * CRC_TX_CONFIG, read once in setupRF(): changing the framing is at most
+ * one WRITE_REGISTER per register, and none when nothing changes. Nothing
+ * here prints.
+ */
+class PN5180ISO14443 : public PN5180
+{
+public:
+    PN5180ISO14443(uint8_t SSpin, uint8_t BUSYpin, uint8_t RSTpin);
+
+    // ISO14443A 106 kbit/s RF configuration, field on
+    bool setupRF();
+
+    // one card to ACTIVE; wakeup sends WUPA, which also wakes HALTed cards
+    ISO14443ErrorCode activate(ISO14443Card &card, bool wakeup = false);
+
+    // HLTA to the active card
+    ISO14443ErrorCode halt();
+
+    /*
+     * Activates and halts every card in the field, at most maxCards.
+     * The first request is a WUPA when wakeup is set, so cards halted by
+     * an earlier pass are found again; later requests are REQA, so a card
+     * woken by that WUPA but not selected in the first round falls back
+     * to HALT until the next pass. Returns the number of cards.
+     */
+    uint8_t enumerate(ISO14443Card *cards, uint8_t maxCards, bool wakeup = true);
+
+private:
+    ISO14443ErrorCode requestA(uint8_t command, uint16_t &atqa);
+    ISO14443ErrorCode anticollisionLevel(uint8_t sel, uint8_t *levelUid);
+    ISO14443ErrorCode selectLevel(uint8_t sel, const uint8_t *levelUid, uint8_t &sak);
+
+protected:
+    /*
+     * PN5180::transceive() with the RX_STATUS error bits turned into
+     * ISO14443ErrorCode; txLastBits valid bits in the last byte, 0 = all.
+     */
+    ISO14443ErrorCode exchange(uint8_t *tx, uint8_t txLen, uint8_t txLastBits,
+                               uint8_t *rx, uint16_t rxMax, uint32_t &rxStatus,
+                               uint8_t timeoutMs = ISO14443_TIMEOUT_MS);
+
+    // CRC on both directions and RX_BIT_ALIGN, from the cached registers
+    void setFraming(bool crc, uint8_t rxAlign);
+
+private:
+    uint32_t crcRxConfig_;
+    uint32_t crcTxConfig_;
+    bool crcCached_;
+};
+
+#endif /* PN5180ISO14443_H */
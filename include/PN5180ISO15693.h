@@ -21,11 +21,13 @@
 
 #include "PN5180.h"
 #include "MyStd.h"
+#include "Uid.h"
 
 #define ISO15693_POLYCRC16 0x8408
 #define ISO15693_MASKCRC16 0x0001
 #define ISO15693_PRELOADCRC16 0xFFFF
-#define RX_COLLISION_DETECTED (1<<18)
+// end of reception (RX_IRQ) after SEND_DATA, or no label answered
+#define ISO15693_ANSWER_TIMEOUT_MS 10
 
 enum ISO15693ErrorCode
 {
@@ -51,6 +53,7 @@ public:
 
 public:
     ISO15693ErrorCode getInventory(uint8_t *uid);
+    ISO15693ErrorCode getInventory(Uid &uid);
 
     ISO15693ErrorCode readSingleBlock(uint8_t *uid, uint8_t blockNo, uint8_t *blockData, uint8_t blockSize);
     ISO15693ErrorCode writeSingleBlock(uint8_t *uid, uint8_t blockNo, uint8_t *blockData, uint8_t blockSize);
@@ -74,17 +77,17 @@ public:
     * @return errno 
     * 
     */
-    ISO15693ErrorCode search_once(const int64_t& mask,const uint8_t& mask_length,uint8_t& ret_val,int64_t& result_ptr);
+    ISO15693ErrorCode search_once(const uint64_t& mask,const uint8_t& mask_length,uint8_t& ret_val,Uid& result_ptr);
 
     //quiet uid
-    void quiet(const int64_t& uid);
+    void quiet(const Uid& uid);
 
 /*
 
 
  */
 
-    ISO15693ErrorCode getSystemInfo(const int64_t& uid, uint8_t& blockSize, uint8_t& numBlocks);
+    ISO15693ErrorCode getSystemInfo(const Uid& uid, uint8_t& blockSize, uint8_t& numBlocks);
 
     /*
      *  
@@ -93,11 +96,11 @@ public:
      *  @parm return blockData
      *  @parm blockSize blockData size
      */
-    ISO15693ErrorCode readSingleBlock(const int64_t& uid, const uint8_t& blockNo, uint8_t* blockData, const uint8_t& blockSize);
-    ISO15693ErrorCode readSingleBlock(const int64_t& uid, const uint8_t& blockNo, uint64_t& blockData);
+    ISO15693ErrorCode readSingleBlock(const Uid& uid, const uint8_t& blockNo, uint8_t* blockData, const uint8_t& blockSize);
+    ISO15693ErrorCode readSingleBlock(const Uid& uid, const uint8_t& blockNo, uint64_t& blockData);
 
-    ISO15693ErrorCode writeSingleBlock(const int64_t& uid, const uint8_t& blockNo, uint8_t *blockData, const uint8_t& blockSize);
-    ISO15693ErrorCode writeSingleBlock(const int64_t& uid, const uint8_t& blockNo, uint64_t& blockData);
+    ISO15693ErrorCode writeSingleBlock(const Uid& uid, const uint8_t& blockNo, uint8_t *blockData, const uint8_t& blockSize);
+    ISO15693ErrorCode writeSingleBlock(const Uid& uid, const uint8_t& blockNo, uint64_t& blockData);
 
     int32_t calc_point();
     int32_t calc_point_once();
@@ -0,0 +1,124 @@
+// NAME: PN5180ISODEP.h
+//
+// DESC: ISO14443-4 (ISO-DEP) block transport on NXP Semiconductors PN5180 module for Arduino.
+//
+// This file is part of the PN5180 library for the Arduino environment.
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// Lesser General Public License for more details.
+//
+#ifndef PN5180ISODEP_H
+#define PN5180ISODEP_H
+
+#include "PN5180ISO14443.h"
+
+// ISO14443-4 commands and PCBs, no CID and no NAD
+#define ISODEP_RATS 0xE0
+#define ISODEP_PCB_I 0x02
+#define ISODEP_PCB_R_ACK 0xA2
+#define ISODEP_PCB_R_NAK 0xB2
+#define ISODEP_PCB_S_DESELECT 0xC2
+#define ISODEP_PCB_S_WTX 0xF2
+#define ISODEP_PCB_CHAINING (1 << 4)
+#define ISODEP_PCB_NAK (1 << 4)
+#define ISODEP_PCB_CID_NAD (0x0C)      // never sent, so never expected back
+#define ISODEP_PCB_BLOCK_NUM (1 << 0)
+#define ISODEP_WTXM_MASK 0x3F
+
+// ATS format byte T0
+#define ISODEP_T0_TA (1 << 4)
+#define ISODEP_T0_TB (1 << 5)
+#define ISODEP_T0_TC (1 << 6)
+#define ISODEP_T0_FSCI_MASK 0x0F
+
+// we announce FSDI 8: frames up to 256 bytes, well inside the 508-byte reception buffer
+#define ISODEP_FSDI 8
+#define ISODEP_FSD 256
+#define ISODEP_FSC_MAX 256
+#define ISODEP_ATS_MAX 32
+
+// defaults when the ATS leaves TB out
+#define ISODEP_FWI_DEFAULT 4
+#define ISODEP_SFGI_DEFAULT 0
+
+// FWT = 256 * 16 / fc * 2^FWI, that is 64 TIMER1 ticks * 2^FWI
+#define ISODEP_FWT_TICKS 64UL
+#define ISODEP_FWI_MAX 14
+// retransmissions before a block exchange gives up
+#define ISODEP_RETRIES 2
+// host deadline on top of the PN5180 timer, in case TIMER1 never fires
+#define ISODEP_DEADLINE_MARGIN_MS 5
+
+/*
+ * ISO-DEP on top of an activated ISO14443A card.
+ *
+ * rats() reads the ATS and takes FSC, FWI and SFGI from it. apdu() sends
+ * a command APDU as a chain of I-blocks of at most FSC bytes and collects
+ * the chained response, acknowledging each part with R(ACK). A missing or
+ * damaged answer is recovered with R(NAK) or a retransmission; S(WTX)
+ * requests are answered and stretch the next wait.
+ *
+ * The frame waiting time runs on PN5180 TIMER1, started at the end of
+ * transmission and stopped at the start of reception, so the host only
+ * polls IRQ_STATUS for RX_IRQ or TIMER1_IRQ. TIMER1_RELOAD is written only
+ * when FWT or the WTX multiplier changes.
+ *
+ * Each received block is copied once, straight from the PN5180 reception
+ * buffer into the caller's response buffer behind the PCB.
+ *
+ * Once TIMER1 is set up, a block costs 12 SPI frames: the IRQ_CLEAR write,
+ * the two SYSTEM_CONFIG writes and the RF_STATUS read of sendData(),
+ * SEND_DATA, then at least one IRQ_STATUS read, RX_STATUS and READ_DATA.
+ * tools/isodep_sim counts them.
+ */
+class PN5180ISODEP : public PN5180ISO14443
+{
+public:
+    PN5180ISODEP(uint8_t SSpin, uint8_t BUSYpin, uint8_t RSTpin);
+
+    /*
+     * RATS to the card selected by activate(). ats, if given, receives up
+     * to ISODEP_ATS_MAX bytes of the ATS and atsLen its length.
+     */
+    ISO14443ErrorCode rats(uint8_t *ats = 0, uint8_t *atsLen = 0);
+
+    /*
+     * One APDU exchange. The response, status word included, goes to
+     * rapdu; ISO14443_EC_OVERFLOW when it exceeds rapduMax.
+     */
+    ISO14443ErrorCode apdu(const uint8_t *capdu, uint16_t capduLen,
+                           uint8_t *rapdu, uint16_t rapduMax, uint16_t &rapduLen);
+
+    // S(DESELECT): the card goes to HALT
+    ISO14443ErrorCode deselect();
+
+    uint16_t fsc() const { return fsc_; }
+    uint8_t fwi() const { return fwi_; }
+
+private:
+    /*
+     * One block and its answer, with WTX and retransmission handled:
+     * rx points into the PN5180 reception buffer.
+     */
+    ISO14443ErrorCode exchangeBlock(uint8_t *tx, uint16_t txLen, uint8_t *&rx, uint16_t &rxLen);
+    ISO14443ErrorCode transceiveBlock(uint8_t *tx, uint16_t txLen, uint8_t wtxm, uint8_t *&rx, uint16_t &rxLen);
+
+    // TIMER1 to FWT * wtxm (wtxm 0 means 1), in 64/fc ticks
+    uint32_t armTimer(uint8_t wtxm);
+
+    uint16_t fsc_;
+    uint8_t fwi_;
+    uint8_t sfgi_;
+    uint8_t blockNum_;
+    uint32_t timerReload_;
+    bool timerConfigured_;
+};
+
+#endif /* PN5180ISODEP_H */
@@ -0,0 +1,107 @@
+// NAME: PN5180Poller.h
+//
+// DESC: Multi-protocol discovery loop on NXP Semiconductors PN5180 module for Arduino.
+//
+// This file is part of the PN5180 library for the Arduino environment.
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// Lesser General Public License for more details.
+//
+#ifndef PN5180POLLER_H
+#define PN5180POLLER_H
+
+#include "PN5180ISO14443.h"
+#include "PN5180ISO15693.h"
+
+// unmodulated carrier a card needs after the RF configuration changed
+#ifndef PN5180_POLL_GUARD_ISO14443A_US
+#define PN5180_POLL_GUARD_ISO14443A_US 5100 // NFC Forum GTA
+#endif
+#ifndef PN5180_POLL_GUARD_ISO15693_US
+#define PN5180_POLL_GUARD_ISO15693_US 1000
+#endif
+
+enum PN5180PollTech
+{
+    PN5180_POLL_ISO14443A = 0,
+    PN5180_POLL_ISO15693 = 1,
+    PN5180_POLL_TECH_COUNT
+};
+
+struct PN5180PollResult
+{
+    PN5180PollTech tech;
+    ISO14443Card iso14443; // valid for PN5180_POLL_ISO14443A, card left ACTIVE
+    Uid iso15693;          // valid for PN5180_POLL_ISO15693
+};
+
+/*
+ * Per technology. Discovery latency is the time from the start of poll()
+ * to the card answering, so it includes the technologies tried before
+ * and any RF reconfiguration; empty attempts only add to attempts.
+ */
+struct PN5180PollStats
+{
+    uint32_t attempts;   // detection commands sent
+    uint32_t found;
+    uint32_t switches;   // RF configuration loads into this technology
+    uint32_t latencyMinUs;
+    uint32_t latencyMaxUs;
+    uint32_t latencySumUs; // average = latencySumUs / found
+};
+
+/*
+ * Round-robin discovery of ISO14443A cards and ISO15693 labels on one
+ * PN5180. Both protocol objects talk to the same chip.
+ *
+ * The poller remembers which technology's RF configuration is loaded and
+ * only calls that technology's setupRF() when it changes: field off, new
+ * configuration, field on, then the technology's guard time. Cards of the
+ * other technology lose power on a switch, and RF_ON never meets a field
+ * that is still on. A round starts with the technology already
+ * loaded, so with both enabled every round costs at most one
+ * LOAD_RF_CONFIG and with one enabled none at all. After a card is found
+ * the next round starts with the following technology, so a card that
+ * keeps answering cannot starve the other one.
+ */
+class PN5180Poller
+{
+public:
+    PN5180Poller(PN5180ISO14443 &iso14443, PN5180ISO15693 &iso15693);
+
+    void enable(PN5180PollTech tech, bool on);
+    bool enabled(PN5180PollTech tech) const { return enabled_[tech]; }
+
+    // one round over the enabled technologies; true and result on the first card
+    bool poll(PN5180PollResult &result);
+
+    /*
+     * Forget the loaded configuration, e.g. after a PN5180 reset or when
+     * something else called loadRFConfig().
+     */
+    void invalidate() { active_ = -1; }
+
+    const PN5180PollStats &stats(PN5180PollTech tech) const { return stats_[tech]; }
+    void resetStats();
+
+private:
+    // RF configuration of tech, loaded only when it is not the active one
+    bool select(PN5180PollTech tech);
+    bool detect(PN5180PollTech tech, PN5180PollResult &result);
+
+    PN5180ISO14443 &iso14443_;
+    PN5180ISO15693 &iso15693_;
+    bool enabled_[PN5180_POLL_TECH_COUNT];
+    int8_t active_;
+    uint8_t next_;
+    PN5180PollStats stats_[PN5180_POLL_TECH_COUNT];
+};
+
+#endif /* PN5180POLLER_H */
@@ -0,0 +1,134 @@
+// NAME: PN5180Profile.h
+//
+// DESC: Cycle-counter latency profiling of the PN5180 driver.
+//
+// This file is part of the PN5180 library for the Arduino environment.
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// Lesser General Public License for more details.
+//
+#ifndef PN5180PROFILE_H
+#define PN5180PROFILE_H
+
+#include <Arduino.h>
+
+/*
+ * Build with -DPN5180_PROFILE to time the driver; without it every macro
+ * below compiles to nothing.
+ *
+ * Each probe keeps count, min, max, sum and a log2 histogram of its
+ * durations in RAM. Durations are in clock ticks: the DWT cycle counter
+ * on the Cortex-M3 (wraps after 59 s at 72 MHz), nanoseconds of
+ * std::chrono::steady_clock on a host (wraps after 4.2 s), so a single
+ * span must stay below that. Histogram bucket b counts durations of
+ * [2^b, 2^(b+1)) microseconds, bucket 0 everything below 2 us and the
+ * last bucket everything above.
+ *
+ * Probes nest: a host command contains its SPI frames and BUSY waits, an
+ * ISO15693 command contains its host commands. The bookkeeping of an
+ * inner probe (about 100 cycles) is counted in the outer one.
+ */
+enum PN5180ProfileProbe : uint8_t
+{
+    PN5180_PROF_SPI_FRAME = 0,     // NSS low to NSS high, one direction of a host command
+    PN5180_PROF_BUSY_WAIT = 1,     // waiting for BUSY low before and after a frame
+    PN5180_PROF_RF_EXCHANGE = 2,   // SEND_DATA until the answer is there (or given up)
+    PN5180_PROF_ISO15693_CMD = 3,  // issueISO15693Command()
+    PN5180_PROF_SEARCH_ALL = 4,    // PN5180ISO15693::search_all()
+    PN5180_PROF_CALC_POINT = 5,    // PN5180ISO15693::calc_point()
+    PN5180_PROF_COMMAND_BASE = 6   // then one probe per host command code
+};
+
+// host command codes with a probe of their own; RF_OFF (0x17) is the highest the driver sends
+#ifndef PN5180_PROFILE_COMMANDS
+#define PN5180_PROFILE_COMMANDS 0x18
+#endif
+#define PN5180_PROF_COUNT (PN5180_PROF_COMMAND_BASE + PN5180_PROFILE_COMMANDS)
+// probe of a host command; codes without one map to PN5180_PROF_COUNT, which is ignored
+#define PN5180_PROF_COMMAND(code) \
+    (((code) < PN5180_PROFILE_COMMANDS) ? (PN5180_PROF_COMMAND_BASE + (code)) : PN5180_PROF_COUNT)
+
+#define PN5180_PROFILE_BUCKETS 16
+
+struct PN5180ProfileStats
+{
+    uint32_t count;
+    uint32_t min; // ticks
+    uint32_t max;
+    uint64_t sum;
+    uint16_t histogram[PN5180_PROFILE_BUCKETS]; // saturates at 0xffff
+};
+
+#ifdef PN5180_PROFILE
+
+#if defined(__arm__)
+#include "CycleCounter.h"
+
+inline uint32_t pn5180ProfileNow()
+{
+    return DWT_CYCCNT;
+}
+#else
+#include <chrono>
+
+inline uint32_t pn5180ProfileNow()
+{
+    return (uint32_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+#endif
+
+extern PN5180ProfileStats pn5180Profile[PN5180_PROF_COUNT];
+extern uint16_t pn5180ProfileTicksPerUs;
+
+// starts the cycle counter and clears the statistics; PN5180::begin() calls it
+void pn5180ProfileBegin();
+void pn5180ProfileReset();
+void pn5180ProfileAdd(uint8_t probe, uint32_t ticks);
+
+/*
+ * Sends one REPORT_PROFILE frame per probe with samples, or a single
+ * empty one for probe 0 when there are none. On uartTx it waits for each
+ * frame to leave: 30 probes of 62 bytes do not fit into the TX ring.
+ * Returns the frames sent.
+ */
+uint8_t pn5180ProfileReport(Print &out);
+
+class PN5180ProfileScope
+{
+public:
+    explicit PN5180ProfileScope(uint8_t probe) : probe_(probe), start_(pn5180ProfileNow()) {}
+    ~PN5180ProfileScope() { pn5180ProfileAdd(probe_, pn5180ProfileNow() - start_); }
+
+private:
+    uint8_t probe_;
+    uint32_t start_;
+};
+
+#define PN5180PROFILE_BEGIN() pn5180ProfileBegin()
+// times the rest of the enclosing block
+#define PN5180PROFILE_SCOPE(probe) PN5180ProfileScope pn5180ProfileScope_(probe)
+#define PN5180PROFILE_START(var) uint32_t var = pn5180ProfileNow()
+#define PN5180PROFILE_STOP(probe, var) pn5180ProfileAdd((probe), pn5180ProfileNow() - (var))
+#else
+#define PN5180PROFILE_BEGIN() \
+    do                        \
+    {                         \
+    } while (0)
+#define PN5180PROFILE_SCOPE(probe)
+#define PN5180PROFILE_START(var)
+#define PN5180PROFILE_STOP(probe, var) \
+    do                                 \
+    {                                  \
+    } while (0)
+#endif
+
+#endif /* PN5180PROFILE_H */
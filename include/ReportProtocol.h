@@ -0,0 +1,296 @@
+#ifndef REPORTPROTOCOL_H
+#define REPORTPROTOCOL_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+/*
+ * Framed binary report protocol
+ *
+ * Frame format (all multi-byte fields little endian):
+ *
+ *   SYNC(0xA5), Type, Length (2 bytes), Payload (Length bytes), CRC16 (2 bytes)
+ *
+ * The CRC is the ISO15693 CRC16 (poly 0x8408, preset 0xFFFF, complemented)
+ * over Type, Length and Payload. reportCrc16() is its own incremental
+ * implementation of that polynomial, not PN5180ISO15693::ISO15693_CRC16(),
+ * so a frame can be checksummed piece by piece and the host decoder needs
+ * no driver code.
+ * A frame costs 6 bytes of overhead; a byte of payload costs one byte on the
+ * wire instead of the three characters of a "%02X " dump.
+ *
+ * Payloads:
+ *   REPORT_INVENTORY  Count, Count * UID (8 bytes each, LSB first); bit 7
+ *                     of Count (REPORT_INVENTORY_MORE) set means the inventory
+ *                     continues in the next frame, at most
+ *                     REPORT_INVENTORY_MAX_UIDS per frame
+ *   REPORT_BLOCK      UID (8), BlockNo, BlockData
+ *   REPORT_EVENT      Timestamp (4), Type, Code, Value (4), UID (8)
+ *   REPORT_RAW        raw bytes (e.g. a receive buffer)
+ *   REPORT_TEXT       ASCII text, not terminated
+ *   REPORT_TRACE      Count, Overflows (4), Count * record (12 bytes each:
+ *                     Timestamp (4), Event, Arg, Length (2), Value (4))
+ *   REPORT_PROFILE    Probe, TicksPerUs (2), Count (4), Min (4), Max (4),
+ *                     Sum (8), Buckets, Buckets * histogram count (2 each);
+ *                     durations in ticks, see PN5180Profile.h
+ *   REPORT_CAPTURE    Dropped (4), whole SPI capture records (PN5180Capture.h):
+ *                     Flags, Length (2), BusyUs (2), Length bytes
+ *
+ * This header only depends on the C library so the host-side decoder
+ * (tools/report_decode.cpp) shares the exact same code.
+ */
+#define REPORT_SYNC 0xA5
+#define REPORT_HEADER_LEN 4
+#define REPORT_TRAILER_LEN 2
+#define REPORT_OVERHEAD (REPORT_HEADER_LEN + REPORT_TRAILER_LEN)
+#ifndef REPORT_MAX_PAYLOAD
+#define REPORT_MAX_PAYLOAD 520
+#endif
+
+#define REPORT_UID_LEN 8
+// 1 + 63 * 8 = 505 payload bytes: a frame (511) fits the 512-byte UART ring
+#define REPORT_INVENTORY_MAX_UIDS 63
+#define REPORT_INVENTORY_MORE 0x80
+#define REPORT_EVENT_LEN 18
+#define REPORT_TRACE_RECORD_LEN 12
+#define REPORT_PROFILE_HEADER_LEN 24 // up to Buckets
+#define REPORT_CAPTURE_HEADER_LEN 5  // capture record without its bytes
+#define REPORT_CAPTURE_MISO 0x01     // record flag: bytes read from the PN5180, else bytes sent
+
+enum ReportType : uint8_t
+{
+    REPORT_INVENTORY = 0x01,
+    REPORT_BLOCK = 0x02,
+    REPORT_EVENT = 0x03,
+    REPORT_RAW = 0x04,
+    REPORT_TEXT = 0x05,
+    REPORT_TRACE = 0x06,
+    REPORT_PROFILE = 0x07,
+    REPORT_CAPTURE = 0x08
+};
+
+inline uint16_t reportCrc16(const uint8_t *data, size_t len, uint16_t crc = 0xFFFF)
+{
+    for (size_t i = 0; i < len; i++)
+    {
+        crc ^= data[i];
+        for (int j = 0; j < 8; j++)
+        {
+            crc = (crc & 0x0001) ? (crc >> 1) ^ 0x8408 : (crc >> 1);
+        }
+    }
+    return crc;
+}
+
+/*
+ * Encode one frame into out.
+ * Returns the frame length, or 0 if out is too small.
+ */
+inline size_t reportEncode(uint8_t type, const uint8_t *payload, uint16_t len, uint8_t *out, size_t outCap)
+{
+    if (outCap < (size_t)len + REPORT_OVERHEAD)
+    {
+        return 0;
+    }
+    out[0] = REPORT_SYNC;
+    out[1] = type;
+    out[2] = len & 0xff;
+    out[3] = len >> 8;
+    for (uint16_t i = 0; i < len; i++)
+    {
+        out[REPORT_HEADER_LEN + i] = payload[i];
+    }
+    uint16_t crc = ~reportCrc16(out + 1, len + 3);
+    out[REPORT_HEADER_LEN + len] = crc & 0xff;
+    out[REPORT_HEADER_LEN + len + 1] = crc >> 8;
+    return len + REPORT_OVERHEAD;
+}
+
+/*
+ * Byte-wise frame decoder. Feed every received byte; feed() returns true
+ * when a complete frame with a valid CRC is available in type()/payload().
+ *
+ * Garbage between frames is skipped and counted. A SYNC that does not
+ * start a valid frame (bad CRC or a length above REPORT_MAX_PAYLOAD) is
+ * counted and the search restarts at the byte after it, so a truncated
+ * frame cannot swallow the good frames behind it. Those held-back bytes
+ * may already contain more frames: after handling one, call next() until
+ * it returns false. When the input ends, finish() gives up on a frame
+ * still waiting for bytes (counted as a CRC error) and returns the
+ * complete frames behind it, one per call.
+ *
+ *   if (dec.feed(b))
+ *       do { handle(dec); } while (dec.next());
+ *   ...
+ *   while (dec.finish())
+ *       handle(dec);
+ */
+class ReportDecoder
+{
+public:
+    ReportDecoder() { reset(); }
+
+    void reset()
+    {
+        start_ = 0;
+        end_ = 0;
+        consume_ = 0;
+        type_ = 0;
+        len_ = 0;
+        crcErrors_ = 0;
+        oversized_ = 0;
+        skipped_ = 0;
+    }
+
+    bool feed(uint8_t b)
+    {
+        dropFrame();
+        if (end_ == sizeof(window_))
+        {
+            // only reached with start_ > 0: a full window always holds a decision
+            memmove(window_, window_ + start_, end_ - start_);
+            end_ -= start_;
+            start_ = 0;
+        }
+        window_[end_++] = b;
+        return scan();
+    }
+
+    // next frame among the bytes already fed
+    bool next()
+    {
+        dropFrame();
+        return scan();
+    }
+
+    // end of input: drop incomplete frames until a complete one is found
+    bool finish()
+    {
+        dropFrame();
+        while (start_ < end_)
+        {
+            if (scan())
+            {
+                return true;
+            }
+            if (start_ < end_)
+            {
+                crcErrors_++;
+                start_++;
+            }
+        }
+        return false;
+    }
+
+    uint8_t type() const { return type_; }
+    uint16_t length() const { return len_; }
+    const uint8_t *payload() const { return window_ + start_ + REPORT_HEADER_LEN; }
+
+    uint32_t crcErrors() const { return crcErrors_; }
+    // SYNCs followed by a length above REPORT_MAX_PAYLOAD
+    uint32_t oversized() const { return oversized_; }
+    uint32_t skippedBytes() const { return skipped_; }
+
+private:
+    void dropFrame()
+    {
+        start_ += consume_;
+        consume_ = 0;
+    }
+
+    bool scan()
+    {
+        while (start_ < end_)
+        {
+            const uint8_t *f = window_ + start_;
+            uint32_t avail = end_ - start_;
+            if (f[0] != REPORT_SYNC)
+            {
+                skipped_++;
+                start_++;
+                continue;
+            }
+            if (avail < REPORT_HEADER_LEN)
+            {
+                return false;
+            }
+            uint16_t len = f[2] | ((uint16_t)f[3] << 8);
+            if (len > REPORT_MAX_PAYLOAD)
+            {
+                oversized_++;
+                start_++;
+                continue;
+            }
+            if (avail < (uint32_t)len + REPORT_OVERHEAD)
+            {
+                return false;
+            }
+            uint16_t crc = ~reportCrc16(f + 1, len + 3);
+            uint16_t got = f[REPORT_HEADER_LEN + len] | ((uint16_t)f[REPORT_HEADER_LEN + len + 1] << 8);
+            if (crc != got)
+            {
+                crcErrors_++;
+                start_++;
+                continue;
+            }
+            type_ = f[1];
+            len_ = len;
+            consume_ = len + REPORT_OVERHEAD;
+            return true;
+        }
+        start_ = end_ = 0;
+        return false;
+    }
+
+    uint32_t start_; // window_[start_, end_) not decided yet
+    uint32_t end_;
+    uint32_t consume_; // frame returned last, dropped on the next call
+    uint8_t type_;
+    uint16_t len_;
+    uint32_t crcErrors_;
+    uint32_t oversized_;
+    uint32_t skipped_;
+    uint8_t window_[REPORT_MAX_PAYLOAD + REPORT_OVERHEAD];
+};
+
+#ifdef ARDUINO
+#include <Arduino.h>
+#include "EventRing.h"
+#include "MyStd.h"
+#include "PN5180Profile.h"
+
+/*
+ * Frame writers for the firmware. They stream straight to the Print sink
+ * (Serial or any other port), computing the CRC on the fly, so no frame
+ * buffer is needed.
+ */
+size_t reportInventory(Print &out, const UidVec &uids);
+size_t reportBlock(Print &out, const Uid &uid, uint8_t blockNo, const uint8_t *data, uint8_t len);
+size_t reportEvent(Print &out, const ReaderEvent &ev);
+size_t reportRaw(Print &out, const uint8_t *data, uint16_t len);
+size_t reportText(Print &out, const char *text);
+size_t reportTrace(Print &out, const PN5180TraceRecord *records, uint8_t count, uint32_t overflows);
+size_t reportProfile(Print &out, uint8_t probe, const PN5180ProfileStats &stats, uint16_t ticksPerUs);
+// records are passed as two pieces because the capture ring wraps
+size_t reportCapture(Print &out, uint32_t dropped, const uint8_t *data, uint16_t len,
+                     const uint8_t *wrapped, uint16_t wrappedLen);
+
+/*
+ * The writes between these form one message. On uartTx it is queued or
+ * dropped as a whole, or waits for the DMA when it is larger than the
+ * ring (UartDmaTx::beginMessage); on any other sink they are plain
+ * writes. reportBeginMessage() returns false when the message is dropped.
+ */
+bool reportBeginMessage(Print &out, size_t size);
+void reportEndMessage(Print &out);
+
+/*
+ * Reports of several frames call this after each one. On uartTx it waits
+ * until the frame has left, so the next one finds an empty ring instead
+ * of being dropped; other sinks have written it already.
+ */
+void reportFrameSent(Print &out);
+#endif
+
+#endif /* REPORTPROTOCOL_H */
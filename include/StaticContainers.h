@@ -0,0 +1,443 @@
+#ifndef STATICCONTAINERS_H
+#define STATICCONTAINERS_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+/*
+ * Fixed-capacity containers for the firmware.
+ *
+ * Capacities are template parameters, storage is inline (static, global or
+ * on the stack), nothing ever calls the heap and nothing throws: operations
+ * that cannot be performed return false or nullptr. Element types are
+ * expected to be small value types (UIDs, search nodes, cache entries).
+ *
+ * What the MyStd.h containers built on these cost, against the heap-based
+ * versions they replaced (Cortex-M3 layout; heap figures include the
+ * allocator's 8-byte header per block):
+ *
+ *   Cards           808 static       -> 808 static
+ *   UidVec          8 + 808 heap     -> 1064 static (the index table buys O(1))
+ *   UidSet (100)    2432 heap        -> 808 static
+ *   search stack    1608 heap/call   -> 580 on the stack
+ *   heap in use     up to ~4.8 KB    -> 0
+ */
+
+/*
+ * Contiguous array with a run-time size and compile-time capacity.
+ */
+template <typename T, int N>
+class StaticVector
+{
+    static_assert(N > 0, "StaticVector needs a capacity");
+
+public:
+    StaticVector() : size_(0) {}
+
+    static constexpr int capacity() { return N; }
+
+    int size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+    bool full() const { return size_ == N; }
+    void clear() { size_ = 0; }
+
+    T &operator[](int index) { return data_[index]; }
+    const T &operator[](int index) const { return data_[index]; }
+
+    T *begin() { return data_; }
+    T *end() { return data_ + size_; }
+    const T *begin() const { return data_; }
+    const T *end() const { return data_ + size_; }
+
+    T &back() { return data_[size_ - 1]; }
+    const T &back() const { return data_[size_ - 1]; }
+
+    bool push_back(const T &value)
+    {
+        if (full())
+        {
+            return false;
+        }
+        data_[size_++] = value;
+        return true;
+    }
+
+    bool pop_back()
+    {
+        if (empty())
+        {
+            return false;
+        }
+        size_--;
+        return true;
+    }
+
+    // insert before index, shifting the tail up
+    bool insert(int index, const T &value)
+    {
+        if (full() || index < 0 || index > size_)
+        {
+            return false;
+        }
+        for (int i = size_; i > index; i--)
+        {
+            data_[i] = data_[i - 1];
+        }
+        data_[index] = value;
+        size_++;
+        return true;
+    }
+
+    // remove index, shifting the tail down
+    bool erase(int index)
+    {
+        if (index < 0 || index >= size_)
+        {
+            return false;
+        }
+        size_--;
+        for (int i = index; i < size_; i++)
+        {
+            data_[i] = data_[i + 1];
+        }
+        return true;
+    }
+
+private:
+    T data_[N];
+    int size_;
+};
+
+/*
+ * FIFO queue for use within one context. For hand-off between an interrupt
+ * and the main loop use SpscRing (EventRing.h) instead.
+ */
+template <typename T, int N>
+class RingBuffer
+{
+    static_assert(N > 0 && (N & (N - 1)) == 0, "RingBuffer capacity must be a power of two");
+
+public:
+    RingBuffer() : head_(0), tail_(0) {}
+
+    static constexpr int capacity() { return N; }
+
+    int size() const { return (int)(head_ - tail_); }
+    bool empty() const { return head_ == tail_; }
+    bool full() const { return size() == N; }
+    void clear() { head_ = tail_ = 0; }
+
+    bool push(const T &value)
+    {
+        if (full())
+        {
+            return false;
+        }
+        data_[head_++ & (N - 1)] = value;
+        return true;
+    }
+
+    bool pop(T &value)
+    {
+        if (empty())
+        {
+            return false;
+        }
+        value = data_[tail_++ & (N - 1)];
+        return true;
+    }
+
+    // oldest element, nullptr if empty
+    const T *peek() const
+    {
+        return empty() ? nullptr : &data_[tail_ & (N - 1)];
+    }
+
+private:
+    T data_[N];
+    uint32_t head_;
+    uint32_t tail_;
+};
+
+// default hash for integer keys: fold to 32 bits, then Fibonacci hashing
+template <typename K>
+struct FixedHash
+{
+    uint32_t operator()(const K &key) const
+    {
+        uint64_t v = (uint64_t)key;
+        return ((uint32_t)v ^ (uint32_t)(v >> 32)) * 0x9E3779B1u;
+    }
+};
+
+// value type for FixedHashMap used as a set; takes no storage
+struct FixedNoValue
+{
+};
+
+namespace static_containers_detail
+{
+template <typename V, int N, bool Empty = std::is_empty<V>::value>
+struct ValueStore
+{
+    V &valueAt(int index) { return values_[index]; }
+    const V &valueAt(int index) const { return values_[index]; }
+    void moveValue(int to, int from) { values_[to] = values_[from]; }
+    V values_[N];
+};
+
+template <typename V, int N>
+struct ValueStore<V, N, true>
+{
+    V &valueAt(int) { return value_; }
+    const V &valueAt(int) const { return value_; }
+    void moveValue(int, int) {}
+    static V value_;
+};
+
+template <typename V, int N>
+V ValueStore<V, N, true>::value_;
+} // namespace static_containers_detail
+
+/*
+ * Hash map with open addressing.
+ *
+ * Keys (and values) are stored densely in insertion order, so keyAt(i) /
+ * valueAt(i) iterate the map in the order entries were added, until the
+ * first erase (which moves the last entry into the hole). A power-of-two
+ * table, at least twice the capacity, holds index + 1 of each entry
+ * (0 = empty) and is searched with linear probing; erase uses backward
+ * shift deletion, so there are no tombstones.
+ */
+template <typename K, typename V, int N, typename Hash = FixedHash<K>>
+class FixedHashMap : private static_containers_detail::ValueStore<V, N>
+{
+    static_assert(N > 0 && N < 65535, "FixedHashMap capacity out of range");
+
+    typedef static_containers_detail::ValueStore<V, N> Store;
+    typedef typename std::conditional<(N < 255), uint8_t, uint16_t>::type Slot;
+
+    static constexpr int tableBits(int n, int bits = 1)
+    {
+        return (1 << bits) >= 2 * n ? bits : tableBits(n, bits + 1);
+    }
+
+    static constexpr int TableBits = tableBits(N);
+    static constexpr int TableSize = 1 << TableBits;
+
+public:
+    FixedHashMap() { clear(); }
+
+    FixedHashMap(const FixedHashMap &) = delete;
+    FixedHashMap &operator=(const FixedHashMap &) = delete;
+
+    static constexpr int capacity() { return N; }
+
+    int size() const { return keys_.size(); }
+    bool empty() const { return keys_.empty(); }
+    bool full() const { return keys_.full(); }
+
+    void clear()
+    {
+        memset(slots_, 0, sizeof(slots_));
+        keys_.clear();
+    }
+
+    bool contains(const K &key) const
+    {
+        return slots_[slotOf(key)] != 0;
+    }
+
+    V *find(const K &key)
+    {
+        Slot s = slots_[slotOf(key)];
+        return s ? &Store::valueAt(s - 1) : nullptr;
+    }
+
+    const V *find(const K &key) const
+    {
+        Slot s = slots_[slotOf(key)];
+        return s ? &Store::valueAt(s - 1) : nullptr;
+    }
+
+    // adds key, or updates its value; false only if the map is full
+    bool put(const K &key, const V &value = V())
+    {
+        int slot = slotOf(key);
+        if (slots_[slot] == 0)
+        {
+            if (!keys_.push_back(key))
+            {
+                return false;
+            }
+            slots_[slot] = keys_.size();
+        }
+        Store::valueAt(slots_[slot] - 1) = value;
+        return true;
+    }
+
+    // adds key only if absent; false if present or full
+    bool insert(const K &key, const V &value = V())
+    {
+        int slot = slotOf(key);
+        if (slots_[slot] != 0 || !keys_.push_back(key))
+        {
+            return false;
+        }
+        slots_[slot] = keys_.size();
+        Store::valueAt(slots_[slot] - 1) = value;
+        return true;
+    }
+
+    bool erase(const K &key)
+    {
+        int slot = slotOf(key);
+        if (slots_[slot] == 0)
+        {
+            return false;
+        }
+        int index = slots_[slot] - 1;
+        removeSlot(slot);
+
+        // move the last entry into the hole
+        int last = keys_.size() - 1;
+        if (index != last)
+        {
+            slots_[slotOf(keys_[last])] = index + 1;
+            keys_[index] = keys_[last];
+            Store::moveValue(index, last);
+        }
+        keys_.pop_back();
+        return true;
+    }
+
+    const K &keyAt(int index) const { return keys_[index]; }
+    V &valueAt(int index) { return Store::valueAt(index); }
+    const V &valueAt(int index) const { return Store::valueAt(index); }
+
+private:
+    static uint32_t bucket(const K &key)
+    {
+        return Hash()(key) >> (32 - TableBits);
+    }
+
+    // slot holding key, or the empty slot where it would go
+    int slotOf(const K &key) const
+    {
+        uint32_t i = bucket(key);
+        while (slots_[i] != 0 && !(keys_[slots_[i] - 1] == key))
+        {
+            i = (i + 1) & (TableSize - 1);
+        }
+        return i;
+    }
+
+    void removeSlot(int hole)
+    {
+        slots_[hole] = 0;
+        uint32_t i = hole;
+        for (;;)
+        {
+            i = (i + 1) & (TableSize - 1);
+            if (slots_[i] == 0)
+            {
+                return;
+            }
+            uint32_t home = bucket(keys_[slots_[i] - 1]);
+            // move the entry back if the hole lies between its home bucket and i
+            if (((i - home) & (TableSize - 1)) >= ((i - hole) & (TableSize - 1)))
+            {
+                slots_[hole] = slots_[i];
+                slots_[i] = 0;
+                hole = i;
+            }
+        }
+    }
+
+    StaticVector<K, N> keys_;
+    Slot slots_[TableSize];
+};
+
+/*
+ * Pool of N objects of type T with O(1) create/destroy.
+ * Free slots are chained through an index list; objects are constructed
+ * in place, so T needs no default constructor.
+ */
+template <typename T, int N>
+class ObjectPool
+{
+    static_assert(N > 0 && N < 65534, "ObjectPool capacity out of range");
+
+public:
+    ObjectPool() { reset(); }
+
+    ObjectPool(const ObjectPool &) = delete;
+    ObjectPool &operator=(const ObjectPool &) = delete;
+
+    static constexpr int capacity() { return N; }
+
+    int used() const { return used_; }
+    int available() const { return N - used_; }
+
+    // nullptr when the pool is exhausted
+    template <typename... Args>
+    T *create(Args &&...args)
+    {
+        if (freeHead_ == NONE)
+        {
+            return nullptr;
+        }
+        uint16_t index = freeHead_;
+        freeHead_ = next_[index];
+        next_[index] = USED;
+        used_++;
+        return new (&storage_[index]) T(std::forward<Args>(args)...);
+    }
+
+    // p must come from create() of this pool
+    void destroy(T *p)
+    {
+        if (p == nullptr)
+        {
+            return;
+        }
+        uint16_t index = (uint16_t)((Storage *)p - storage_);
+        p->~T();
+        next_[index] = freeHead_;
+        freeHead_ = index;
+        used_--;
+    }
+
+    bool owns(const T *p) const
+    {
+        const Storage *s = (const Storage *)p;
+        return s >= storage_ && s < storage_ + N && next_[s - storage_] == USED;
+    }
+
+private:
+    void reset()
+    {
+        for (int i = 0; i < N; i++)
+        {
+            next_[i] = (i + 1 < N) ? i + 1 : NONE;
+        }
+        freeHead_ = 0;
+        used_ = 0;
+    }
+
+    static const uint16_t NONE = 0xffff;
+    static const uint16_t USED = 0xfffe;
+
+    typedef typename std::aligned_storage<sizeof(T), alignof(T)>::type Storage;
+
+    Storage storage_[N];
+    uint16_t next_[N];
+    uint16_t freeHead_;
+    uint16_t used_;
+};
+
+#endif /* STATICCONTAINERS_H */
@@ -0,0 +1,53 @@
+#ifndef UARTDMARX_H
+#define UARTDMARX_H
+
+#include <Arduino.h>
+#include "UartDmaTx.h"
+
+// USART1 RX is served by DMA1 channel 5
+#define UART_RX_DMA_CHANNEL              DMA1_Channel5
+
+// must be a power of two
+#ifndef UART_RX_BUFFER_SIZE
+#define UART_RX_BUFFER_SIZE              256
+#endif
+
+/*
+ * UART receiver on a circular DMA channel.
+ *
+ * The DMA writes every received byte into a fixed ring; the write position
+ * is derived from the channel's remaining-count register, so there is no
+ * interrupt, no heap and no per-byte delay. The ring must hold everything
+ * that can arrive between two polls: 256 bytes are ~260 ms at 9600 baud.
+ *
+ * The port itself is configured by uartTx.begin(); call that first.
+ */
+class UartDmaRx
+{
+public:
+    UartDmaRx();
+
+    void begin();
+
+    // number of bytes waiting
+    size_t available() const;
+    // next byte, or -1 if nothing is waiting
+    int read();
+
+    // receiver overruns reported by the USART (bytes lost in hardware);
+    // samples the ORE flag, so poll it regularly
+    uint32_t overruns();
+
+    void printStats(Print &out);
+
+private:
+    size_t writePos() const;
+
+    uint8_t buffer_[UART_RX_BUFFER_SIZE];
+    uint32_t tail_;
+    uint32_t overruns_;
+};
+
+extern UartDmaRx uartRx;
+
+#endif /* UARTDMARX_H */
@@ -0,0 +1,106 @@
+#ifndef UARTDMATX_H
+#define UARTDMATX_H
+
+#include <Arduino.h>
+
+// USART1 on PA9 (TX) / PA10 (RX), TX served by DMA1 channel 4
+#define UART_PORT                        USART1
+#define UART_PORT_CLK                    RCC_APB2Periph_USART1
+#define UART_GPIO_PORT                   GPIOA
+#define UART_GPIO_CLK                    RCC_APB2Periph_GPIOA
+#define UART_TX_PIN                      GPIO_Pin_9
+#define UART_RX_PIN                      GPIO_Pin_10
+
+#define UART_TX_DMA_CHANNEL              DMA1_Channel4
+#define UART_TX_DMA_IRQn                 DMA1_Channel4_IRQn
+#define UART_TX_DMA_IT_TC                DMA1_IT_TC4
+#define UART_TX_DMA_IRQHandler           DMA1_Channel4_IRQHandler
+
+// must be a power of two
+#ifndef UART_TX_BUFFER_SIZE
+#define UART_TX_BUFFER_SIZE              512
+#endif
+
+/*
+ * Non-blocking UART transmitter.
+ *
+ * write() copies the message into a ring buffer and returns at once; the
+ * DMA channel drains the ring in the background and restarts itself from
+ * the transfer-complete interrupt. A message that does not fit into the
+ * free space is dropped as a whole and counted, so the RF loop never waits
+ * for the UART. A message written in several pieces (a report frame is
+ * header, payload and CRC) is bracketed by beginMessage()/endMessage() so
+ * it, too, is queued or dropped as a whole.
+ *
+ * There is exactly one instance, uartTx, because the DMA interrupt is
+ * bound to it.
+ */
+class UartDmaTx : public Print
+{
+public:
+    UartDmaTx();
+
+    // configures GPIO, USART (TX and RX) and the DMA channel
+    void begin(uint32_t baud);
+
+    size_t write(uint8_t c) override;
+    size_t write(const uint8_t *buffer, size_t size) override;
+    using Print::write;
+
+    /*
+     * The writes up to endMessage() form one message of size bytes: when
+     * it does not fit the free space now, all of them are dropped and
+     * counted as one message, and false is returned. A message larger
+     * than the whole ring cannot be reserved; its writes wait for the DMA
+     * instead, so send those only from cold paths. A message begun inside
+     * another one joins it: size must then be counted in the outer one.
+     */
+    bool beginMessage(size_t size);
+    void endMessage();
+
+    // bytes waiting in the ring, including the transfer in flight
+    size_t pending() const;
+    // block until everything queued has left the ring (not for the hot path)
+    void flush();
+
+    uint32_t bytesQueued() const { return bytesQueued_; }
+    uint32_t bytesSent() const { return bytesSent_; }
+    uint32_t bytesDropped() const { return bytesDropped_; }
+    uint32_t messagesDropped() const { return messagesDropped_; }
+    // average bytes per second sent since begin()
+    uint32_t throughput() const;
+
+    void printStats(Print &out) const;
+
+    // called from the DMA transfer-complete interrupt
+    void onTransferComplete();
+
+private:
+    enum MessageMode
+    {
+        MESSAGE_NONE,
+        MESSAGE_DROP,  // rest of the message is discarded
+        MESSAGE_BLOCK  // larger than the ring: writes wait for room
+    };
+
+    void kick();
+    void queue(const uint8_t *buffer, size_t size);
+
+    uint8_t buffer_[UART_TX_BUFFER_SIZE];
+    volatile uint32_t head_;  // written by write() only
+    volatile uint32_t tail_;  // written by the DMA interrupt only
+    volatile uint16_t dmaLen_;
+    volatile bool busy_;
+    MessageMode message_;
+    uint8_t messageDepth_;
+
+    uint32_t bytesQueued_;
+    volatile uint32_t bytesSent_;
+    uint32_t bytesDropped_;
+    uint32_t messagesDropped_;
+    uint32_t startMillis_;
+};
+
+extern UartDmaTx uartTx;
+
+#endif /* UARTDMATX_H */
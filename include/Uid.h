@@ -0,0 +1,97 @@
+#ifndef UID_H
+#define UID_H
+
+#include <stdint.h>
+#include <string.h>
+
+/*
+ * 64-bit ISO15693 UID.
+ *
+ * On the air a UID is sent LSB first, which is exactly the in-memory
+ * layout of a uint64_t on the (little endian) Cortex-M3. Uid wraps that
+ * value so frame builders can copy a UID with one 64-bit store instead of
+ * a byte loop, while byte(i) / fromBytes() keep the wire order explicit
+ * and usable in constant expressions.
+ *
+ * Uid is trivially copyable; containers and the event ring can hold it
+ * by value.
+ */
+class Uid
+{
+public:
+    static constexpr int LENGTH = 8;
+
+    constexpr Uid() : value_(0) {}
+    constexpr explicit Uid(uint64_t value) : value_(value) {}
+
+    // decode LSB-first wire bytes
+    static constexpr Uid fromBytes(const uint8_t *b)
+    {
+        return Uid((uint64_t)b[0] | ((uint64_t)b[1] << 8) | ((uint64_t)b[2] << 16) | ((uint64_t)b[3] << 24) |
+                   ((uint64_t)b[4] << 32) | ((uint64_t)b[5] << 40) | ((uint64_t)b[6] << 48) | ((uint64_t)b[7] << 56));
+    }
+
+    // i-th byte in wire order (0 = least significant)
+    constexpr uint8_t byte(int i) const
+    {
+        return (uint8_t)(value_ >> (8 * i));
+    }
+
+    constexpr uint64_t value() const
+    {
+        return value_;
+    }
+
+    // encode LSB first into out[0..7]
+    void toBytes(uint8_t *out) const
+    {
+#if defined(__BYTE_ORDER__) && (__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__)
+        memcpy(out, &value_, LENGTH);
+#else
+        for (int i = 0; i < LENGTH; i++)
+        {
+            out[i] = byte(i);
+        }
+#endif
+    }
+
+    constexpr bool operator==(const Uid &oth) const { return value_ == oth.value_; }
+    constexpr bool operator!=(const Uid &oth) const { return value_ != oth.value_; }
+    constexpr bool operator<(const Uid &oth) const { return value_ < oth.value_; }
+
+    // fold to 32 bits, then Fibonacci hashing
+    constexpr uint32_t hash() const
+    {
+        return ((uint32_t)value_ ^ (uint32_t)(value_ >> 32)) * 0x9E3779B1u;
+    }
+
+    /*
+     * 16 hex digits, most significant byte first (the way UIDs are printed
+     * on labels), plus terminator: out must hold 17 chars.
+     */
+    char *toHex(char *out) const
+    {
+        static const char hexChar[] = "0123456789ABCDEF";
+        uint64_t v = value_;
+        for (int i = 15; i >= 0; i--)
+        {
+            out[i] = hexChar[v & 0x0f];
+            v >>= 4;
+        }
+        out[16] = '\0';
+        return out;
+    }
+
+private:
+    uint64_t value_;
+};
+
+struct UidHash
+{
+    uint32_t operator()(const Uid &uid) const
+    {
+        return uid.hash();
+    }
+};
+
+#endif /* UID_H */
@@ -0,0 +1,114 @@
+#ifndef GPIOPIN_H
+#define GPIOPIN_H
+
+#include <stdint.h>
+#include "stm32f10x.h"
+#include "stm32f10x_gpio.h"
+#include "stm32f10x_rcc.h"
+
+/*
+ * A GPIO pin bound at compile time.
+ *
+ * Port base address and pin number are template parameters, so high()
+ * and low() inline to a single store to BSRR / BRR with a constant mask,
+ * and read() to one IDR load. Configuration still goes through the SPL;
+ * it only runs at init.
+ *
+ *   typedef GpioPin<GPIOB_BASE, 11> RstPin;
+ *   RstPin::output();
+ *   RstPin::low();
+ */
+template <uint32_t PortBase, uint8_t Pin>
+struct GpioPin
+{
+    static_assert(Pin < 16, "GPIO pin out of range");
+    static_assert(PortBase >= GPIOA_BASE && PortBase <= GPIOG_BASE && (PortBase - GPIOA_BASE) % 0x400 == 0,
+                  "not a GPIO port base address");
+
+    static constexpr bool PRESENT = true;
+    static constexpr uint8_t PIN = Pin;
+    static constexpr uint16_t MASK = (uint16_t)(1u << Pin);
+
+    // GPIO_PortSourceGPIOx and RCC_APB2Periph_GPIOx of this port
+    static constexpr uint8_t PORT_SOURCE = (uint8_t)((PortBase - GPIOA_BASE) / 0x400);
+    static constexpr uint32_t CLK = RCC_APB2Periph_GPIOA << PORT_SOURCE;
+
+    // EXTI line of this pin and the vector serving it
+    static constexpr uint32_t EXTI_LINE = MASK;
+    static constexpr uint8_t EXTI_IRQN = (Pin < 5) ? (uint8_t)(EXTI0_IRQn + Pin)
+                                         : (Pin < 10) ? (uint8_t)EXTI9_5_IRQn
+                                                      : (uint8_t)EXTI15_10_IRQn;
+
+    static GPIO_TypeDef *port()
+    {
+        return (GPIO_TypeDef *)PortBase;
+    }
+
+    static void high()
+    {
+        port()->BSRR = MASK;
+    }
+
+    static void low()
+    {
+        port()->BRR = MASK;
+    }
+
+    static void write(bool level)
+    {
+        if (level)
+        {
+            high();
+        }
+        else
+        {
+            low();
+        }
+    }
+
+    static bool read()
+    {
+        return (port()->IDR & MASK) != 0;
+    }
+
+    // enables the port clock, then configures the pin
+    static void mode(GPIOMode_TypeDef mode, GPIOSpeed_TypeDef speed = GPIO_Speed_2MHz)
+    {
+        GPIO_InitTypeDef GPIO_InitStructure;
+
+        RCC_APB2PeriphClockCmd(CLK, ENABLE);
+        GPIO_InitStructure.GPIO_Pin = MASK;
+        GPIO_InitStructure.GPIO_Mode = mode;
+        GPIO_InitStructure.GPIO_Speed = speed;
+        GPIO_Init(port(), &GPIO_InitStructure);
+    }
+
+    static void output()
+    {
+        mode(GPIO_Mode_Out_PP);
+    }
+};
+
+/*
+ * Placeholder for an optional pin that is not wired. Every operation is a
+ * no-op; drivers test PRESENT to pick a fallback.
+ */
+struct NoPin
+{
+    static constexpr bool PRESENT = false;
+    static constexpr uint8_t PIN = 0;
+    static constexpr uint16_t MASK = 0;
+    static constexpr uint8_t PORT_SOURCE = 0;
+    static constexpr uint32_t CLK = 0;
+    static constexpr uint32_t EXTI_LINE = 0;
+    static constexpr uint8_t EXTI_IRQN = 0;
+
+    static void high() {}
+    static void low() {}
+    static void write(bool) {}
+    static bool read() { return false; }
+    static void mode(GPIOMode_TypeDef, GPIOSpeed_TypeDef = GPIO_Speed_2MHz) {}
+    static void output() {}
+};
+
+#endif /* GPIOPIN_H */
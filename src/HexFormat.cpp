@@ -0,0 +1,24 @@
+#include <Arduino.h>
+#include "HexFormat.h"
+#include "ReportProtocol.h"
+
+size_t hexDump(Print &out, const uint8_t *data, size_t len, char sep)
+{
+    char buf[HEX_ENCODED_LEN(HEX_DUMP_CHUNK, 1) + 1];
+    size_t written = 0;
+
+    if (!reportBeginMessage(out, HEX_ENCODED_LEN(len, sep)))
+    {
+        len = 0; // dropped: nothing to encode
+    }
+    while (len > 0)
+    {
+        size_t chunk = (len < HEX_DUMP_CHUNK) ? len : HEX_DUMP_CHUNK;
+        size_t n = hexEncode(buf, data, chunk, sep);
+        written += out.write((const uint8_t *)buf, n);
+        data += chunk;
+        len -= chunk;
+    }
+    reportEndMessage(out);
+    return written;
+}
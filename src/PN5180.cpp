@@ -21,6 +21,8 @@
 #include <Arduino.h>
 #include "PN5180.h"
 #include "PN5180Debug.h"
+#include "PN5180Profile.h"
+#include "PN5180Capture.h"
 
 // PN5180 1-Byte Direct Commands
 // see 11.4.3.3 Host Interface Command List
@@ -61,6 +63,7 @@ void PN5180::begin()
     digitalWrite(PN5180_NSS, HIGH); // disable
 
     SPI.begin();
+    PN5180PROFILE_BEGIN();
     PN5180DEBUG(F("SPI pinout: "));
     PN5180DEBUG(F("SS="));
     PN5180DEBUG(SS);
@@ -89,16 +92,7 @@ bool PN5180::writeRegister(uint8_t reg, uint32_t value)
 {
     uint8_t *p = (uint8_t *)&value;
 
-#ifdef DEBUG
-    PN5180DEBUG(F("Write Register 0x"));
-    PN5180DEBUG(formatHex(reg));
-    PN5180DEBUG(F(", value (LSB first)=0x"));
-    for (int i = 0; i < 4; i++)
-    {
-        PN5180DEBUG(formatHex(p[i]));
-    }
-    PN5180DEBUG("\n");
-#endif
+    PN5180TRACE(PN5180_LOG_DEBUG, PN5180_TRACE_WRITE_REG, reg, 0, value);
 
     /*
   For all 4 byte command parameter transfers (e.g. register values), the payload
@@ -125,16 +119,7 @@ bool PN5180::writeRegisterWithOrMask(uint8_t reg, uint32_t mask)
 {
     uint8_t *p = (uint8_t *)&mask;
 
-#ifdef DEBUG
-    PN5180DEBUG(F("Write Register 0x"));
-    PN5180DEBUG(formatHex(reg));
-    PN5180DEBUG(F(" with OR mask (LSB first)=0x"));
-    for (int i = 0; i < 4; i++)
-    {
-        PN5180DEBUG(formatHex(p[i]));
-    }
-    PN5180DEBUG("\n");
-#endif
+    PN5180TRACE(PN5180_LOG_DEBUG, PN5180_TRACE_WRITE_REG_OR, reg, 0, mask);
 
     uint8_t buf[6] = {PN5180_WRITE_REGISTER_OR_MASK, reg, p[0], p[1], p[2], p[3]};
 
@@ -157,16 +142,7 @@ bool PN5180::writeRegisterWithAndMask(uint8_t reg, uint32_t mask)
 {
     uint8_t *p = (uint8_t *)&mask;
 
-#ifdef DEBUG
-    PN5180DEBUG(F("Write Register 0x"));
-    PN5180DEBUG(formatHex(reg));
-    PN5180DEBUG(F(" with AND mask (LSB first)=0x"));
-    for (int i = 0; i < 4; i++)
-    {
-        PN5180DEBUG(formatHex(p[i]));
-    }
-    PN5180DEBUG("\n");
-#endif
+    PN5180TRACE(PN5180_LOG_DEBUG, PN5180_TRACE_WRITE_REG_AND, reg, 0, mask);
 
     uint8_t buf[6] = {PN5180_WRITE_REGISTER_AND_MASK, reg, p[0], p[1], p[2], p[3]};
 
@@ -186,19 +162,13 @@ bool PN5180::writeRegisterWithAndMask(uint8_t reg, uint32_t mask)
  */
 bool PN5180::readRegister(uint8_t reg, uint32_t *value)
 {
-    PN5180DEBUG(F("Reading register 0x"));
-    PN5180DEBUG(formatHex(reg));
-    PN5180DEBUG(F("...\n"));
-
     uint8_t cmd[2] = {PN5180_READ_REGISTER, reg};
 
     SPI.beginTransaction(PN5180_SPI_SETTINGS);
     transceiveCommand(cmd, 2, (uint8_t *)value, 4);
     SPI.endTransaction();
 
-    PN5180DEBUG(F("Register value=0x"));
-    PN5180DEBUG(formatHex(*value));
-    PN5180DEBUG("\n");
+    PN5180TRACE(PN5180_LOG_DEBUG, PN5180_TRACE_READ_REG, reg, 0, *value);
 
     return true;
 }
@@ -218,30 +188,25 @@ bool PN5180::readEEprom(uint8_t addr, uint8_t *buffer, uint8_t len)
 {
     if ((addr > 254) || ((addr + len) > 254))
     {
-        PN5180DEBUG(F("ERROR: Reading beyond addr 254!\n"));
+        PN5180ERROR(F("ERROR: Reading beyond addr 254!\n"));
         return false;
     }
 
-    PN5180DEBUG(F("Reading EEPROM at 0x"));
-    PN5180DEBUG(formatHex(addr));
-    PN5180DEBUG(F(", size="));
-    PN5180DEBUG(len);
-    PN5180DEBUG(F("...\n"));
-
     uint8_t cmd[3] = {PN5180_READ_EEPROM, addr, len};
 
     SPI.beginTransaction(PN5180_SPI_SETTINGS);
     transceiveCommand(cmd, 3, buffer, len);
     SPI.endTransaction();
 
-#ifdef DEBUG
-    PN5180DEBUG(F("EEPROM values: "));
+    PN5180TRACE(PN5180_LOG_DEBUG, PN5180_TRACE_READ_EEPROM, addr, len, 0);
+#if PN5180_LOG_ON(PN5180_LOG_INFO)
+    PN5180LOG(PN5180_LOG_INFO, F("EEPROM values: "));
     for (int i = 0; i < len; i++)
     {
-        PN5180DEBUG(formatHex(buffer[i]));
-        PN5180DEBUG(" ");
+        PN5180LOG(PN5180_LOG_INFO, formatHex(buffer[i]));
+        PN5180LOG(PN5180_LOG_INFO, " ");
     }
-    PN5180DEBUG("\n");
+    PN5180LOG(PN5180_LOG_INFO, "\n");
 #endif
 
     return true;
@@ -266,21 +231,11 @@ bool PN5180::sendData(uint8_t *data, uint8_t len, uint8_t validBits)
 {
     if (len > 260)
     {
-        PN5180DEBUG(F("ERROR: sendData with more than 260 bytes is not supported!\n"));
+        PN5180ERROR(F("ERROR: sendData with more than 260 bytes is not supported!\n"));
         return false;
     }
 
-#ifdef DEBUG
-    PN5180DEBUG(F("Send data (len="));
-    PN5180DEBUG(len);
-    PN5180DEBUG(F("):"));
-    for (int i = 0; i < len; i++)
-    {
-        PN5180DEBUG(" ");
-        PN5180DEBUG(formatHex(data[i]));
-    }
-    PN5180DEBUG("\n");
-#endif
+    PN5180TRACE(PN5180_LOG_DEBUG, PN5180_TRACE_SEND_DATA, validBits, len, traceHead(data, len));
 
     uint8_t buffer[len + 2];
     buffer[0] = PN5180_SEND_DATA;
@@ -304,7 +259,7 @@ bool PN5180::sendData(uint8_t *data, uint8_t len, uint8_t validBits)
     PN5180TransceiveStat transceiveState = getTransceiveState();
     if (PN5180_TS_WaitTransmit != transceiveState)
     {
-        PN5180DEBUG(F("*** ERROR: Transceiver not in state WaitTransmit!?\n"));
+        PN5180ERROR(F("*** ERROR: Transceiver not in state WaitTransmit!?\n"));
         return false;
     }
 
@@ -317,7 +272,6 @@ bool PN5180::sendData(uint8_t *data, uint8_t len, uint8_t validBits)
 
 bool PN5180::activeTypeA(uint8_t *buffer, uint8_t kind)
 {
-    char print_buf[64];
     uint8_t cmd[7];
     loadRFConfig(0x00, 0x80);
     writeRegisterWithAndMask(CRC_RX_CONFIG, 0xfffffffe);
@@ -325,22 +279,10 @@ bool PN5180::activeTypeA(uint8_t *buffer, uint8_t kind)
     cmd[0] = (kind == 0) ? 0x26 : 0x52;
     sendData(cmd, 1, 0x07);
     readData(2, buffer);
-    for (int i = 0; i < 10; i++)
-    {
-        sprintf(print_buf, "%02X ", buffer[i]);
-        Serial.print(print_buf);
-    }
-     Serial.println();
     cmd[0] = 0x93;
     cmd[1] = 0x20;
     sendData(cmd, 2, 0x00);
     readData(5, cmd + 2);
-     for (int i = 0; i < 7; i++)
-    {
-        sprintf(print_buf, "%02X ", cmd[i]);
-        Serial.print(print_buf);
-    }
-      Serial.println();
     writeRegisterWithAndMask(CRC_RX_CONFIG, 0x1);
     writeRegisterWithOrMask(CRC_TX_CONFIG, 0x1);
     cmd[0] = 0x93;
@@ -397,7 +339,7 @@ uint8_t *PN5180::readData(uint16_t len)
 {
     if (len > 508)
     {
-        Serial.println(F("*** FATAL: Reading more than 508 bytes is not supported!"));
+        PN5180ERROR(F("*** FATAL: Reading more than 508 bytes is not supported!\n"));
         return 0L;
     }
 
@@ -411,15 +353,7 @@ uint8_t *PN5180::readData(uint16_t len)
     transceiveCommand(cmd, 2, readBuffer, len);
     SPI.endTransaction();
 
-#ifdef DEBUG
-    PN5180DEBUG(F("Data read: "));
-    for (int i = 0; i < len; i++)
-    {
-        PN5180DEBUG(formatHex(readBuffer[i]));
-        PN5180DEBUG(" ");
-    }
-    PN5180DEBUG("\n");
-#endif
+    PN5180TRACE(PN5180_LOG_DEBUG, PN5180_TRACE_READ_DATA, 0, len, traceHead(readBuffer, len));
 
     return readBuffer;
 }
@@ -454,11 +388,7 @@ bool PN5180::readData(uint16_t len, uint8_t *buffer)
  */
 bool PN5180::loadRFConfig(uint8_t txConf, uint8_t rxConf)
 {
-    PN5180DEBUG(F("Load RF-Config: txConf="));
-    PN5180DEBUG(formatHex(txConf));
-    PN5180DEBUG(F(", rxConf="));
-    PN5180DEBUG(formatHex(rxConf));
-    PN5180DEBUG("\n");
+    PN5180TRACE(PN5180_LOG_DEBUG, PN5180_TRACE_LOAD_RF_CONFIG, txConf, 0, rxConf);
 
     uint8_t cmd[3] = {PN5180_LOAD_RF_CONFIG, txConf, rxConf};
 
@@ -476,7 +406,7 @@ bool PN5180::loadRFConfig(uint8_t txConf, uint8_t rxConf)
  */
 bool PN5180::setRF_on()
 {
-    PN5180DEBUG(F("Set RF ON\n"));
+    PN5180TRACE(PN5180_LOG_DEBUG, PN5180_TRACE_RF_ON, 0, 0, 0);
 
     uint8_t cmd[2] = {PN5180_RF_ON, 0x00};
 
@@ -484,8 +414,15 @@ bool PN5180::setRF_on()
     transceiveCommand(cmd, 2);
     SPI.endTransaction();
 
+    // no TX_RFON_IRQ when the field is already on, so the wait is bounded
+    uint32_t start = millis();
     while (0 == (TX_RFON_IRQ_STAT & getIRQStatus()))
-        ; // wait for RF field to set up
+    { // wait for RF field to set up
+        if (millis() - start > PN5180_RF_TIMEOUT_MS)
+        {
+            return false;
+        }
+    }
     clearIRQStatus(TX_RFON_IRQ_STAT);
     return true;
 }
@@ -497,7 +434,7 @@ bool PN5180::setRF_on()
  */
 bool PN5180::setRF_off()
 {
-    PN5180DEBUG(F("Set RF OFF\n"));
+    PN5180TRACE(PN5180_LOG_DEBUG, PN5180_TRACE_RF_OFF, 0, 0, 0);
 
     uint8_t cmd[2]{PN5180_RF_OFF, 0x00};
 
@@ -505,8 +442,14 @@ bool PN5180::setRF_off()
     transceiveCommand(cmd, 2);
     SPI.endTransaction();
 
+    uint32_t start = millis();
     while (0 == (TX_RFOFF_IRQ_STAT & getIRQStatus()))
-        ; // wait for RF field to shut down
+    { // wait for RF field to shut down
+        if (millis() - start > PN5180_RF_TIMEOUT_MS)
+        {
+            return false;
+        }
+    }
     clearIRQStatus(TX_RFOFF_IRQ_STAT);
     return true;
 }
@@ -551,25 +494,20 @@ status register contain information on the exception.
  */
 bool PN5180::transceiveCommand(uint8_t *sendBuffer, size_t sendBufferLen, uint8_t *recvBuffer, size_t recvBufferLen)
 {
-#ifdef DEBUG
-    PN5180DEBUG(F("Sending SPI frame: '"));
-    for (uint8_t i = 0; i < sendBufferLen; i++)
-    {
-        if (i > 0)
-            PN5180DEBUG(" ");
-        PN5180DEBUG(formatHex(sendBuffer[i]));
-    }
-    PN5180DEBUG("'\n");
-#endif
+    PN5180TRACE(PN5180_LOG_VERBOSE, PN5180_TRACE_SPI_FRAME, sendBuffer[0], sendBufferLen, recvBufferLen);
+    PN5180PROFILE_SCOPE(PN5180_PROF_COMMAND(sendBuffer[0]));
 
     // 0.
+    PN5180PROFILE_START(busyStart);
     while (LOW != digitalRead(PN5180_BUSY))
         ; // wait until busy is low
+    PN5180PROFILE_STOP(PN5180_PROF_BUSY_WAIT, busyStart);
     // 1.
+    PN5180PROFILE_START(frameStart);
     digitalWrite(PN5180_NSS, LOW);
     delay(2);
     // 2.
-    for (uint8_t i = 0; i < sendBufferLen; i++)
+    for (size_t i = 0; i < sendBufferLen; i++)
     {
         SPI.transfer(sendBuffer[i]);
     }
@@ -578,22 +516,27 @@ bool PN5180::transceiveCommand(uint8_t *sendBuffer, size_t sendBufferLen, uint8_
         ; // wait until BUSY is high
     // 4.
     digitalWrite(PN5180_NSS, HIGH);
+    PN5180PROFILE_STOP(PN5180_PROF_SPI_FRAME, frameStart);
+    PN5180CAPTURE_MARK(sent);
     delay(1);
     // 5.
+    PN5180PROFILE_START(idleStart);
     while (LOW != digitalRead(PN5180_BUSY))
         ; // wait unitl BUSY is low
+    PN5180PROFILE_STOP(PN5180_PROF_BUSY_WAIT, idleStart);
+    PN5180CAPTURE(0, sendBuffer, sendBufferLen, sent);
 
     // check, if write-only
     //
     if ((0 == recvBuffer) || (0 == recvBufferLen))
         return true;
-    PN5180DEBUG(F("Receiving SPI frame...\n"));
 
     // 1.
+    PN5180PROFILE_START(readStart);
     digitalWrite(PN5180_NSS, LOW);
     delay(2);
     // 2.
-    for (uint8_t i = 0; i < recvBufferLen; i++)
+    for (size_t i = 0; i < recvBufferLen; i++)
     {
         recvBuffer[i] = SPI.transfer(0xff);
     }
@@ -602,21 +545,15 @@ bool PN5180::transceiveCommand(uint8_t *sendBuffer, size_t sendBufferLen, uint8_
         ; // wait until BUSY is high
     // 4.
     digitalWrite(PN5180_NSS, HIGH);
+    PN5180PROFILE_STOP(PN5180_PROF_SPI_FRAME, readStart);
+    PN5180CAPTURE_MARK(read);
     delay(1);
     // 5.
+    PN5180PROFILE_START(readIdleStart);
     while (LOW != digitalRead(PN5180_BUSY))
         ; // wait until BUSY is low
-
-#ifdef DEBUG
-    PN5180DEBUG(F("Received: "));
-    for (uint8_t i = 0; i < recvBufferLen; i++)
-    {
-        if (i > 0)
-            PN5180DEBUG(" ");
-        PN5180DEBUG(formatHex(recvBuffer[i]));
-    }
-    PN5180DEBUG("'\n");
-#endif
+    PN5180PROFILE_STOP(PN5180_PROF_BUSY_WAIT, readIdleStart);
+    PN5180CAPTURE(REPORT_CAPTURE_MISO, recvBuffer, recvBufferLen, read);
 
     return true;
 }
@@ -643,45 +580,26 @@ void PN5180::reset()
  */
 uint32_t PN5180::getIRQStatus()
 {
-    PN5180DEBUG(F("Read IRQ-Status register...\n"));
-
     uint32_t irqStatus;
     readRegister(IRQ_STATUS, &irqStatus);
 
-    PN5180DEBUG(F("IRQ-Status=0x"));
-    PN5180DEBUG(formatHex(irqStatus));
-    PN5180DEBUG("\n");
-
     return irqStatus;
 }
 
 bool PN5180::clearIRQStatus(uint32_t irqMask)
 {
-    PN5180DEBUG(F("Clear IRQ-Status with mask=x"));
-    PN5180DEBUG(formatHex(irqMask));
-    PN5180DEBUG("\n");
-
     return writeRegister(IRQ_CLEAR, irqMask);
 }
 
 /*
  * Get TRANSCEIVE_STATE from RF_STATUS register
  */
-#ifdef DEBUG
-extern void showIRQStatus(uint32_t);
-#endif
-
 PN5180TransceiveStat PN5180::getTransceiveState()
 {
-    PN5180DEBUG(F("Get Transceive state...\n"));
-
     uint32_t rfStatus;
     if (!readRegister(RF_STATUS, &rfStatus))
     {
-#ifdef DEBUG
-        showIRQStatus(getIRQStatus());
-#endif
-        PN5180DEBUG(F("ERROR reading RF_STATUS register.\n"));
+        PN5180ERROR(F("ERROR reading RF_STATUS register.\n"));
         return PN5180TransceiveStat(0);
     }
 
@@ -697,56 +615,61 @@ PN5180TransceiveStat PN5180::getTransceiveState()
    *  7 - reserved
    */
     uint8_t state = ((rfStatus >> 24) & 0x07);
-    PN5180DEBUG(F("TRANSCEIVE_STATE=0x"));
-    PN5180DEBUG(formatHex(state));
-    PN5180DEBUG("\n");
-
     return PN5180TransceiveStat(state);
 }
 
+/*
+ * The caller's wait used to be the interval between two RX_STATUS length
+ * reads, repeated until the length stopped changing; RX_IRQ marks the end
+ * of reception exactly, so wait now only scales the deadline (the old
+ * loop gave up after 10 rounds of two waits). Answers are capped at 255
+ * bytes as before.
+ */
 uint8_t PN5180::finitepiSendData(uint8_t *params, uint16_t len, uint8_t *buffer, uint8_t wait)
 {
-    uint8_t retry = 10;
-    uint8_t cmd[2];
-    uint8_t respLen1 = 0;
-    uint8_t respLen2 = 0;
-    cmd[0] = PN5180_SEND_DATA;
-    cmd[1] = 0;
+    int16_t received = transceive(params, len, buffer, 0xff, 0, 0, 20 * (uint16_t)wait);
+    if (PN5180_TRANSCEIVE_FAILED == received)
+    {
+        return -1;
+    }
+    if (received < 0)
+    {
+        return 0;
+    }
+    return (received > 0xff) ? 0xff : received;
+}
 
-    writeRegisterWithAndMask(SYSTEM_CONFIG, 0xfffffff8); // Idle/StopCom Command
-    writeRegisterWithOrMask(SYSTEM_CONFIG, 0x00000003);  // Transceive Command
+int16_t PN5180::transceive(uint8_t *tx, uint8_t txLen, uint8_t *rx, uint16_t rxMax, uint32_t *rxStatus,
+                           uint8_t validBits, uint16_t timeoutMs)
+{
+    PN5180PROFILE_SCOPE(PN5180_PROF_RF_EXCHANGE);
+    clearIRQStatus(RX_IRQ_STAT | TX_IRQ_STAT | IDLE_IRQ_STAT | RX_SOF_DET_IRQ_STAT);
+    if (!sendData(tx, txLen, validBits))
+    {
+        return PN5180_TRANSCEIVE_FAILED;
+    }
 
-    PN5180TransceiveStat stat = getTransceiveState();
-    if (PN5180_TS_WaitTransmit == stat)
+    uint32_t start = millis();
+    while (0 == (RX_IRQ_STAT & getIRQStatus()))
     {
-        SPI.beginTransaction(PN5180_SPI_SETTINGS);
-        sendData(params, len);
-        // transceiveCommand(params, len);
-        SPI.endTransaction();
-        do
+        if (millis() - start > timeoutMs)
         {
-            delay(wait);
-            respLen1 = rxByteReceived();
-       
-            delay(wait);
-            respLen2 = rxByteReceived();
-        
-            retry--;
-        } while ((retry > 0) && (respLen1 != respLen2));
-        if (respLen1 > 0)
-        {
-            readData(respLen1, buffer);
+            return PN5180_TRANSCEIVE_NO_ANSWER;
         }
-        return respLen1;
     }
-    return -1;
-}
 
-uint8_t PN5180::rxByteReceived()
-{
-    uint8_t len;
-    uint32_t rxStatus;
-    readRegister(RX_STATUS, &rxStatus);
-    len = rxStatus & 0x1ff;
+    uint32_t status;
+    readRegister(RX_STATUS, &status);
+    if (rxStatus)
+    {
+        *rxStatus = status;
+    }
+
+    uint16_t len = status & RX_BYTES_RECEIVED_MASK;
+    uint16_t n = (len < rxMax) ? len : rxMax;
+    if (n > 0)
+    {
+        readData(n, rx);
+    }
     return len;
-}
\ No newline at end of file
+}
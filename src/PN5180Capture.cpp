@@ -0,0 +1,75 @@
+// NAME: PN5180Capture.cpp
+//
+// DESC: SPI frame recorder for the PN5180 host interface.
+//
+// This file is part of the PN5180 library for the Arduino environment.
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// Lesser General Public License for more details.
+//
+#include <Arduino.h>
+#include "PN5180Capture.h"
+
+#ifdef PN5180_CAPTURE
+PN5180CaptureRing pn5180Capture;
+
+void PN5180CaptureRing::record(uint8_t flags, const uint8_t *data, uint16_t len, uint32_t busyUs)
+{
+    uint32_t need = REPORT_CAPTURE_HEADER_LEN + len;
+    if ((need > PN5180_CAPTURE_SIZE) || (need > PN5180_CAPTURE_MAX_RECORD))
+    {
+        dropped_++;
+        return;
+    }
+
+    // make room by dropping the oldest records
+    while (PN5180_CAPTURE_SIZE - (head_ - tail_) < need)
+    {
+        tail_ += recordLength(tail_);
+        dropped_++;
+    }
+
+    uint16_t busy = (busyUs > 0xffff) ? 0xffff : busyUs;
+    uint8_t header[REPORT_CAPTURE_HEADER_LEN] = {flags, (uint8_t)(len & 0xff), (uint8_t)(len >> 8),
+                                                 (uint8_t)(busy & 0xff), (uint8_t)(busy >> 8)};
+    for (uint8_t i = 0; i < REPORT_CAPTURE_HEADER_LEN; i++)
+    {
+        buffer_[head_++ & (PN5180_CAPTURE_SIZE - 1)] = header[i];
+    }
+    for (uint16_t i = 0; i < len; i++)
+    {
+        buffer_[head_++ & (PN5180_CAPTURE_SIZE - 1)] = data[i];
+    }
+}
+
+uint8_t PN5180CaptureRing::dump(Print &out)
+{
+    uint8_t frames = 0;
+    do
+    {
+        // whole records up to one frame's payload
+        uint32_t end = tail_;
+        while ((end != head_) && (end - tail_ + recordLength(end) <= PN5180_CAPTURE_MAX_RECORD))
+        {
+            end += recordLength(end);
+        }
+
+        uint32_t offset = tail_ & (PN5180_CAPTURE_SIZE - 1);
+        uint16_t len = end - tail_;
+        uint16_t first = (offset + len > PN5180_CAPTURE_SIZE) ? PN5180_CAPTURE_SIZE - offset : len;
+        reportCapture(out, dropped_, buffer_ + offset, first, buffer_, len - first);
+        tail_ = end;
+        dropped_ = 0;
+        frames++;
+        reportFrameSent(out);
+    } while (tail_ != head_);
+    return frames;
+}
+#endif
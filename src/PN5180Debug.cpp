@@ -18,31 +18,47 @@
 //
 #include <inttypes.h>
 #include "PN5180Debug.h"
+#include "HexFormat.h"
+#include "ReportProtocol.h"
 
-static const char hexChar[] = "0123456789ABCDEF";
+Print *pn5180LogOut = &Serial;
+
+// shared buffer: fine for the DEBUG prints, reentrant code uses HexFormat.h
 static char hexBuffer[9];
 
 char * formatHex(const uint8_t val) {
-  hexBuffer[0] = hexChar[val >> 4];
-  hexBuffer[1] = hexChar[val & 0x0f];
-  hexBuffer[2] = '\0';
+  hexEncodeWord(hexBuffer, val, 2);
   return hexBuffer;
 }
 
 char * formatHex(const uint16_t val) {
-  hexBuffer[0] = hexChar[(val >> 12) & 0x0f];
-  hexBuffer[1] = hexChar[(val >> 8) & 0x0f];
-  hexBuffer[2] = hexChar[(val >> 4) & 0x0f];
-  hexBuffer[3] = hexChar[val & 0x0f];
-  hexBuffer[4] = '\0';
+  hexEncodeWord(hexBuffer, val, 4);
   return hexBuffer;
 }
 
 char * formatHex(uint32_t val) {
-  for (int i=7; i>=0; i--) {
-    hexBuffer[i] = hexChar[val & 0x0f];
-    val = val >> 4;
-  }
-  hexBuffer[8] = '\0';
+  hexEncodeWord(hexBuffer, val, 8);
   return hexBuffer;
 }
+
+#if PN5180_TRACE_USED
+PN5180TraceRing pn5180Trace;
+
+uint32_t pn5180TraceDrain(Print &out) {
+  PN5180TraceRecord batch[PN5180_TRACE_BATCH];
+  uint32_t sent = 0;
+  uint8_t n;
+  do {
+    n = 0;
+    while ((n < PN5180_TRACE_BATCH) && pn5180Trace.pop(batch[n])) {
+      n++;
+    }
+    if ((n > 0) || (sent == 0)) {
+      reportTrace(out, batch, n, pn5180Trace.overflows());
+      reportFrameSent(out); // a full ring is 4 frames of 203 bytes
+    }
+    sent += n;
+  } while (n == PN5180_TRACE_BATCH);
+  return sent;
+}
+#endif
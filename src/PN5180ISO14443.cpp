@@ -0,0 +1,298 @@
+// NAME: PN5180ISO14443.cpp
+//
+// DESC: ISO14443A activation and anticollision on NXP Semiconductors PN5180 module for Arduino.
+//
+// This file is part of the PN5180 library for the Arduino environment.
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// Lesser General Public License for more details.
+//
+#include <Arduino.h>
+#include "PN5180ISO14443.h"
+
+PN5180ISO14443::PN5180ISO14443(uint8_t SSpin, uint8_t BUSYpin, uint8_t RSTpin)
+    : PN5180(SSpin, BUSYpin, RSTpin), crcRxConfig_(0), crcTxConfig_(0), crcCached_(false)
+{
+}
+
+bool PN5180ISO14443::setupRF()
+{
+    if (!loadRFConfig(0x00, 0x80))
+    { // ISO14443A 106 kbit/s
+        return false;
+    }
+    if (!setRF_on())
+    {
+        return false;
+    }
+
+    // LOAD_RF_CONFIG rewrote the CRC registers
+    readRegister(CRC_RX_CONFIG, &crcRxConfig_);
+    readRegister(CRC_TX_CONFIG, &crcTxConfig_);
+    crcCached_ = true;
+    return true;
+}
+
+void PN5180ISO14443::setFraming(bool crc, uint8_t rxAlign)
+{
+    if (!crcCached_)
+    {
+        readRegister(CRC_RX_CONFIG, &crcRxConfig_);
+        readRegister(CRC_TX_CONFIG, &crcTxConfig_);
+        crcCached_ = true;
+    }
+
+    uint32_t rxConfig = (crcRxConfig_ & ~(uint32_t)(RX_CRC_ENABLE | RX_BIT_ALIGN_MASK)) |
+                        (crc ? RX_CRC_ENABLE : 0) | ((uint32_t)(rxAlign & 0x07) << RX_BIT_ALIGN_SHIFT);
+    uint32_t txConfig = (crcTxConfig_ & ~(uint32_t)TX_CRC_ENABLE) | (crc ? TX_CRC_ENABLE : 0);
+
+    if (rxConfig != crcRxConfig_)
+    {
+        writeRegister(CRC_RX_CONFIG, rxConfig);
+        crcRxConfig_ = rxConfig;
+    }
+    if (txConfig != crcTxConfig_)
+    {
+        writeRegister(CRC_TX_CONFIG, txConfig);
+        crcTxConfig_ = txConfig;
+    }
+}
+
+ISO14443ErrorCode PN5180ISO14443::exchange(uint8_t *tx, uint8_t txLen, uint8_t txLastBits,
+                                           uint8_t *rx, uint16_t rxMax, uint32_t &rxStatus,
+                                           uint8_t timeoutMs)
+{
+    int16_t received = transceive(tx, txLen, rx, rxMax, &rxStatus, txLastBits, timeoutMs);
+    if (PN5180_TRANSCEIVE_FAILED == received)
+    {
+        return ISO14443_EC_PROTOCOL;
+    }
+    if (PN5180_TRANSCEIVE_NO_ANSWER == received)
+    {
+        return ISO14443_EC_NO_CARD;
+    }
+
+    // a collision also breaks parity, so it is checked first
+    if (rxStatus & RX_COLLISION_DETECTED)
+    {
+        return ISO14443_EC_COLLISION;
+    }
+    if (rxStatus & RX_PROTOCOL_ERROR)
+    {
+        return ISO14443_EC_PROTOCOL;
+    }
+    if (rxStatus & RX_DATA_INTEGRITY_ERROR)
+    {
+        return ISO14443_EC_INTEGRITY;
+    }
+    return ISO14443_EC_OK;
+}
+
+/*
+ * REQA / WUPA: 7-bit short frame, no CRC. The ATQAs of several cards may
+ * collide; two bytes with a collision still mean cards are there.
+ */
+ISO14443ErrorCode PN5180ISO14443::requestA(uint8_t command, uint16_t &atqa)
+{
+    uint8_t cmd[1] = {command};
+    uint8_t resp[2];
+    uint32_t rxStatus;
+
+    setFraming(false, 0);
+    ISO14443ErrorCode rc = exchange(cmd, 1, 7, resp, sizeof(resp), rxStatus);
+    if ((ISO14443_EC_OK != rc) && (ISO14443_EC_COLLISION != rc))
+    {
+        return rc;
+    }
+    if ((rxStatus & RX_BYTES_RECEIVED_MASK) != 2)
+    {
+        return ISO14443_EC_PROTOCOL;
+    }
+    atqa = resp[0] | ((uint16_t)resp[1] << 8);
+    return ISO14443_EC_OK;
+}
+
+/*
+ * ANTICOLLISION for one cascade level: levelUid[0..4] receives the four
+ * UID bytes (or CT and three bytes) and BCC.
+ *
+ *   SEL, NVB, known bits  ->  cards answer with the remaining bits
+ *
+ * buf[2..6] holds the 40 bits of the level; known is the number of bits
+ * fixed so far. RX_COLL_POS (RX_STATUS bits 25:19, PN5180 datasheet,
+ * RX_STATUS register) is the position of the first collision counted from
+ * bit 0 of the first received byte, and that byte starts with the
+ * RX_BIT_ALIGN bits of CRC_RX_CONFIG. With rxAlign = known % 8 the received
+ * byte 0 is buf[index], so the collision sits at bit (index - 2) * 8 + pos
+ * of the level. The 1-branch is taken; known grows by at least one bit per
+ * round, so this ends within 32 rounds. tools/iso14443_sim runs this
+ * against fields of colliding cards.
+ */
+ISO14443ErrorCode PN5180ISO14443::anticollisionLevel(uint8_t sel, uint8_t *levelUid)
+{
+    uint8_t buf[7] = {sel, 0, 0, 0, 0, 0, 0};
+    uint8_t resp[5];
+    uint8_t known = 0;
+    uint32_t rxStatus;
+
+    for (;;)
+    {
+        uint8_t index = 2 + known / 8;
+        uint8_t rxAlign = known % 8;
+        uint8_t txLen = index + (rxAlign ? 1 : 0);
+        buf[1] = (index << 4) | rxAlign; // NVB: whole bytes, extra bits
+
+        setFraming(false, rxAlign);
+        ISO14443ErrorCode rc = exchange(buf, txLen, rxAlign, resp, sizeof(resp), rxStatus);
+        if ((ISO14443_EC_OK != rc) && (ISO14443_EC_COLLISION != rc))
+        {
+            return rc;
+        }
+
+        // merge: of the first byte only the bits from rxAlign on are new
+        uint16_t n = rxStatus & RX_BYTES_RECEIVED_MASK;
+        uint8_t mask = (uint8_t)(0xff << rxAlign);
+        for (uint16_t i = 0; (i < n) && (index + i < 7); i++)
+        {
+            if (i == 0)
+            {
+                buf[index] = (buf[index] & ~mask) | (resp[0] & mask);
+            }
+            else
+            {
+                buf[index + i] = resp[i];
+            }
+        }
+
+        if (ISO14443_EC_OK == rc)
+        {
+            if ((buf[2] ^ buf[3] ^ buf[4] ^ buf[5]) != buf[6])
+            {
+                return ISO14443_EC_BCC;
+            }
+            memcpy(levelUid, buf + 2, 5);
+            return ISO14443_EC_OK;
+        }
+
+        uint8_t coll = (index - 2) * 8 + RX_COLL_POS(rxStatus);
+        if ((coll < known) || (coll >= 32))
+        {
+            return ISO14443_EC_PROTOCOL;
+        }
+        buf[2 + coll / 8] |= 1 << (coll % 8);
+        known = coll + 1;
+    }
+}
+
+// SELECT: SEL 70 UID0-3 BCC CRC_A, answered by SAK with CRC_A
+ISO14443ErrorCode PN5180ISO14443::selectLevel(uint8_t sel, const uint8_t *levelUid, uint8_t &sak)
+{
+    uint8_t cmd[7] = {sel, 0x70};
+    uint8_t resp[1];
+    uint32_t rxStatus;
+
+    memcpy(cmd + 2, levelUid, 5);
+    setFraming(true, 0);
+    ISO14443ErrorCode rc = exchange(cmd, sizeof(cmd), 0, resp, sizeof(resp), rxStatus);
+    if (ISO14443_EC_OK != rc)
+    {
+        return rc;
+    }
+    if ((rxStatus & RX_BYTES_RECEIVED_MASK) < 1)
+    {
+        return ISO14443_EC_PROTOCOL;
+    }
+    sak = resp[0];
+    return ISO14443_EC_OK;
+}
+
+ISO14443ErrorCode PN5180ISO14443::activate(ISO14443Card &card, bool wakeup)
+{
+    static const uint8_t sel[3] = {ISO14443_SEL_CL1, ISO14443_SEL_CL2, ISO14443_SEL_CL3};
+    uint8_t levelUid[5];
+
+    card.uidLength = 0;
+    ISO14443ErrorCode rc = requestA(wakeup ? ISO14443_WUPA : ISO14443_REQA, card.atqa);
+    if (ISO14443_EC_OK != rc)
+    {
+        return rc;
+    }
+
+    for (uint8_t level = 0; level < 3; level++)
+    {
+        rc = anticollisionLevel(sel[level], levelUid);
+        if (ISO14443_EC_OK != rc)
+        {
+            return rc;
+        }
+        rc = selectLevel(sel[level], levelUid, card.sak);
+        if (ISO14443_EC_OK != rc)
+        {
+            return rc;
+        }
+
+        if (card.sak & ISO14443_SAK_CASCADE)
+        {
+            // CT, then three UID bytes
+            if (levelUid[0] != ISO14443_CASCADE_TAG)
+            {
+                return ISO14443_EC_PROTOCOL;
+            }
+            memcpy(card.uid + card.uidLength, levelUid + 1, 3);
+            card.uidLength += 3;
+        }
+        else
+        {
+            memcpy(card.uid + card.uidLength, levelUid, 4);
+            card.uidLength += 4;
+            return ISO14443_EC_OK;
+        }
+    }
+    return ISO14443_EC_CASCADE;
+}
+
+ISO14443ErrorCode PN5180ISO14443::halt()
+{
+    uint8_t cmd[2] = {ISO14443_HLTA, 0x00};
+    uint8_t resp[1];
+    uint32_t rxStatus;
+
+    setFraming(true, 0);
+    ISO14443ErrorCode rc = exchange(cmd, sizeof(cmd), 0, resp, sizeof(resp), rxStatus, ISO14443_HALT_TIMEOUT_MS);
+    // silence is the acknowledgement
+    return (ISO14443_EC_NO_CARD == rc) ? ISO14443_EC_OK : ISO14443_EC_PROTOCOL;
+}
+
+uint8_t PN5180ISO14443::enumerate(ISO14443Card *cards, uint8_t maxCards, bool wakeup)
+{
+    uint8_t count = 0;
+    uint8_t failures = 0;
+
+    while ((count < maxCards) && (failures < 3))
+    {
+        // selected cards are halted, so after the first one REQA finds only new cards
+        ISO14443ErrorCode rc = activate(cards[count], wakeup && (count == 0));
+        if (ISO14443_EC_NO_CARD == rc)
+        {
+            break;
+        }
+        if (ISO14443_EC_OK == rc)
+        {
+            halt();
+            count++;
+            failures = 0;
+        }
+        else
+        {
+            failures++;
+        }
+    }
+    return count;
+}
@@ -20,7 +20,11 @@
 
 #include <Arduino.h>
 #include "PN5180ISO15693.h"
+#define PN5180_LOG_MODULE PN5180_LOG_ISO15693
 #include "PN5180Debug.h"
+#include "PN5180Profile.h"
+#include "HexFormat.h"
+#include "ReportProtocol.h"
 
 PN5180ISO15693::PN5180ISO15693(uint8_t SSpin, uint8_t BUSYpin, uint8_t RSTpin)
     : PN5180(SSpin, BUSYpin, RSTpin)
@@ -54,7 +58,14 @@ int16_t PN5180ISO15693::ISO15693_CRC16(uint8_t *DataIn, int NbByte)
  */
 ISO15693ErrorCode PN5180ISO15693::getInventory(uint8_t *uid)
 {
-    char buf[32];
+    Uid value;
+    ISO15693ErrorCode rc = getInventory(value);
+    value.toBytes(uid); // all zero when no tag answered
+    return rc;
+}
+
+ISO15693ErrorCode PN5180ISO15693::getInventory(Uid &uid)
+{
     //                     Flags,  CMD, maskLen
     //uint8_t inventory[] = {0x26, 0x01, 0x00};
     uint8_t inventory[] = {0x26, 0x01, 0x08, 0x74};
@@ -65,12 +76,7 @@ ISO15693ErrorCode PN5180ISO15693::getInventory(uint8_t *uid)
 
     //                        |\- inventory flag + high data rate
     //                        \-- 1 slot: only one card, no AFI field present
-    PN5180DEBUG(F("Get Inventory...\n"));
-
-    for (int i = 0; i < 8; i++)
-    {
-        uid[i] = 0;
-    }
+    uid = Uid();
 
     uint8_t *readBuffer;
     ISO15693ErrorCode rc = issueISO15693Command(inventory, sizeof(inventory), &readBuffer);
@@ -80,33 +86,9 @@ ISO15693ErrorCode PN5180ISO15693::getInventory(uint8_t *uid)
         return rc;
     }
 
-    char a[7] = {0};
-
-    //Serial.println(F("Response flags: "));
-    sprintf(a, "0x%02X", readBuffer[0]);
-    //Serial.println(a);
-    //Serial.println(F(", Data Storage Format ID: "));
-    sprintf(a, "0x%02X", readBuffer[1]);
-    //Serial.println(a);
-    ////Serial.println(formatHex(readBuffer[1]));
-    //Serial.println(F(", UID: "));
-
-    //Serial.println("DATA:");
-    for (int i = 0; i < 8; i++)
-    {
-        uid[i] = readBuffer[2 + i];
-        sprintf(a, "0x%02X ", uid[i]);
-        //Serial.print(a);
-#ifdef DEBUG
-        PN5180DEBUG(formatHex(uid[7 - i])); // LSB comes first
-        if (i < 2)
-            PN5180DEBUG(":");
-#endif
-    }
-    //Serial.println("");
-    sprintf(a, "CRC16: 0x%02X%02X", readBuffer[10], readBuffer[11]);
-    //Serial.println(a);
-    PN5180DEBUG("\n");
+    uid = Uid::fromBytes(&readBuffer[2]);
+    PN5180TRACE(PN5180_LOG_DEBUG, PN5180_TRACE_ISO15693_INVENTORY, uid.byte(6), (uint16_t)(uid.value() >> 32),
+                (uint32_t)uid.value());
     // delay(1000000);
 
     return ISO15693_EC_OK;
@@ -142,63 +124,7 @@ ISO15693ErrorCode PN5180ISO15693::getInventory(uint8_t *uid)
  */
 ISO15693ErrorCode PN5180ISO15693::readSingleBlock(uint8_t *uid, uint8_t blockNo, uint8_t *blockData, uint8_t blockSize)
 {
-    //                            flags, cmd, uid,             blockNo
-    uint8_t readSingleBlock[] = {0x62, 0x20, 1, 2, 3, 4, 5, 6, 7, 8, blockNo}; // UID has LSB first!
-    //                              |\- high data rate
-    //                              \-- options, addressed by UID
-    for (int i = 0; i < 8; i++)
-    {
-        readSingleBlock[2 + i] = uid[i];
-    }
-
-#ifdef DEBUG
-    PN5180DEBUG("Read Single Block #");
-    PN5180DEBUG(blockNo);
-    PN5180DEBUG(", size=");
-    PN5180DEBUG(blockSize);
-    PN5180DEBUG(": ");
-    for (int i = 0; i < sizeof(readSingleBlock); i++)
-    {
-        PN5180DEBUG(" ");
-        PN5180DEBUG(formatHex(readSingleBlock[i]));
-    }
-    PN5180DEBUG("\n");
-#endif
-
-    uint8_t *resultPtr;
-    ISO15693ErrorCode rc = issueISO15693Command(readSingleBlock, sizeof(readSingleBlock), &resultPtr);
-    if (ISO15693_EC_OK != rc)
-    {
-        return rc;
-    }
-
-    PN5180DEBUG("Value=");
-
-    for (int i = 0; i < blockSize; i++)
-    {
-        blockData[i] = resultPtr[2 + i];
-#ifdef DEBUG
-        PN5180DEBUG(formatHex(blockData[i]));
-        PN5180DEBUG(" ");
-#endif
-    }
-
-#ifdef DEBUG
-    PN5180DEBUG(" ");
-    for (int i = 0; i < blockSize; i++)
-    {
-        char c = blockData[i];
-        if (isPrintable(c))
-        {
-            PN5180DEBUG(c);
-        }
-        else
-            PN5180DEBUG(".");
-    }
-    PN5180DEBUG("\n");
-#endif
-
-    return ISO15693_EC_OK;
+    return readSingleBlock(Uid::fromBytes(uid), blockNo, blockData, blockSize);
 }
 
 /*
@@ -231,51 +157,7 @@ ISO15693ErrorCode PN5180ISO15693::readSingleBlock(uint8_t *uid, uint8_t blockNo,
  */
 ISO15693ErrorCode PN5180ISO15693::writeSingleBlock(uint8_t *uid, uint8_t blockNo, uint8_t *blockData, uint8_t blockSize)
 {
-    //                            flags, cmd, uid,             blockNo
-    //uint8_t writeSingleBlock[] = {0x62, 0x21, 1, 2, 3, 4, 5, 6, 7, 8, blockNo}; // UID has LSB first!
-    uint8_t writeSingleBlock[] = {0x23, 0x21, 1, 2, 3, 4, 5, 6, 7, 8, blockNo}; // UID has LSB first!
-    //                               |\- high data rate
-    //                               \-- options, addressed by UID
-
-    uint8_t writeCmdSize = sizeof(writeSingleBlock) + blockSize;
-    uint8_t *writeCmd = (uint8_t *)malloc(writeCmdSize);
-    uint8_t pos = 0;
-    writeCmd[pos++] = writeSingleBlock[0];
-    writeCmd[pos++] = writeSingleBlock[1];
-    for (int i = 0; i < 8; i++)
-    {
-        writeCmd[pos++] = uid[i];
-    }
-    writeCmd[pos++] = blockNo;
-    for (int i = 0; i < blockSize; i++)
-    {
-        writeCmd[pos++] = blockData[i];
-    }
-
-#ifdef DEBUG
-    PN5180DEBUG("Write Single Block #");
-    PN5180DEBUG(blockNo);
-    PN5180DEBUG(", size=");
-    PN5180DEBUG(blockSize);
-    PN5180DEBUG(":");
-    for (int i = 0; i < writeCmdSize; i++)
-    {
-        PN5180DEBUG(" ");
-        PN5180DEBUG(formatHex(writeCmd[i]));
-    }
-    PN5180DEBUG("\n");
-#endif
-
-    uint8_t *resultPtr;
-    ISO15693ErrorCode rc = issueISO15693Command(writeCmd, writeCmdSize, &resultPtr);
-    if (ISO15693_EC_OK != rc)
-    {
-        free(writeCmd);
-        return rc;
-    }
-
-    free(writeCmd);
-    return ISO15693_EC_OK;
+    return writeSingleBlock(Uid::fromBytes(uid), blockNo, blockData, blockSize);
 }
 
 /*
@@ -326,154 +208,8 @@ ISO15693ErrorCode PN5180ISO15693::writeSingleBlock(uint8_t *uid, uint8_t blockNo
  */
 ISO15693ErrorCode PN5180ISO15693::getSystemInfo(uint8_t *uid, uint8_t *blockSize, uint8_t *numBlocks)
 {
-    uint8_t sysInfo[] = {0x22, 0x2b, 1, 2, 3, 4, 5, 6, 7, 8}; // UID has LSB first!
-    for (int i = 0; i < 8; i++)
-    {
-        sysInfo[2 + i] = uid[i];
-    }
-
-#ifdef DEBUG
-    PN5180DEBUG("Get System Information");
-    for (int i = 0; i < sizeof(sysInfo); i++)
-    {
-        PN5180DEBUG(" ");
-        PN5180DEBUG(formatHex(sysInfo[i]));
-    }
-    PN5180DEBUG("\n");
-#endif
-
-    uint8_t *readBuffer;
-    ISO15693ErrorCode rc = issueISO15693Command(sysInfo, sizeof(sysInfo), &readBuffer);
-    if (ISO15693_EC_OK != rc)
-    {
-        return rc;
-    }
-
-    for (int i = 0; i < 8; i++)
-    {
-        uid[i] = readBuffer[2 + i];
-    }
-
-#ifdef DEBUG
-    PN5180DEBUG("UID=");
-    for (int i = 0; i < 8; i++)
-    {
-        PN5180DEBUG(formatHex(readBuffer[9 - i])); // UID has LSB first!
-        if (i < 2)
-            PN5180DEBUG(":");
-    }
-    PN5180DEBUG("\n");
-#endif
-
-    uint8_t *p = &readBuffer[10];
-
-    uint8_t infoFlags = readBuffer[1];
-    if (infoFlags & 0x01)
-    { // DSFID flag
-        uint8_t dsfid = *p++;
-        PN5180DEBUG("DSFID="); // Data storage format identifier
-        PN5180DEBUG(formatHex(dsfid));
-        PN5180DEBUG("\n");
-    }
-#ifdef DEBUG
-    else
-        PN5180DEBUG(F("No DSFID\n"));
-#endif
-
-    if (infoFlags & 0x02)
-    { // AFI flag
-        uint8_t afi = *p++;
-        PN5180DEBUG(F("AFI=")); // Application family identifier
-        PN5180DEBUG(formatHex(afi));
-        PN5180DEBUG(F(" - "));
-        switch (afi >> 4)
-        {
-        case 0:
-            PN5180DEBUG(F("All families"));
-            break;
-        case 1:
-            PN5180DEBUG(F("Transport"));
-            break;
-        case 2:
-            PN5180DEBUG(F("Financial"));
-            break;
-        case 3:
-            PN5180DEBUG(F("Identification"));
-            break;
-        case 4:
-            PN5180DEBUG(F("Telecommunication"));
-            break;
-        case 5:
-            PN5180DEBUG(F("Medical"));
-            break;
-        case 6:
-            PN5180DEBUG(F("Multimedia"));
-            break;
-        case 7:
-            PN5180DEBUG(F("Gaming"));
-            break;
-        case 8:
-            PN5180DEBUG(F("Data storage"));
-            break;
-        case 9:
-            PN5180DEBUG(F("Item management"));
-            break;
-        case 10:
-            PN5180DEBUG(F("Express parcels"));
-            break;
-        case 11:
-            PN5180DEBUG(F("Postal services"));
-            break;
-        case 12:
-            PN5180DEBUG(F("Airline bags"));
-            break;
-        default:
-            PN5180DEBUG(F("Unknown"));
-            break;
-        }
-        PN5180DEBUG("\n");
-    }
-#ifdef DEBUG
-    else
-        PN5180DEBUG(F("No AFI\n"));
-#endif
-
-    if (infoFlags & 0x04)
-    { // VICC Memory size
-        *numBlocks = *p++;
-        *blockSize = *p++;
-        *blockSize = (*blockSize) & 0x1f;
-
-        *blockSize = *blockSize + 1; // range: 1-32
-        *numBlocks = *numBlocks + 1; // range: 1-256
-        uint16_t viccMemSize = (*blockSize) * (*numBlocks);
-
-        PN5180DEBUG("VICC MemSize=");
-        PN5180DEBUG(viccMemSize);
-        PN5180DEBUG(" BlockSize=");
-        PN5180DEBUG(*blockSize);
-        PN5180DEBUG(" NumBlocks=");
-        PN5180DEBUG(*numBlocks);
-        PN5180DEBUG("\n");
-    }
-#ifdef DEBUG
-    else
-        PN5180DEBUG(F("No VICC memory size\n"));
-#endif
-
-    if (infoFlags & 0x08)
-    { // IC reference
-        uint8_t icRef = *p++;
-        PN5180DEBUG("IC Ref=");
-        PN5180DEBUG(formatHex(icRef));
-        PN5180DEBUG("\n");
-    }
-#ifdef DEBUG
-    else
-        PN5180DEBUG(F("No IC ref\n"));
-#endif
-
-    return ISO15693_EC_OK;
+    // addressed request: the UID in the answer is uid itself
+    return getSystemInfo(Uid::fromBytes(uid), *blockSize, *numBlocks);
 }
 
 /*
@@ -532,16 +268,22 @@ ISO15693ErrorCode PN5180ISO15693::getSystemInfo(uint8_t *uid, uint8_t *blockSize
  */
 ISO15693ErrorCode PN5180ISO15693::issueISO15693Command(uint8_t *cmd, uint8_t cmdLen, uint8_t **resultPtr, int32_t *rx_status)
 {
-#ifdef DEBUG
-    PN5180DEBUG(F("Issue Command 0x"));
-    PN5180DEBUG(formatHex(cmd[1]));
-    PN5180DEBUG("...\n");
-#endif
+    PN5180PROFILE_SCOPE(PN5180_PROF_ISO15693_CMD);
 
+    // an error answer leaves RX_IRQ set, which would end the next wait at once
+    clearIRQStatus(RX_SOF_DET_IRQ_STAT | IDLE_IRQ_STAT | TX_IRQ_STAT | RX_IRQ_STAT);
+
+    PN5180PROFILE_START(rfStart);
     sendData(cmd, cmdLen);
-    delay(10);
+    uint32_t irqStatus = 0;
+    uint32_t start = millis();
+    while ((0 == (RX_IRQ_STAT & irqStatus)) && (millis() - start < ISO15693_ANSWER_TIMEOUT_MS))
+    {
+        irqStatus = getIRQStatus();
+    }
+    PN5180PROFILE_STOP(PN5180_PROF_RF_EXCHANGE, rfStart);
 
-    if (0 == (getIRQStatus() & RX_SOF_DET_IRQ_STAT))
+    if (0 == (irqStatus & RX_SOF_DET_IRQ_STAT))
     {
         return EC_NO_CARD;
     }
@@ -549,9 +291,6 @@ ISO15693ErrorCode PN5180ISO15693::issueISO15693Command(uint8_t *cmd, uint8_t cmd
     uint32_t rxStatus;
     readRegister(RX_STATUS, &rxStatus);
 
-    PN5180DEBUG(F("RX-Status="));
-    PN5180DEBUG(formatHex(rxStatus));
-
     uint16_t len = (uint16_t)(rxStatus & 0x000001ff);
 
     if (rx_status)
@@ -559,14 +298,12 @@ ISO15693ErrorCode PN5180ISO15693::issueISO15693Command(uint8_t *cmd, uint8_t cmd
         *rx_status = rxStatus;
     }
 
-    PN5180DEBUG(", len=");
-    PN5180DEBUG(len);
-    PN5180DEBUG("\n");
+    PN5180TRACE(PN5180_LOG_DEBUG, PN5180_TRACE_ISO15693_CMD, cmd[1], len, rxStatus);
 
     *resultPtr = readData(len);
     if (0L == *resultPtr)
     {
-        PN5180DEBUG(F("*** ERROR in readData!\n"));
+        PN5180ERROR(F("*** ERROR in readData!\n"));
         return ISO15693_EC_UNKNOWN_ERROR;
     }
 
@@ -581,23 +318,12 @@ ISO15693ErrorCode PN5180ISO15693::issueISO15693Command(uint8_t *cmd, uint8_t cmd
     //     //Serial.println();
     // #endif
 
-    uint32_t irqStatus = getIRQStatus();
-    if (0 == (RX_SOF_DET_IRQ_STAT & irqStatus))
-    { // no card detected
-        clearIRQStatus(TX_IRQ_STAT | IDLE_IRQ_STAT);
-        return EC_NO_CARD;
-    }
-
     uint8_t responseFlags = (*resultPtr)[0];
     if (responseFlags & (1 << 0))
     { // error flag
         uint8_t errorCode = (*resultPtr)[1];
 
-        PN5180DEBUG("ERROR code=");
-        PN5180DEBUG(formatHex(errorCode));
-        PN5180DEBUG(" - ");
-        // PN5180DEBUG(strerror(errorCode));
-        PN5180DEBUG("\n");
+        PN5180TRACE(PN5180_LOG_ERROR, PN5180_TRACE_ISO15693_ERROR, cmd[1], 0, errorCode);
 
         if (errorCode >= 0xA0)
         { // custom command error codes
@@ -607,12 +333,6 @@ ISO15693ErrorCode PN5180ISO15693::issueISO15693Command(uint8_t *cmd, uint8_t cmd
             return (ISO15693ErrorCode)errorCode;
     }
 
-#ifdef DEBUG
-    if (responseFlags & (1 << 3))
-    { // extendsion flag
-        PN5180DEBUG("Extension flag is set!\n");
-    }
-#endif
 
     clearIRQStatus(RX_SOF_DET_IRQ_STAT | IDLE_IRQ_STAT | TX_IRQ_STAT | RX_IRQ_STAT);
     return ISO15693_EC_OK;
@@ -622,8 +342,8 @@ bool PN5180ISO15693::setupRF()
 {
     PN5180DEBUG(F("Loading RF-Configuration...\n"));
 
-    if (loadRFConfig(0x00, 0x80))
-    { // ISO15693 parameters
+    if (loadRFConfig(0x0D, 0x8D))
+    { // ISO15693 ASK100, 26 kbit/s
         PN5180DEBUG(F("done.\n"));
     }
     else
@@ -687,45 +407,34 @@ const __FlashStringHelper *PN5180ISO15693::strerror(ISO15693ErrorCode errno)
 
 void PN5180ISO15693::search_all()
 {
-    MyStack stack(100);
-    SearchData start(0, 0, 0);
-    stack.push(start);
-    //Serial.println(stack.size());
-
-    // delay(1000);
-    SearchData tmp;
-    SearchData to_push;
-    uint8_t ret;
-    int64_t uid;
+    PN5180PROFILE_SCOPE(PN5180_PROF_SEARCH_ALL);
+    SearchStack stack;
+    stack.push(SearchNode(0, 0, 0));
 
-    int64_t mask_to_search;
-    uint8_t mask_len_to_search;
+    SearchNode tmp;
+    uint8_t ret;
+    Uid uid;
 
     while (!stack.empty())
     {
-
         stack.pop(tmp);
 
-        if (tmp.current_bit_value)
+        uint8_t position = tmp.position();
+        uint64_t mask = tmp.mask;
+        if (tmp.bit())
         {
-            (tmp.mask) |= (tmp.current_bit_value << tmp.position);
+            mask |= ((uint64_t)1 << position);
         }
         else
         {
-            (tmp.mask) &= ~(tmp.current_bit_value << tmp.position);
+            mask &= ~((uint64_t)1 << position);
         }
-        mask_len_to_search = tmp.position + 1;
 
-        //ISO15693ErrorCode ec = search_once(tmp.mask, mask_len_to_search, &ret, &uid);
-        ISO15693ErrorCode ec = search_once(tmp.mask, mask_len_to_search, ret, uid);
-        ////Serial.print("RET= ");
-        ////Serial.println(ret);
-        if (tmp.current_bit_value == 0)
+        ISO15693ErrorCode ec = search_once(mask, position + 1, ret, uid);
+
+        if (tmp.bit() == 0)
         {
-            to_push.mask = tmp.mask;
-            to_push.position = tmp.position;
-            to_push.current_bit_value = (uint8_t)1;
-            stack.push(to_push);
+            stack.push(SearchNode(mask, position, 1));
         }
 
         if (ret == 0)
@@ -735,24 +444,11 @@ void PN5180ISO15693::search_all()
         {
             m_uidvec.insert(uid);
             quiet(uid);
-            //Serial.println("FOUND");
         }
-        else
+        else if (position + 1 < ISO15693_UID_BITS)
         {
-
-            //SearchData test(tmp.mask, tmp.position + (uint8_t)1, (uint8_t)0);
-            to_push.mask = tmp.mask;
-            to_push.position = tmp.position + (uint8_t)1;
-            to_push.current_bit_value = (uint8_t)0;
-            stack.push(to_push);
+            stack.push(SearchNode(mask, position + 1, 0));
         }
-
-        // delay(1000);
-        // this->reset();
-        // this->setupRF();
-
-        //Serial.print("STACK SIZE = ");
-        //Serial.println(stack.size());
     }
 
     // Serial.print("count: ");
@@ -812,13 +508,20 @@ void PN5180ISO15693::search_all()
  *
  *    IC reference: The IC reference is on 8 bits and its meaning is defined by the IC manufacturer.
  */
-ISO15693ErrorCode PN5180ISO15693::getSystemInfo(const int64_t &uid, uint8_t &blockSize, uint8_t &numBlocks)
+ISO15693ErrorCode PN5180ISO15693::getSystemInfo(const Uid &uid, uint8_t &blockSize, uint8_t &numBlocks)
 {
     uint8_t sysInfo[] = {0x22, 0x2b, 1, 2, 3, 4, 5, 6, 7, 8}; // UID has LSB first!
-    for (int i = 0; i < 8; i++)
+    uid.toBytes(&sysInfo[2]);
+
+#if PN5180_LOG_ON(PN5180_LOG_DEBUG)
+    PN5180DEBUG("Get System Information");
+    for (int i = 0; i < sizeof(sysInfo); i++)
     {
-        sysInfo[2 + i] = ((uint8_t *)&uid)[i];
+        PN5180DEBUG(" ");
+        PN5180DEBUG(formatHex(sysInfo[i]));
     }
+    PN5180DEBUG("\n");
+#endif
 
     uint8_t *readBuffer;
     ISO15693ErrorCode rc = issueISO15693Command(sysInfo, sizeof(sysInfo), &readBuffer);
@@ -827,10 +530,16 @@ ISO15693ErrorCode PN5180ISO15693::getSystemInfo(const int64_t &uid, uint8_t &blo
         return rc;
     }
 
-    // for (int i = 0; i < 8; i++)
-    // {
-    //     uid[i] = readBuffer[2 + i];
-    // }
+#if PN5180_LOG_ON(PN5180_LOG_DEBUG)
+    PN5180DEBUG("UID=");
+    for (int i = 0; i < 8; i++)
+    {
+        PN5180DEBUG(formatHex(readBuffer[9 - i])); // UID has LSB first!
+        if (i < 2)
+            PN5180DEBUG(":");
+    }
+    PN5180DEBUG("\n");
+#endif
 
     uint8_t *p = &readBuffer[10];
 
@@ -838,42 +547,119 @@ ISO15693ErrorCode PN5180ISO15693::getSystemInfo(const int64_t &uid, uint8_t &blo
     if (infoFlags & 0x01)
     { // DSFID flag
         uint8_t dsfid = *p++;
+        PN5180DEBUG("DSFID="); // Data storage format identifier
+        PN5180DEBUG(formatHex(dsfid));
+        PN5180DEBUG("\n");
     }
+#if PN5180_LOG_ON(PN5180_LOG_DEBUG)
+    else
+        PN5180DEBUG(F("No DSFID\n"));
+#endif
 
     if (infoFlags & 0x02)
     { // AFI flag
         uint8_t afi = *p++;
+        PN5180DEBUG(F("AFI=")); // Application family identifier
+        PN5180DEBUG(formatHex(afi));
+        PN5180DEBUG(F(" - "));
+        switch (afi >> 4)
+        {
+        case 0:
+            PN5180DEBUG(F("All families"));
+            break;
+        case 1:
+            PN5180DEBUG(F("Transport"));
+            break;
+        case 2:
+            PN5180DEBUG(F("Financial"));
+            break;
+        case 3:
+            PN5180DEBUG(F("Identification"));
+            break;
+        case 4:
+            PN5180DEBUG(F("Telecommunication"));
+            break;
+        case 5:
+            PN5180DEBUG(F("Medical"));
+            break;
+        case 6:
+            PN5180DEBUG(F("Multimedia"));
+            break;
+        case 7:
+            PN5180DEBUG(F("Gaming"));
+            break;
+        case 8:
+            PN5180DEBUG(F("Data storage"));
+            break;
+        case 9:
+            PN5180DEBUG(F("Item management"));
+            break;
+        case 10:
+            PN5180DEBUG(F("Express parcels"));
+            break;
+        case 11:
+            PN5180DEBUG(F("Postal services"));
+            break;
+        case 12:
+            PN5180DEBUG(F("Airline bags"));
+            break;
+        default:
+            PN5180DEBUG(F("Unknown"));
+            break;
+        }
+        PN5180DEBUG("\n");
     }
+#if PN5180_LOG_ON(PN5180_LOG_DEBUG)
+    else
+        PN5180DEBUG(F("No AFI\n"));
+#endif
 
     if (infoFlags & 0x04)
     { // VICC Memory size
         numBlocks = *p++;
         blockSize = *p++;
-        blockSize = (blockSize)&0x1f;
+        blockSize = (blockSize) & 0x1f;
 
         blockSize = blockSize + 1; // range: 1-32
         numBlocks = numBlocks + 1; // range: 1-256
-        //uint16_t viccMemSize = (blockSize) * (numBlocks);
+        uint16_t viccMemSize = (blockSize) * (numBlocks);
+
+        PN5180DEBUG("VICC MemSize=");
+        PN5180DEBUG(viccMemSize);
+        PN5180DEBUG(" BlockSize=");
+        PN5180DEBUG(blockSize);
+        PN5180DEBUG(" NumBlocks=");
+        PN5180DEBUG(numBlocks);
+        PN5180DEBUG("\n");
     }
+#if PN5180_LOG_ON(PN5180_LOG_DEBUG)
+    else
+        PN5180DEBUG(F("No VICC memory size\n"));
+#endif
 
     if (infoFlags & 0x08)
     { // IC reference
         uint8_t icRef = *p++;
+        PN5180DEBUG("IC Ref=");
+        PN5180DEBUG(formatHex(icRef));
+        PN5180DEBUG("\n");
     }
+#if PN5180_LOG_ON(PN5180_LOG_DEBUG)
+    else
+        PN5180DEBUG(F("No IC ref\n"));
+#endif
 
     return ISO15693_EC_OK;
 }
 
-ISO15693ErrorCode PN5180ISO15693::readSingleBlock(const int64_t &uid, const uint8_t &blockNo, uint8_t *blockData, const uint8_t &blockSize)
+ISO15693ErrorCode PN5180ISO15693::readSingleBlock(const Uid &uid, const uint8_t &blockNo, uint8_t *blockData, const uint8_t &blockSize)
 {
     //                            flags, cmd, uid,             blockNo
     uint8_t sendbuf[] = {0x62, 0x20, 1, 2, 3, 4, 5, 6, 7, 8, blockNo}; // UID has LSB first!
     //                              |\- high data rate
     //                              \-- options, addressed by UID
-    for (int i = 0; i < 8; i++)
-    {
-        sendbuf[2 + i] = ((uint8_t *)&uid)[i];
-    }
+    uid.toBytes(&sendbuf[2]);
+
     int32_t len;
 
     uint8_t *resultPtr;
@@ -888,62 +674,63 @@ ISO15693ErrorCode PN5180ISO15693::readSingleBlock(const int64_t &uid, const uint
         blockData[i] = resultPtr[2 + i];
     }
 
-    Serial.print("resultPtr = ");
+    PN5180TRACE(PN5180_LOG_DEBUG, PN5180_TRACE_ISO15693_READ_BLOCK, blockNo, blockSize,
+                traceHead(blockData, blockSize));
 
-    char buf[256];
-    sprintf(buf, "resultlen: %d, 0:%02X,1:%02X,data:%02X%02X%02X%02X", len, resultPtr[0], resultPtr[1], resultPtr[2], resultPtr[3], resultPtr[4], resultPtr[5]);
-
-    //Serial.print(resultPtr[7]);
-    Serial.println(buf);
+    // to the application's port: on the firmware's DMA transmitter this never waits for the UART
+#ifdef REPORT_BINARY
+    reportBlock(*pn5180LogOut, uid, blockNo, blockData, blockSize);
+#else
+    char buf[32];
+    char *p = buf;
+    memcpy(p, ", 0:", 4);
+    p += 4 + hexEncode(p + 4, resultPtr, 1);
+    memcpy(p, ",1:", 3);
+    p += 3 + hexEncode(p + 3, resultPtr + 1, 1);
+    memcpy(p, ",data:", 6);
+    p += 6 + hexEncode(p + 6, resultPtr + 2, 4);
+    *p++ = '\n';
+    *p = '\0';
+    pn5180LogOut->print(F("resultPtr = resultlen: "));
+    pn5180LogOut->print(len);
+    pn5180LogOut->print(buf);
+#endif
 
     return ISO15693_EC_OK;
 }
 
-ISO15693ErrorCode PN5180ISO15693::readSingleBlock(const int64_t &uid, const uint8_t &blockNo, uint64_t &blockData)
+ISO15693ErrorCode PN5180ISO15693::readSingleBlock(const Uid &uid, const uint8_t &blockNo, uint64_t &blockData)
 {
-    readSingleBlock(uid, blockNo, (uint8_t *)&blockData, 4);
+    return readSingleBlock(uid, blockNo, (uint8_t *)&blockData, 4);
 }
 
-ISO15693ErrorCode PN5180ISO15693::writeSingleBlock(const int64_t &uid, const uint8_t &blockNo, uint8_t *blockData, const uint8_t &blockSize)
+ISO15693ErrorCode PN5180ISO15693::writeSingleBlock(const Uid &uid, const uint8_t &blockNo, uint8_t *blockData, const uint8_t &blockSize)
 {
     //                            flags, cmd, uid,             blockNo
     //uint8_t writeSingleBlock[] = {0x62, 0x21, 1, 2, 3, 4, 5, 6, 7, 8, blockNo}; // UID has LSB first!
-    uint8_t head[] = {0x23, 0x21, 1, 2, 3, 4, 5, 6, 7, 8, blockNo}; // UID has LSB first!
-    //                               |\- high data rate
-    //                               \-- options, addressed by UID
-
-    uint8_t buffersize = sizeof(head) + blockSize;
-    //uint8_t *writeCmd = (uint8_t *)malloc(writeCmdSize);
-    uint8_t *sendbuf = new uint8_t[buffersize];
-
-    uint8_t pos = 0;
-    sendbuf[pos++] = head[0];
-    sendbuf[pos++] = head[1];
-    for (int i = 0; i < 8; i++)
-    {
-        sendbuf[pos++] = ((uint8_t *)&uid)[i];
-    }
-    sendbuf[pos++] = blockNo;
-    for (int i = 0; i < blockSize; i++)
+    //                   flags, cmd, uid, blockNo, data (block size is at most 32 bytes)
+    uint8_t sendbuf[2 + Uid::LENGTH + 1 + 32] = {0x23, 0x21};
+    //                                             |\- high data rate
+    //                                             \-- options, addressed by UID
+    if (blockSize > 32)
     {
-        sendbuf[pos++] = blockData[i];
+        return ISO15693_EC_OPTION_NOT_SUPPORTED;
     }
 
-    uint8_t *resultPtr;
-    ISO15693ErrorCode rc = issueISO15693Command(sendbuf, buffersize, &resultPtr);
-    if (ISO15693_EC_OK != rc)
-    {
-        delete[] sendbuf;
-        return rc;
-    }
+    uid.toBytes(&sendbuf[2]);
+    sendbuf[2 + Uid::LENGTH] = blockNo;
+    memcpy(&sendbuf[3 + Uid::LENGTH], blockData, blockSize);
 
-    delete[] sendbuf;
-    return ISO15693_EC_OK;
+    PN5180TRACE(PN5180_LOG_DEBUG, PN5180_TRACE_ISO15693_WRITE_BLOCK, blockNo, blockSize,
+                traceHead(blockData, blockSize));
+
+    uint8_t *resultPtr;
+    return issueISO15693Command(sendbuf, 3 + Uid::LENGTH + blockSize, &resultPtr);
 }
 
-ISO15693ErrorCode PN5180ISO15693::writeSingleBlock(const int64_t &uid, const uint8_t &blockNo, uint64_t &blockData)
+ISO15693ErrorCode PN5180ISO15693::writeSingleBlock(const Uid &uid, const uint8_t &blockNo, uint64_t &blockData)
 {
-    writeSingleBlock(uid, blockNo, (uint8_t *)&blockData, 4);
+    return writeSingleBlock(uid, blockNo, (uint8_t *)&blockData, 4);
 }
 
 /*
@@ -954,7 +741,7 @@ ISO15693ErrorCode PN5180ISO15693::writeSingleBlock(const int64_t &uid, const uin
     * @return errno 
     * 
      */
-ISO15693ErrorCode PN5180ISO15693::search_once(const int64_t &mask, const uint8_t &mask_length, uint8_t &ret_val, int64_t &result_ptr)
+ISO15693ErrorCode PN5180ISO15693::search_once(const uint64_t &mask, const uint8_t &mask_length, uint8_t &ret_val, Uid &result_ptr)
 {
     delay(1);
     //Serial.print("start search_once :");
@@ -969,10 +756,7 @@ ISO15693ErrorCode PN5180ISO15693::search_once(const int64_t &mask, const uint8_t
     inventory[2] = mask_length;
 
     uint8_t mask_byte_length = (mask_length + 7) / 8;
-    for (int i = 0; i < mask_byte_length; i++)
-    {
-        inventory[3 + i] = ((uint8_t *)&mask)[i];
-    }
+    Uid(mask).toBytes(&inventory[3]); // mask is LSB first like a UID, unused bytes are not sent
 
     uint8_t send_len = mask_byte_length + 3;
     uint8_t *readBuffer;
@@ -1004,10 +788,7 @@ ISO15693ErrorCode PN5180ISO15693::search_once(const int64_t &mask, const uint8_t
         // //Serial.print(a);
     }
 
-    for (int i = 0; i < 8; i++)
-    {
-        ((uint8_t *)&result_ptr)[i] = readBuffer[2 + i];
-    }
+    result_ptr = Uid::fromBytes(&readBuffer[2]);
     //Serial.println(result_ptr);
 
     ret_val = 1;
@@ -1015,13 +796,10 @@ ISO15693ErrorCode PN5180ISO15693::search_once(const int64_t &mask, const uint8_t
     return ISO15693_EC_OK;
 }
 //quiet之后继续readblock可以读出数据。quiet之后继续搜卡无法搜到，需要reset。
-void PN5180ISO15693::quiet(const int64_t &uid)
+void PN5180ISO15693::quiet(const Uid &uid)
 {
     uint8_t sendbuf[10] = {0b00100010, 0x02};
-    for (int i = 0; i < 8; i++)
-    {
-        sendbuf[2 + i] = ((uint8_t *)&uid)[i];
-    }
+    uid.toBytes(&sendbuf[2]);
     uint8_t *readBuffer;
     issueISO15693Command(sendbuf, sizeof(sendbuf), &readBuffer);
 }
@@ -1046,7 +824,7 @@ int32_t PN5180ISO15693::calc_point_once()
         }
         else
         {
-            Serial.println("read failed");
+            pn5180LogOut->println("read failed");
         }
     }
     return res;
@@ -1054,6 +832,7 @@ int32_t PN5180ISO15693::calc_point_once()
 
 int32_t PN5180ISO15693::calc_point()
 {
+    PN5180PROFILE_SCOPE(PN5180_PROF_CALC_POINT);
     int showValue = 0;
     int showTimes = 0;
     int count;
@@ -1080,13 +859,8 @@ int32_t PN5180ISO15693::calc_point()
 
 char *PN5180ISO15693::formatHex(uint64_t val)
 {
-    static const char hexChar[] = "0123456789ABCDEF";
     static char hexBuffer[17];
-    for (int i = 15; i >= 0; i--)
-    {
-        hexBuffer[i] = hexChar[val & 0x0f];
-        val = val >> 4;
-    }
-    hexBuffer[16] = '\0';
+    hexEncodeWord(hexBuffer, (uint32_t)(val >> 32), 8);
+    hexEncodeWord(hexBuffer + 8, (uint32_t)val, 8);
     return hexBuffer;
 }
@@ -0,0 +1,358 @@
+// NAME: PN5180ISODEP.cpp
+//
+// DESC: ISO14443-4 (ISO-DEP) block transport on NXP Semiconductors PN5180 module for Arduino.
+//
+// This file is part of the PN5180 library for the Arduino environment.
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// Lesser General Public License for more details.
+//
+#include <Arduino.h>
+#include "PN5180ISODEP.h"
+
+/*
+ * PCB coding, CID and NAD bits (b4, b3) left out:
+ *
+ *   I-block  000C 0x1N   C = chaining, N = block number
+ *   R-block  101K 0x1N   K = NAK
+ *   S-block  11WW 0x10   WW = 00 DESELECT, 11 WTX
+ */
+static inline bool isIBlock(uint8_t pcb)
+{
+    return (pcb & 0xE2) == 0x02;
+}
+
+static inline bool isRBlock(uint8_t pcb)
+{
+    return (pcb & 0xE6) == 0xA2;
+}
+
+static inline bool isSBlock(uint8_t pcb)
+{
+    return (pcb & 0xC7) == 0xC2;
+}
+
+// FSCI -> FSC; 9..15 are RFU and read as 256
+static const uint16_t fscTable[9] = {16, 24, 32, 40, 48, 64, 96, 128, 256};
+
+PN5180ISODEP::PN5180ISODEP(uint8_t SSpin, uint8_t BUSYpin, uint8_t RSTpin)
+    : PN5180ISO14443(SSpin, BUSYpin, RSTpin),
+      fsc_(32), fwi_(ISODEP_FWI_DEFAULT), sfgi_(ISODEP_SFGI_DEFAULT), blockNum_(0),
+      timerReload_(0), timerConfigured_(false)
+{
+}
+
+ISO14443ErrorCode PN5180ISODEP::rats(uint8_t *ats, uint8_t *atsLen)
+{
+    uint8_t cmd[2] = {ISODEP_RATS, ISODEP_FSDI << 4}; // CID 0
+    uint8_t buf[ISODEP_ATS_MAX];
+    uint32_t rxStatus;
+
+    setFraming(true, 0);
+    ISO14443ErrorCode rc = exchange(cmd, sizeof(cmd), 0, buf, sizeof(buf), rxStatus);
+    if (ISO14443_EC_OK != rc)
+    {
+        return rc;
+    }
+
+    // TL counts itself
+    uint16_t n = rxStatus & RX_BYTES_RECEIVED_MASK;
+    if ((n == 0) || (buf[0] != n))
+    {
+        return ISO14443_EC_PROTOCOL;
+    }
+    if (n > sizeof(buf))
+    {
+        n = sizeof(buf);
+    }
+
+    fsc_ = fscTable[2];
+    fwi_ = ISODEP_FWI_DEFAULT;
+    sfgi_ = ISODEP_SFGI_DEFAULT;
+    if (n > 1)
+    {
+        uint8_t t0 = buf[1];
+        uint8_t fsci = t0 & ISODEP_T0_FSCI_MASK;
+        fsc_ = fscTable[(fsci < 8) ? fsci : 8];
+
+        uint8_t p = 2;
+        if (t0 & ISODEP_T0_TA)
+        {
+            p++; // bit rates, we stay at 106 kbit/s
+        }
+        if ((t0 & ISODEP_T0_TB) && (p < n))
+        {
+            fwi_ = buf[p] >> 4;
+            sfgi_ = buf[p] & 0x0F;
+            // 15 is RFU for both
+            if (fwi_ > ISODEP_FWI_MAX)
+            {
+                fwi_ = ISODEP_FWI_DEFAULT;
+            }
+            if (sfgi_ > ISODEP_FWI_MAX)
+            {
+                sfgi_ = ISODEP_SFGI_DEFAULT;
+            }
+        }
+    }
+
+    // first I-block carries block number 0; TIMER1 is set up again for this card
+    blockNum_ = 0;
+    timerConfigured_ = false;
+    timerReload_ = 0;
+
+    if (ats)
+    {
+        memcpy(ats, buf, n);
+    }
+    if (atsLen)
+    {
+        *atsLen = n;
+    }
+
+    // SFGT = 256 * 16 / fc * 2^SFGI before the first block
+    if (sfgi_)
+    {
+        uint32_t us = 302UL << sfgi_;
+        delay(us / 1000);
+        delayMicroseconds(us % 1000);
+    }
+    return ISO14443_EC_OK;
+}
+
+uint32_t PN5180ISODEP::armTimer(uint8_t wtxm)
+{
+    uint32_t reload = ISODEP_FWT_TICKS << fwi_;
+    if (wtxm > 1)
+    {
+        reload *= wtxm;
+    }
+    // FWT and FWT * WTXM are both capped at FWI 14, which is also what 20 bits hold
+    if (reload > T1_RELOAD_MAX)
+    {
+        reload = T1_RELOAD_MAX;
+    }
+
+    if (!timerConfigured_)
+    {
+        writeRegister(TIMER1_CONFIG, T1_ENABLE | T1_PRESCALE_212KHZ | T1_START_ON_TX_ENDED | T1_STOP_ON_RX_STARTED);
+        timerConfigured_ = true;
+    }
+    if (reload != timerReload_)
+    {
+        writeRegister(TIMER1_RELOAD, reload);
+        timerReload_ = reload;
+    }
+    return reload;
+}
+
+ISO14443ErrorCode PN5180ISODEP::transceiveBlock(uint8_t *tx, uint16_t txLen, uint8_t wtxm,
+                                                uint8_t *&rx, uint16_t &rxLen)
+{
+    uint32_t ticks = armTimer(wtxm);
+
+    clearIRQStatus(RX_IRQ_STAT | TX_IRQ_STAT | IDLE_IRQ_STAT | TIMER1_IRQ_STAT);
+    if (!sendData(tx, txLen))
+    {
+        return ISO14443_EC_PROTOCOL;
+    }
+
+    // the host deadline also covers both frames on air: 9 bit times, 85 us, per byte
+    uint32_t deadline = ticks / 212 + ((uint32_t)(txLen + ISODEP_FSD) * 85) / 1000 + ISODEP_DEADLINE_MARGIN_MS;
+    uint32_t start = millis();
+    for (;;)
+    {
+        uint32_t irqStatus = getIRQStatus();
+        if (irqStatus & RX_IRQ_STAT)
+        {
+            break;
+        }
+        if ((irqStatus & TIMER1_IRQ_STAT) || (millis() - start > deadline))
+        {
+            return ISO14443_EC_NO_CARD;
+        }
+    }
+
+    uint32_t rxStatus;
+    readRegister(RX_STATUS, &rxStatus);
+    if (rxStatus & RX_PROTOCOL_ERROR)
+    {
+        return ISO14443_EC_PROTOCOL;
+    }
+    if (rxStatus & (RX_DATA_INTEGRITY_ERROR | RX_COLLISION_DETECTED))
+    {
+        return ISO14443_EC_INTEGRITY;
+    }
+
+    rxLen = rxStatus & RX_BYTES_RECEIVED_MASK;
+    if ((rxLen == 0) || (rxLen > ISODEP_FSD))
+    {
+        return ISO14443_EC_PROTOCOL;
+    }
+    rx = readData(rxLen);
+    return rx ? ISO14443_EC_OK : ISO14443_EC_PROTOCOL;
+}
+
+/*
+ * Error recovery, ISO14443-4 7.5.4:
+ *  - no or damaged answer to an I-block: R(NAK), the card repeats its
+ *    last block or acknowledges the one before
+ *  - no or damaged answer to an R- or S-block: send it again
+ *  - R(ACK) with another block number after an I-block: the card missed
+ *    it, send it again
+ *  - S(WTX): echo WTXM; only the wait for the next answer is stretched
+ */
+ISO14443ErrorCode PN5180ISODEP::exchangeBlock(uint8_t *tx, uint16_t txLen, uint8_t *&rx, uint16_t &rxLen)
+{
+    uint8_t ctrl[2];
+    uint8_t *frame = tx;
+    uint16_t frameLen = txLen;
+    uint8_t wtxm = 0;
+    uint8_t retries = ISODEP_RETRIES;
+
+    for (;;)
+    {
+        ISO14443ErrorCode rc = transceiveBlock(frame, frameLen, wtxm, rx, rxLen);
+        wtxm = 0;
+
+        if (ISO14443_EC_OK == rc)
+        {
+            uint8_t pcb = rx[0];
+            if (isSBlock(pcb) && ((pcb & 0x30) == 0x30))
+            {
+                wtxm = (rxLen > 1) ? (rx[1] & ISODEP_WTXM_MASK) : 0;
+                if ((wtxm == 0) || (wtxm > 59))
+                {
+                    return ISO14443_EC_PROTOCOL;
+                }
+                ctrl[0] = ISODEP_PCB_S_WTX;
+                ctrl[1] = wtxm;
+                frame = ctrl;
+                frameLen = 2;
+                continue;
+            }
+            if (isIBlock(tx[0]) && isRBlock(pcb) && !(pcb & ISODEP_PCB_NAK) &&
+                ((pcb & ISODEP_PCB_BLOCK_NUM) != blockNum_))
+            {
+                // after our R(NAK) this is the expected repair and the NAK was already counted
+                if ((frame == tx) && (0 == retries--))
+                {
+                    return ISO14443_EC_PROTOCOL;
+                }
+                frame = tx;
+                frameLen = txLen;
+                continue;
+            }
+            return ISO14443_EC_OK;
+        }
+
+        if (0 == retries--)
+        {
+            return rc;
+        }
+        if (isIBlock(tx[0]))
+        {
+            ctrl[0] = ISODEP_PCB_R_NAK | blockNum_;
+            frame = ctrl;
+            frameLen = 1;
+        }
+        else
+        {
+            frame = tx;
+            frameLen = txLen;
+        }
+    }
+}
+
+ISO14443ErrorCode PN5180ISODEP::apdu(const uint8_t *capdu, uint16_t capduLen,
+                                     uint8_t *rapdu, uint16_t rapduMax, uint16_t &rapduLen)
+{
+    uint8_t frame[ISODEP_FSC_MAX];
+    uint16_t maxInf = fsc_ - 3; // PCB and CRC_A
+    uint16_t sent = 0;
+    uint8_t *rx;
+    uint16_t rxLen;
+    ISO14443ErrorCode rc;
+
+    rapduLen = 0;
+
+    // command: every block but the last is chained and must be acknowledged
+    for (;;)
+    {
+        uint16_t chunk = capduLen - sent;
+        bool more = chunk > maxInf;
+        if (more)
+        {
+            chunk = maxInf;
+        }
+        frame[0] = ISODEP_PCB_I | blockNum_ | (more ? ISODEP_PCB_CHAINING : 0);
+        memcpy(frame + 1, capdu + sent, chunk);
+
+        rc = exchangeBlock(frame, chunk + 1, rx, rxLen);
+        if (ISO14443_EC_OK != rc)
+        {
+            return rc;
+        }
+        if (!more)
+        {
+            break;
+        }
+        if (!isRBlock(rx[0]) || (rx[0] & ISODEP_PCB_NAK) || ((rx[0] & ISODEP_PCB_BLOCK_NUM) != blockNum_))
+        {
+            return ISO14443_EC_PROTOCOL;
+        }
+        blockNum_ ^= 1;
+        sent += chunk;
+    }
+
+    // response: INF goes straight from the reception buffer to rapdu
+    for (;;)
+    {
+        uint8_t pcb = rx[0];
+        if (!isIBlock(pcb) || (pcb & ISODEP_PCB_CID_NAD) || ((pcb & ISODEP_PCB_BLOCK_NUM) != blockNum_))
+        {
+            return ISO14443_EC_PROTOCOL;
+        }
+        blockNum_ ^= 1;
+
+        uint16_t inf = rxLen - 1;
+        if (rapduLen + inf > rapduMax)
+        {
+            return ISO14443_EC_OVERFLOW;
+        }
+        memcpy(rapdu + rapduLen, rx + 1, inf);
+        rapduLen += inf;
+
+        if (!(pcb & ISODEP_PCB_CHAINING))
+        {
+            return ISO14443_EC_OK;
+        }
+        frame[0] = ISODEP_PCB_R_ACK | blockNum_;
+        rc = exchangeBlock(frame, 1, rx, rxLen);
+        if (ISO14443_EC_OK != rc)
+        {
+            return rc;
+        }
+    }
+}
+
+ISO14443ErrorCode PN5180ISODEP::deselect()
+{
+    uint8_t cmd[1] = {ISODEP_PCB_S_DESELECT};
+    uint8_t *rx;
+    uint16_t rxLen;
+
+    ISO14443ErrorCode rc = exchangeBlock(cmd, sizeof(cmd), rx, rxLen);
+    if (ISO14443_EC_OK != rc)
+    {
+        return rc;
+    }
+    return ((rx[0] & 0xF7) == ISODEP_PCB_S_DESELECT) ? ISO14443_EC_OK : ISO14443_EC_PROTOCOL;
+}
@@ -0,0 +1,120 @@
+// NAME: PN5180Poller.cpp
+//
+// DESC: Multi-protocol discovery loop on NXP Semiconductors PN5180 module for Arduino.
+//
+// This file is part of the PN5180 library for the Arduino environment.
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// Lesser General Public License for more details.
+//
+#include <Arduino.h>
+#include "PN5180Poller.h"
+
+static const uint16_t guardUs[PN5180_POLL_TECH_COUNT] = {
+    PN5180_POLL_GUARD_ISO14443A_US,
+    PN5180_POLL_GUARD_ISO15693_US,
+};
+
+PN5180Poller::PN5180Poller(PN5180ISO14443 &iso14443, PN5180ISO15693 &iso15693)
+    : iso14443_(iso14443), iso15693_(iso15693), active_(-1), next_(0)
+{
+    for (uint8_t i = 0; i < PN5180_POLL_TECH_COUNT; i++)
+    {
+        enabled_[i] = true;
+    }
+    resetStats();
+}
+
+void PN5180Poller::enable(PN5180PollTech tech, bool on)
+{
+    enabled_[tech] = on;
+}
+
+void PN5180Poller::resetStats()
+{
+    for (uint8_t i = 0; i < PN5180_POLL_TECH_COUNT; i++)
+    {
+        memset(&stats_[i], 0, sizeof(stats_[i]));
+        stats_[i].latencyMinUs = 0xffffffff;
+    }
+}
+
+bool PN5180Poller::select(PN5180PollTech tech)
+{
+    if (active_ == tech)
+    {
+        return true;
+    }
+
+    // setupRF() loads the configuration (ISO14443A 0x00/0x80, ISO15693 0x0D/0x8D) and switches the
+    // field on, which only succeeds from off. Off first; false only means it was off already.
+    iso14443_.setRF_off();
+    bool ok = (PN5180_POLL_ISO14443A == tech) ? iso14443_.setupRF() : iso15693_.setupRF();
+    if (!ok)
+    {
+        active_ = -1;
+        return false;
+    }
+    active_ = tech;
+    stats_[tech].switches++;
+    delayMicroseconds(guardUs[tech]);
+    return true;
+}
+
+bool PN5180Poller::detect(PN5180PollTech tech, PN5180PollResult &result)
+{
+    result.tech = tech;
+    if (PN5180_POLL_ISO14443A == tech)
+    {
+        // WUPA, so a card halted by an earlier pass is found again
+        return ISO14443_EC_OK == iso14443_.activate(result.iso14443, true);
+    }
+    return ISO15693_EC_OK == iso15693_.getInventory(result.iso15693);
+}
+
+bool PN5180Poller::poll(PN5180PollResult &result)
+{
+    uint32_t start = micros();
+
+    for (uint8_t i = 0; i < PN5180_POLL_TECH_COUNT; i++)
+    {
+        PN5180PollTech tech = (PN5180PollTech)((next_ + i) % PN5180_POLL_TECH_COUNT);
+        if (!enabled_[tech] || !select(tech))
+        {
+            continue;
+        }
+
+        PN5180PollStats &s = stats_[tech];
+        s.attempts++;
+        if (detect(tech, result))
+        {
+            uint32_t us = micros() - start;
+            s.found++;
+            s.latencySumUs += us;
+            if (us < s.latencyMinUs)
+            {
+                s.latencyMinUs = us;
+            }
+            if (us > s.latencyMaxUs)
+            {
+                s.latencyMaxUs = us;
+            }
+            next_ = (tech + 1) % PN5180_POLL_TECH_COUNT;
+            return true;
+        }
+    }
+
+    // nothing found: the next round starts where the RF configuration already is
+    if (active_ >= 0)
+    {
+        next_ = active_;
+    }
+    return false;
+}
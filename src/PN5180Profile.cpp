@@ -0,0 +1,100 @@
+// NAME: PN5180Profile.cpp
+//
+// DESC: Cycle-counter latency profiling of the PN5180 driver.
+//
+// This file is part of the PN5180 library for the Arduino environment.
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// Lesser General Public License for more details.
+//
+#include <Arduino.h>
+#include "PN5180Profile.h"
+
+#ifdef PN5180_PROFILE
+#include "ReportProtocol.h"
+#if defined(__arm__)
+#include "stm32f10x.h"
+#endif
+
+PN5180ProfileStats pn5180Profile[PN5180_PROF_COUNT];
+uint16_t pn5180ProfileTicksPerUs;
+
+void pn5180ProfileBegin()
+{
+#if defined(__arm__)
+    CycleCounterStart();
+    pn5180ProfileTicksPerUs = SystemCoreClock / 1000000;
+#else
+    pn5180ProfileTicksPerUs = 1000;
+#endif
+    pn5180ProfileReset();
+}
+
+void pn5180ProfileReset()
+{
+    memset(pn5180Profile, 0, sizeof(pn5180Profile));
+    for (uint8_t i = 0; i < PN5180_PROF_COUNT; i++)
+    {
+        pn5180Profile[i].min = 0xffffffff;
+    }
+}
+
+void pn5180ProfileAdd(uint8_t probe, uint32_t ticks)
+{
+    if (probe >= PN5180_PROF_COUNT)
+    {
+        return;
+    }
+
+    PN5180ProfileStats &s = pn5180Profile[probe];
+    s.count++;
+    s.sum += ticks;
+    if (ticks < s.min)
+    {
+        s.min = ticks;
+    }
+    if (ticks > s.max)
+    {
+        s.max = ticks;
+    }
+
+    // bucket = floor(log2(us)), 0 below 2 us
+    uint32_t us = pn5180ProfileTicksPerUs ? ticks / pn5180ProfileTicksPerUs : 0;
+    uint8_t bucket = (us < 2) ? 0 : 31 - __builtin_clz(us);
+    if (bucket >= PN5180_PROFILE_BUCKETS)
+    {
+        bucket = PN5180_PROFILE_BUCKETS - 1;
+    }
+    if (s.histogram[bucket] != 0xffff)
+    {
+        s.histogram[bucket]++;
+    }
+}
+
+uint8_t pn5180ProfileReport(Print &out)
+{
+    uint8_t sent = 0;
+    for (uint8_t i = 0; i < PN5180_PROF_COUNT; i++)
+    {
+        if (pn5180Profile[i].count > 0)
+        {
+            reportProfile(out, i, pn5180Profile[i], pn5180ProfileTicksPerUs);
+            sent++;
+            reportFrameSent(out);
+        }
+    }
+    if (0 == sent)
+    {
+        reportProfile(out, 0, pn5180Profile[0], pn5180ProfileTicksPerUs);
+        sent++;
+    }
+    return sent;
+}
+#endif
@@ -0,0 +1,1039 @@
+#ifndef RC522DRIVER_H
+#define RC522DRIVER_H
+
+#include <stdint.h>
+#include "stm32f10x.h"
+#include "stm32f10x_gpio.h"
+#include "stm32f10x_rcc.h"
+#include "stm32f10x_spi.h"
+#include "stm32f10x_exti.h"
+#include "misc.h"
+#include "GpioPin.h"
+#include "rc522.h"
+#include "crc_a.h"
+
+/*
+ * MFRC522 driver bound to its wiring at compile time.
+ *
+ *   Rc522<Transport, RstPin, IrqPin>
+ *
+ * Transport is HwSpi<> or BitBangSpi<> below, the pins are GpioPin<>
+ * types. Everything a pin toggle needs is a template argument, so chip
+ * select, reset and the bit-banged clock compile to single BSRR/BRR
+ * stores. Each object has its own register shadow, IRQ flag and bus
+ * counters, so several readers on different pins can run side by side:
+ *
+ *   typedef GpioPin<GPIOA_BASE, 4> Nss2;
+ *   Rc522<HwSpi<SPI1_BASE, SPI_BaudRatePrescaler_8,
+ *               GpioPin<GPIOA_BASE, 5>, GpioPin<GPIOA_BASE, 6>, GpioPin<GPIOA_BASE, 7>, Nss2>,
+ *         GpioPin<GPIOA_BASE, 3>> reader2;
+ *
+ * With an IRQ pin, the owner of the EXTI vector calls onIrq(); without one
+ * (NoPin) transceive polls ComIrqReg. The C API in rc522.h is a default
+ * instance wired as described there.
+ */
+
+/*
+ * SPI peripheral transport, mode 0, MSB first, NSS driven as a GPIO so it
+ * frames every address/data sequence.
+ */
+template <uint32_t SpiBase, uint16_t Prescaler, class Sck, class Miso, class Mosi, class Nss>
+struct HwSpi
+{
+    static SPI_TypeDef *spi()
+    {
+        return (SPI_TypeDef *)SpiBase;
+    }
+
+    static void init()
+    {
+        SPI_InitTypeDef SPI_InitStructure;
+
+        if (SpiBase == SPI1_BASE)
+        {
+            RCC_APB2PeriphClockCmd(RCC_APB2Periph_SPI1, ENABLE);
+        }
+        else
+        {
+            RCC_APB1PeriphClockCmd(SpiBase == SPI2_BASE ? RCC_APB1Periph_SPI2 : RCC_APB1Periph_SPI3, ENABLE);
+        }
+
+        // SCK and MOSI are driven by the SPI peripheral
+        Sck::mode(GPIO_Mode_AF_PP, GPIO_Speed_50MHz);
+        Mosi::mode(GPIO_Mode_AF_PP, GPIO_Speed_50MHz);
+        Miso::mode(GPIO_Mode_IN_FLOATING, GPIO_Speed_50MHz);
+        Nss::high();
+        Nss::mode(GPIO_Mode_Out_PP, GPIO_Speed_50MHz);
+
+        SPI_InitStructure.SPI_Direction = SPI_Direction_2Lines_FullDuplex;
+        SPI_InitStructure.SPI_Mode = SPI_Mode_Master;
+        SPI_InitStructure.SPI_DataSize = SPI_DataSize_8b;
+        SPI_InitStructure.SPI_CPOL = SPI_CPOL_Low;
+        SPI_InitStructure.SPI_CPHA = SPI_CPHA_1Edge;
+        SPI_InitStructure.SPI_NSS = SPI_NSS_Soft;
+        SPI_InitStructure.SPI_BaudRatePrescaler = Prescaler;
+        SPI_InitStructure.SPI_FirstBit = SPI_FirstBit_MSB;
+        SPI_InitStructure.SPI_CRCPolynomial = 7;
+        SPI_Init(spi(), &SPI_InitStructure);
+        SPI_Cmd(spi(), ENABLE);
+    }
+
+    static void select()
+    {
+        Nss::low();
+    }
+
+    static void deselect()
+    {
+        Nss::high();
+    }
+
+    static uint8_t transfer(uint8_t value)
+    {
+        while (!(spi()->SR & SPI_I2S_FLAG_TXE))
+            ;
+        spi()->DR = value;
+        while (!(spi()->SR & SPI_I2S_FLAG_RXNE))
+            ;
+        return (uint8_t)spi()->DR;
+    }
+};
+
+/*
+ * Software SPI on any four GPIOs, mode 0: MOSI changes while SCK is low,
+ * MISO is sampled after the rising edge.
+ */
+template <class Sck, class Miso, class Mosi, class Nss>
+struct BitBangSpi
+{
+    static void init()
+    {
+        Miso::mode(GPIO_Mode_IN_FLOATING);
+        Mosi::output();
+        Sck::output();
+        Nss::high();
+        Nss::output();
+    }
+
+    static void select()
+    {
+        Sck::low();
+        Nss::low();
+    }
+
+    static void deselect()
+    {
+        Nss::high();
+    }
+
+    static uint8_t transfer(uint8_t value)
+    {
+        uint8_t result = 0;
+
+        for (uint8_t i = 8; i > 0; i--)
+        {
+            Sck::low();
+            Mosi::write(value & 0x80);
+            Sck::high();
+            value <<= 1;
+            result <<= 1;
+            if (Miso::read())
+            {
+                result |= 1;
+            }
+        }
+        Sck::low();
+        return result;
+    }
+};
+
+/*
+ * Register shadow description, shared by all instances.
+ *
+ * owned: bits only the host changes; SetBitMask/ClearBitMask write them
+ * from the shadow without reading the chip first. The other bits are
+ * read-only or write-1 strobes where writing 0 does nothing. keep: bits
+ * the chip sets and a written 0 clears; the read can only be skipped when
+ * the operation clears them anyway. The interrupt request registers use
+ * Set-bit semantics: clearing means Set = 0 and 1s in the bits to clear.
+ */
+struct Rc522Shadow
+{
+    enum
+    {
+        IRQ = 0x01,
+        COUNT = 8
+    };
+
+    struct Desc
+    {
+        uint8_t reg;
+        uint8_t owned;
+        uint8_t keep;
+        uint8_t flags;
+        uint8_t reset;          // value after soft reset
+    };
+
+    static constexpr Desc desc[COUNT] = {
+        {ComIrqReg, 0x00, 0x00, IRQ, 0x00},
+        {DivIrqReg, 0x00, 0x00, IRQ, 0x00},
+        {Status2Reg, 0xC0, 0x08, 0, 0x00},      // MFCrypto1On is set by authentication, cleared by writing 0
+        {FIFOLevelReg, 0x00, 0x00, 0, 0x00},    // FlushBuffer strobe, level read-only
+        {ControlReg, 0x00, 0x00, 0, 0x00},      // TStopNow/TStartNow strobes, RxLastBits read-only
+        {BitFramingReg, 0xFF, 0x00, 0, 0x00},
+        {CollReg, 0x80, 0x00, 0, 0x80},         // ValuesAfterColl, CollPos read-only
+        {TxControlReg, 0xFF, 0x00, 0, 0x80},
+    };
+
+    // slot of reg, -1 if not shadowed; folds to a constant for constant reg
+    static constexpr int find(uint8_t reg, int i = 0)
+    {
+        return (i >= COUNT) ? -1 : (desc[i].reg == reg) ? i : find(reg, i + 1);
+    }
+};
+
+template <class Transport, class Rst, class Irq = NoPin>
+class Rc522
+{
+public:
+    // RC522 timer deadline for transceive, 0.5 ms per tick after PcdReset
+    static constexpr unsigned int TIMEOUT_MS = MF522_TIMEOUT_MS;
+
+    Rc522() : irqFlag_(0), busTransactions_(0), busSaved_(0)
+    {
+        resetShadow();
+    }
+
+    Rc522(const Rc522 &) = delete;
+    Rc522 &operator=(const Rc522 &) = delete;
+
+    void init();
+    char reset();
+    char configISOType(uint8_t type);
+    void setTimeout(unsigned int ms);
+    void antennaOn();
+    void antennaOff();
+
+    char request(uint8_t reqCode, uint8_t *pTagType);
+    char anticoll(uint8_t *pSnr);
+    char select(const uint8_t *pSnr);
+    char selectUid(PiccUid *pUid);
+    uint8_t enumerate(uint8_t reqCode, PiccUid *pUids, uint8_t maxCount);
+    char authState(uint8_t authMode, uint8_t addr, const uint8_t *pKey, const uint8_t *pSnr);
+    char read(uint8_t addr, uint8_t *pData);
+    char write(uint8_t addr, const uint8_t *pData);
+    char halt();
+    void waitCardOff();
+
+    char transceive(uint8_t command, const uint8_t *pInData, uint8_t inLenByte, uint8_t *pOutData,
+                    unsigned int *pOutLenBit);
+
+    uint8_t readReg(uint8_t address);
+    void writeReg(uint8_t address, uint8_t value);
+    void readRegBurst(uint8_t address, uint8_t *pData, uint8_t len);
+    void writeRegBurst(uint8_t address, const uint8_t *pData, uint8_t len);
+    void setBitMask(uint8_t reg, uint8_t mask);
+    void clearBitMask(uint8_t reg, uint8_t mask);
+
+    // chip-selects issued, and register reads the shadow avoided
+    unsigned long busTransactions() const { return busTransactions_; }
+    unsigned long busSaved() const { return busSaved_; }
+    void busStatsReset()
+    {
+        busTransactions_ = 0;
+        busSaved_ = 0;
+    }
+
+    // call from the EXTI vector serving Irq
+    void onIrq()
+    {
+        if (EXTI->PR & Irq::EXTI_LINE)
+        {
+            EXTI->PR = Irq::EXTI_LINE;
+            irqFlag_ = 1;
+        }
+    }
+
+private:
+    enum
+    {
+        MAXRLEN = 18,
+        IRQ_BACKSTOP = MF522_IRQ_BACKSTOP,
+        POLL_BACKSTOP = MF522_POLL_BACKSTOP
+    };
+
+    void initIrq();
+    bool waitIrq(uint8_t waitFor);
+    char anticollLevel(uint8_t sel, uint8_t *pBuf);
+
+    void resetShadow()
+    {
+        for (int i = 0; i < Rc522Shadow::COUNT; i++)
+        {
+            shadow_[i] = Rc522Shadow::desc[i].reset;
+        }
+    }
+
+    void noteShadow(uint8_t reg, uint8_t value)
+    {
+        int i = Rc522Shadow::find(reg);
+        if (i >= 0)
+        {
+            shadow_[i] = value & Rc522Shadow::desc[i].owned;
+        }
+    }
+
+    bool updateShadow(uint8_t reg, uint8_t mask, bool set);
+
+    volatile uint8_t irqFlag_;          // set by onIrq, cleared by transceive
+    uint8_t shadow_[Rc522Shadow::COUNT];
+    unsigned long busTransactions_;
+    unsigned long busSaved_;
+};
+
+template <class Transport, class Rst, class Irq>
+void Rc522<Transport, Rst, Irq>::init()
+{
+    Rst::output();
+    Transport::init();
+    initIrq();
+}
+
+/*
+ * IRQ pin as EXTI falling edge input. The chip drives it push-pull,
+ * active low (DivlEnReg, ComIEnReg IRqInv).
+ */
+template <class Transport, class Rst, class Irq>
+void Rc522<Transport, Rst, Irq>::initIrq()
+{
+    if (!Irq::PRESENT)
+    {
+        return;
+    }
+
+    EXTI_InitTypeDef EXTI_InitStructure;
+    NVIC_InitTypeDef NVIC_InitStructure;
+
+    RCC_APB2PeriphClockCmd(RCC_APB2Periph_AFIO, ENABLE);
+    Irq::mode(GPIO_Mode_IPU);
+    GPIO_EXTILineConfig(Irq::PORT_SOURCE, Irq::PIN);
+
+    EXTI_InitStructure.EXTI_Line = Irq::EXTI_LINE;
+    EXTI_InitStructure.EXTI_Mode = EXTI_Mode_Interrupt;
+    EXTI_InitStructure.EXTI_Trigger = EXTI_Trigger_Falling;
+    EXTI_InitStructure.EXTI_LineCmd = ENABLE;
+    EXTI_Init(&EXTI_InitStructure);
+
+    NVIC_InitStructure.NVIC_IRQChannel = Irq::EXTI_IRQN;
+    NVIC_InitStructure.NVIC_IRQChannelPreemptionPriority = 1;
+    NVIC_InitStructure.NVIC_IRQChannelSubPriority = 0;
+    NVIC_InitStructure.NVIC_IRQChannelCmd = ENABLE;
+    NVIC_Init(&NVIC_InitStructure);
+}
+
+template <class Transport, class Rst, class Irq>
+char Rc522<Transport, Rst, Irq>::reset()
+{
+    Rst::high();
+    delay_10ms(1);
+    Rst::low();
+    delay_10ms(1);
+    Rst::high();
+    delay_10ms(10);
+
+    writeReg(CommandReg, PCD_RESETPHASE);
+    resetShadow();
+
+    writeReg(ModeReg, 0x3D);            // CRC preset 0x6363 for MIFARE
+    setTimeout(TIMEOUT_MS);
+    writeReg(TModeReg, 0x8D);           // TAuto: the timer starts at the end of each transmission
+    writeReg(TPrescalerReg, 0x3E);      // 0xD3E: 0.5 ms per tick
+    writeReg(TxAutoReg, 0x40);
+    writeReg(DivlEnReg, 0x80);          // IRQ pin push-pull
+    return MI_OK;
+}
+
+template <class Transport, class Rst, class Irq>
+void Rc522<Transport, Rst, Irq>::setTimeout(unsigned int ms)
+{
+    unsigned long reload = (unsigned long)ms * 2;
+    if (reload > 0xFFFF)
+    {
+        reload = 0xFFFF;
+    }
+    writeReg(TReloadRegL, (uint8_t)reload);
+    writeReg(TReloadRegH, (uint8_t)(reload >> 8));
+}
+
+template <class Transport, class Rst, class Irq>
+char Rc522<Transport, Rst, Irq>::configISOType(uint8_t type)
+{
+    if (type != 'A')
+    {
+        return (char)-1;
+    }
+
+    clearBitMask(Status2Reg, 0x08);
+    writeReg(ModeReg, 0x3D);
+    writeReg(RxSelReg, 0x86);
+    writeReg(RFCfgReg, 0x7F);
+    setTimeout(TIMEOUT_MS);
+    writeReg(TModeReg, 0x8D);
+    writeReg(TPrescalerReg, 0x3E);
+    delay_10ms(1);
+    antennaOn();
+    return MI_OK;
+}
+
+// at least 1 ms between switching the antenna on and off
+template <class Transport, class Rst, class Irq>
+void Rc522<Transport, Rst, Irq>::antennaOn()
+{
+    // from the shadow, no read
+    busSaved_++;
+    if (!(shadow_[Rc522Shadow::find(TxControlReg)] & 0x03))
+    {
+        setBitMask(TxControlReg, 0x03);
+    }
+}
+
+template <class Transport, class Rst, class Irq>
+void Rc522<Transport, Rst, Irq>::antennaOff()
+{
+    clearBitMask(TxControlReg, 0x03);
+}
+
+template <class Transport, class Rst, class Irq>
+char Rc522<Transport, Rst, Irq>::request(uint8_t reqCode, uint8_t *pTagType)
+{
+    char status;
+    unsigned int unLen;
+    uint8_t buf[MAXRLEN];
+
+    clearBitMask(Status2Reg, 0x08);
+    writeReg(BitFramingReg, 0x07);
+    setBitMask(TxControlReg, 0x03);
+
+    buf[0] = reqCode;
+    status = transceive(PCD_TRANSCEIVE, buf, 1, buf, &unLen);
+    // the ATQAs of several cards may collide; that still means a card answered
+    if (((status == MI_OK) || (status == MI_COLLERR)) && (unLen == 0x10))
+    {
+        pTagType[0] = buf[0];
+        pTagType[1] = buf[1];
+        return MI_OK;
+    }
+    return MI_ERR;
+}
+
+template <class Transport, class Rst, class Irq>
+char Rc522<Transport, Rst, Irq>::anticoll(uint8_t *pSnr)
+{
+    char status;
+    uint8_t i, snrCheck = 0;
+    unsigned int unLen;
+    uint8_t buf[MAXRLEN];
+
+    clearBitMask(Status2Reg, 0x08);
+    writeReg(BitFramingReg, 0x00);
+    clearBitMask(CollReg, 0x80);
+
+    buf[0] = PICC_ANTICOLL1;
+    buf[1] = 0x20;
+    status = transceive(PCD_TRANSCEIVE, buf, 2, buf, &unLen);
+    if (status == MI_OK)
+    {
+        for (i = 0; i < 4; i++)
+        {
+            pSnr[i] = buf[i];
+            snrCheck ^= buf[i];
+        }
+        if (snrCheck != buf[4])
+        {
+            status = MI_ERR;
+        }
+    }
+
+    setBitMask(CollReg, 0x80);
+    return status;
+}
+
+template <class Transport, class Rst, class Irq>
+char Rc522<Transport, Rst, Irq>::select(const uint8_t *pSnr)
+{
+    char status;
+    uint8_t i;
+    unsigned int unLen;
+    uint8_t buf[MAXRLEN];
+
+    buf[0] = PICC_ANTICOLL1;
+    buf[1] = 0x70;
+    buf[6] = 0;
+    for (i = 0; i < 4; i++)
+    {
+        buf[i + 2] = pSnr[i];
+        buf[6] ^= pSnr[i];
+    }
+    CrcAAppend(buf, 7, &buf[7]);
+
+    clearBitMask(Status2Reg, 0x08);
+    status = transceive(PCD_TRANSCEIVE, buf, 9, buf, &unLen);
+    return ((status == MI_OK) && (unLen == 0x18)) ? MI_OK : MI_ERR;
+}
+
+/*
+ * One cascade level of bitwise anticollision. pBuf[2..6] receives the
+ * level's four UID bytes and BCC. On a collision the 1-branch is taken
+ * and the known bits are sent again; cards answer from the next bit on.
+ */
+template <class Transport, class Rst, class Irq>
+char Rc522<Transport, Rst, Irq>::anticollLevel(uint8_t sel, uint8_t *pBuf)
+{
+    char status;
+    uint8_t i, n, coll, known = 0;
+    uint8_t index, rxAlign, mask, txLen;
+    unsigned int unLen;
+    uint8_t rxBuf[MAXRLEN];
+
+    pBuf[0] = sel;
+    for (i = 2; i < 7; i++)
+    {
+        pBuf[i] = 0;
+    }
+
+    for (;;)
+    {
+        index = 2 + known / 8;
+        rxAlign = known % 8;
+        txLen = index + (rxAlign ? 1 : 0);
+        pBuf[1] = (uint8_t)((index << 4) | rxAlign);
+        writeReg(BitFramingReg, (uint8_t)((rxAlign << 4) | rxAlign));
+
+        status = transceive(PCD_TRANSCEIVE, pBuf, txLen, rxBuf, &unLen);
+        if ((status != MI_OK) && (status != MI_COLLERR))
+        {
+            break;
+        }
+
+        // merge the answer: only the bits above rxAlign of the first byte are new
+        n = (uint8_t)((unLen + 7) / 8);
+        mask = (uint8_t)(0xFF << rxAlign);
+        for (i = 0; (i < n) && (index + i < 7); i++)
+        {
+            if (i == 0)
+            {
+                pBuf[index] = (pBuf[index] & ~mask) | (rxBuf[0] & mask);
+            }
+            else
+            {
+                pBuf[index + i] = rxBuf[i];
+            }
+        }
+
+        if (status == MI_OK)
+        {
+            if ((pBuf[2] ^ pBuf[3] ^ pBuf[4] ^ pBuf[5]) != pBuf[6])
+            {
+                status = MI_ERR;
+            }
+            break;
+        }
+
+        // collision position 1..32
+        coll = readReg(CollReg);
+        if (coll & 0x20)
+        {
+            status = MI_ERR;
+            break;
+        }
+        coll &= 0x1F;
+        if (coll == 0)
+        {
+            coll = 32;
+        }
+        if (coll <= known)
+        {
+            status = MI_ERR;
+            break;
+        }
+        known = coll;
+        pBuf[2 + (known - 1) / 8] |= (uint8_t)(1 << ((known - 1) % 8));
+    }
+
+    writeReg(BitFramingReg, 0x00);
+    return status;
+}
+
+// full anticollision and select over cascade levels 1-3 (4/7/10 byte UID)
+template <class Transport, class Rst, class Irq>
+char Rc522<Transport, Rst, Irq>::selectUid(PiccUid *pUid)
+{
+    static const uint8_t sel[3] = {PICC_ANTICOLL1, PICC_ANTICOLL2, PICC_ANTICOLL3};
+    char status = MI_ERR;
+    uint8_t level, i;
+    unsigned int unLen;
+    uint8_t buf[MAXRLEN];
+    uint8_t sak[MAXRLEN];
+
+    pUid->size = 0;
+    clearBitMask(Status2Reg, 0x08);
+    clearBitMask(CollReg, 0x80);        // bits after a collision read as 0
+
+    for (level = 0; level < 3; level++)
+    {
+        status = anticollLevel(sel[level], buf);
+        if (status != MI_OK)
+        {
+            break;
+        }
+
+        // SELECT: SEL 70 UID0-3 BCC CRC_A
+        buf[0] = sel[level];
+        buf[1] = 0x70;
+        CrcAAppend(buf, 7, &buf[7]);
+        status = transceive(PCD_TRANSCEIVE, buf, 9, sak, &unLen);
+        if ((status != MI_OK) || (unLen != 0x18))
+        {
+            status = MI_ERR;
+            break;
+        }
+        CrcAAppend(sak, 1, &sak[3]);
+        if ((sak[1] != sak[3]) || (sak[2] != sak[4]))
+        {
+            status = MI_ERR;
+            break;
+        }
+
+        // SAK CRC_A; with the cascade bit set the first byte was CT
+        pUid->sak = sak[0];
+        if (pUid->sak & 0x04)
+        {
+            for (i = 0; i < 3; i++)
+            {
+                pUid->uidByte[pUid->size++] = buf[3 + i];
+            }
+        }
+        else
+        {
+            for (i = 0; i < 4; i++)
+            {
+                pUid->uidByte[pUid->size++] = buf[2 + i];
+            }
+            break;
+        }
+    }
+    // cascade bit still set after level 3
+    if ((status == MI_OK) && (pUid->sak & 0x04))
+    {
+        status = MI_ERR;
+    }
+
+    setBitMask(CollReg, 0x80);
+    return status;
+}
+
+// every card selected is HALTed, so the next REQA finds the next one
+template <class Transport, class Rst, class Irq>
+uint8_t Rc522<Transport, Rst, Irq>::enumerate(uint8_t reqCode, PiccUid *pUids, uint8_t maxCount)
+{
+    uint8_t count = 0, failures = 0;
+    uint8_t tagType[2];
+
+    while ((count < maxCount) && (failures < 3))
+    {
+        if (request(count ? PICC_REQIDL : reqCode, tagType) != MI_OK)
+        {
+            break;
+        }
+        if (selectUid(&pUids[count]) == MI_OK)
+        {
+            halt();
+            count++;
+            failures = 0;
+        }
+        else
+        {
+            failures++;
+        }
+    }
+    return count;
+}
+
+template <class Transport, class Rst, class Irq>
+char Rc522<Transport, Rst, Irq>::authState(uint8_t authMode, uint8_t addr, const uint8_t *pKey, const uint8_t *pSnr)
+{
+    char status;
+    unsigned int unLen;
+    uint8_t i, buf[MAXRLEN];
+
+    buf[0] = authMode;
+    buf[1] = addr;
+    for (i = 0; i < 6; i++)
+    {
+        buf[i + 2] = pKey[i];
+    }
+    for (i = 0; i < 4; i++)
+    {
+        buf[i + 8] = pSnr[i];
+    }
+
+    status = transceive(PCD_AUTHENT, buf, 12, buf, &unLen);
+    if ((status != MI_OK) || (!(readReg(Status2Reg) & 0x08)))
+    {
+        status = MI_ERR;
+    }
+    return status;
+}
+
+template <class Transport, class Rst, class Irq>
+char Rc522<Transport, Rst, Irq>::read(uint8_t addr, uint8_t *pData)
+{
+    char status;
+    unsigned int unLen;
+    uint8_t i, buf[MAXRLEN];
+
+    buf[0] = PICC_READ;
+    buf[1] = addr;
+    CrcAAppend(buf, 2, &buf[2]);
+
+    status = transceive(PCD_TRANSCEIVE, buf, 4, buf, &unLen);
+    if ((status != MI_OK) || (unLen != 0x90))
+    {
+        return MI_ERR;
+    }
+    for (i = 0; i < 16; i++)
+    {
+        pData[i] = buf[i];
+    }
+    return MI_OK;
+}
+
+template <class Transport, class Rst, class Irq>
+char Rc522<Transport, Rst, Irq>::write(uint8_t addr, const uint8_t *pData)
+{
+    char status;
+    unsigned int unLen;
+    uint8_t i, buf[MAXRLEN];
+
+    buf[0] = PICC_WRITE;
+    buf[1] = addr;
+    CrcAAppend(buf, 2, &buf[2]);
+
+    status = transceive(PCD_TRANSCEIVE, buf, 4, buf, &unLen);
+    if ((status != MI_OK) || (unLen != 4) || ((buf[0] & 0x0F) != 0x0A))
+    {
+        return MI_ERR;
+    }
+
+    for (i = 0; i < 16; i++)
+    {
+        buf[i] = pData[i];
+    }
+    CrcAAppend(buf, 16, &buf[16]);
+
+    status = transceive(PCD_TRANSCEIVE, buf, 18, buf, &unLen);
+    if ((status != MI_OK) || (unLen != 4) || ((buf[0] & 0x0F) != 0x0A))
+    {
+        return MI_ERR;
+    }
+    return MI_OK;
+}
+
+template <class Transport, class Rst, class Irq>
+char Rc522<Transport, Rst, Irq>::halt()
+{
+    unsigned int unLen;
+    uint8_t buf[MAXRLEN];
+
+    buf[0] = PICC_HALT;
+    buf[1] = 0;
+    CrcAAppend(buf, 2, &buf[2]);
+
+    transceive(PCD_TRANSCEIVE, buf, 4, buf, &unLen);
+    return MI_OK;
+}
+
+/*
+ * A card that answers is HALTed at once, so the next WUPA is sure to get
+ * an answer again while it is in the field; two misses in a row (one
+ * timeout each) mean it has left.
+ */
+template <class Transport, class Rst, class Irq>
+void Rc522<Transport, Rst, Irq>::waitCardOff()
+{
+    uint8_t misses = 0;
+    uint8_t tagType[2];
+
+    while (misses < 2)
+    {
+        if (request(REQ_ALL, tagType) == MI_OK)
+        {
+            halt();
+            misses = 0;
+        }
+        else
+        {
+            misses++;
+        }
+    }
+}
+
+/*
+ * Wait for one of waitFor or the timer interrupt. With an IRQ pin the
+ * flag set by onIrq is polled, otherwise ComIrqReg itself. The RC522
+ * timer is the real deadline; the count is a backstop for a dead chip or
+ * IRQ line, in flag spins or in register reads.
+ */
+template <class Transport, class Rst, class Irq>
+bool Rc522<Transport, Rst, Irq>::waitIrq(uint8_t waitFor)
+{
+    unsigned long i = Irq::PRESENT ? IRQ_BACKSTOP : POLL_BACKSTOP;
+
+    if (Irq::PRESENT)
+    {
+        while (!irqFlag_ && (i != 0))
+        {
+            i--;
+        }
+    }
+    else
+    {
+        while (!(readReg(ComIrqReg) & (waitFor | 0x01)) && (i != 0))
+        {
+            i--;
+        }
+    }
+    return i != 0;
+}
+
+/*
+ * Send pInData through the FIFO, run command and collect the card's
+ * answer. *pOutLenBit is the answer length in bits. CollErr alone
+ * returns MI_COLLERR with the bits received up to the collision.
+ */
+template <class Transport, class Rst, class Irq>
+char Rc522<Transport, Rst, Irq>::transceive(uint8_t command, const uint8_t *pInData, uint8_t inLenByte,
+                                            uint8_t *pOutData, unsigned int *pOutLenBit)
+{
+    char status = MI_ERR;
+    uint8_t irqEn = 0x00;
+    uint8_t waitFor = 0x00;
+    uint8_t lastBits;
+    uint8_t n = 0;
+    bool done;
+
+    switch (command)
+    {
+    case PCD_AUTHENT:
+        irqEn = 0x12;
+        waitFor = 0x10;
+        break;
+    case PCD_TRANSCEIVE:
+        irqEn = 0x77;
+        waitFor = 0x30;
+        break;
+    default:
+        break;
+    }
+
+    // the IRQ pin only reflects the awaited events and the timer, IRqInv = 1 (active low)
+    writeReg(ComIEnReg, waitFor | 0x01 | 0x80);
+    clearBitMask(ComIrqReg, 0x80);
+    irqFlag_ = 0;
+    writeReg(CommandReg, PCD_IDLE);
+    setBitMask(FIFOLevelReg, 0x80);
+
+    writeRegBurst(FIFODataReg, pInData, inLenByte);
+    writeReg(CommandReg, command);
+
+    if (command == PCD_TRANSCEIVE)
+    {
+        setBitMask(BitFramingReg, 0x80);
+    }
+
+    done = waitIrq(waitFor);
+    if (done)
+    {
+        n = readReg(ComIrqReg);
+    }
+    clearBitMask(BitFramingReg, 0x80);
+
+    if (done)
+    {
+        lastBits = readReg(ErrorReg);
+        if (!(lastBits & 0x13))     // no buffer overflow, parity or protocol error
+        {
+            status = (lastBits & 0x08) ? MI_COLLERR : MI_OK;
+            if (n & irqEn & 0x01)
+            {
+                status = MI_NOTAGERR;
+            }
+            if (command == PCD_TRANSCEIVE)
+            {
+                n = readReg(FIFOLevelReg);
+                lastBits = readReg(ControlReg) & 0x07;
+                if (lastBits)
+                {
+                    *pOutLenBit = (n - 1) * 8 + lastBits;
+                }
+                else
+                {
+                    *pOutLenBit = n * 8;
+                }
+                if (n == 0)
+                {
+                    n = 1;
+                }
+                if (n > MAXRLEN)
+                {
+                    n = MAXRLEN;
+                }
+                readRegBurst(FIFODataReg, pOutData, n);
+            }
+        }
+        else
+        {
+            status = MI_ERR;
+        }
+    }
+    writeReg(ComIEnReg, 0x80);      // sources off, IRQ pin back high
+
+    setBitMask(ControlReg, 0x80);   // stop timer now
+    writeReg(CommandReg, PCD_IDLE);
+    return status;
+}
+
+template <class Transport, class Rst, class Irq>
+uint8_t Rc522<Transport, Rst, Irq>::readReg(uint8_t address)
+{
+    uint8_t result;
+
+    busTransactions_++;
+    Transport::select();
+    Transport::transfer(((address << 1) & 0x7E) | 0x80);
+    result = Transport::transfer(0x00);
+    Transport::deselect();
+    return result;
+}
+
+template <class Transport, class Rst, class Irq>
+void Rc522<Transport, Rst, Irq>::writeReg(uint8_t address, uint8_t value)
+{
+    busTransactions_++;
+    noteShadow(address, value);
+    Transport::select();
+    Transport::transfer((address << 1) & 0x7E);
+    Transport::transfer(value);
+    Transport::deselect();
+}
+
+/*
+ * Burst read of one register (the FIFO) under a single chip-select: each
+ * address byte clocks in the previous read, a final 0 ends the burst.
+ */
+template <class Transport, class Rst, class Irq>
+void Rc522<Transport, Rst, Irq>::readRegBurst(uint8_t address, uint8_t *pData, uint8_t len)
+{
+    uint8_t i, addr;
+
+    if (len == 0)
+    {
+        return;
+    }
+    addr = ((address << 1) & 0x7E) | 0x80;
+    busTransactions_++;
+    Transport::select();
+    Transport::transfer(addr);
+    for (i = 0; i < len - 1; i++)
+    {
+        pData[i] = Transport::transfer(addr);
+    }
+    pData[len - 1] = Transport::transfer(0x00);
+    Transport::deselect();
+}
+
+// burst write: the address goes out once, then all data bytes
+template <class Transport, class Rst, class Irq>
+void Rc522<Transport, Rst, Irq>::writeRegBurst(uint8_t address, const uint8_t *pData, uint8_t len)
+{
+    uint8_t i;
+
+    if (len == 0)
+    {
+        return;
+    }
+    busTransactions_++;
+    Transport::select();
+    Transport::transfer((address << 1) & 0x7E);
+    for (i = 0; i < len; i++)
+    {
+        Transport::transfer(pData[i]);
+    }
+    Transport::deselect();
+}
+
+// set or clear mask on a shadowed register with one write; false if a read is needed
+template <class Transport, class Rst, class Irq>
+bool Rc522<Transport, Rst, Irq>::updateShadow(uint8_t reg, uint8_t mask, bool set)
+{
+    uint8_t value;
+    int i = Rc522Shadow::find(reg);
+    if (i < 0)
+    {
+        return false;
+    }
+
+    if (Rc522Shadow::desc[i].flags & Rc522Shadow::IRQ)
+    {
+        // Set = 1 sets mask, Set = 0 clears it; clearing 0x80 clears everything
+        if (set)
+        {
+            value = 0x80 | mask;
+        }
+        else
+        {
+            value = (mask == 0x80) ? 0x7F : (mask & 0x7F);
+        }
+    }
+    else
+    {
+        if (Rc522Shadow::desc[i].keep & ~mask)
+        {
+            return false;
+        }
+        value = shadow_[i];
+        if (set)
+        {
+            value |= mask;
+        }
+        else
+        {
+            value &= ~mask;
+        }
+    }
+    writeReg(reg, value);
+    busSaved_++;
+    return true;
+}
+
+template <class Transport, class Rst, class Irq>
+void Rc522<Transport, Rst, Irq>::setBitMask(uint8_t reg, uint8_t mask)
+{
+    if (updateShadow(reg, mask, true))
+    {
+        return;
+    }
+    writeReg(reg, readReg(reg) | mask);
+}
+
+template <class Transport, class Rst, class Irq>
+void Rc522<Transport, Rst, Irq>::clearBitMask(uint8_t reg, uint8_t mask)
+{
+    if (updateShadow(reg, mask, false))
+    {
+        return;
+    }
+    writeReg(reg, readReg(reg) & ~mask);
+}
+
+#endif /* RC522DRIVER_H */
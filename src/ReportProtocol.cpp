@@ -0,0 +1,197 @@
+#include <Arduino.h>
+#include "ReportProtocol.h"
+#include "UartDmaTx.h"
+
+namespace
+{
+
+/*
+ * Streams one frame to a Print sink, CRC computed on the fly. The frame
+ * is one message: on uartTx it is queued or dropped as a whole, never
+ * sent with pieces missing.
+ */
+class FrameWriter
+{
+public:
+    FrameWriter(Print &out, uint8_t type, uint16_t len) : out_(out), crc_(0xFFFF), written_(0)
+    {
+        reportBeginMessage(out_, len + REPORT_OVERHEAD);
+        uint8_t head[REPORT_HEADER_LEN] = {REPORT_SYNC, type, (uint8_t)(len & 0xff), (uint8_t)(len >> 8)};
+        crc_ = reportCrc16(head + 1, 3, crc_);
+        written_ += out_.write(head, sizeof(head));
+    }
+
+    void put(const uint8_t *data, size_t len)
+    {
+        crc_ = reportCrc16(data, len, crc_);
+        written_ += out_.write(data, len);
+    }
+
+    void put(uint8_t b)
+    {
+        put(&b, 1);
+    }
+
+    void put32(uint32_t v)
+    {
+        uint8_t b[4] = {(uint8_t)v, (uint8_t)(v >> 8), (uint8_t)(v >> 16), (uint8_t)(v >> 24)};
+        put(b, 4);
+    }
+
+    void putUid(const Uid &uid)
+    {
+        uint8_t b[REPORT_UID_LEN];
+        uid.toBytes(b);
+        put(b, REPORT_UID_LEN);
+    }
+
+    size_t end()
+    {
+        uint16_t crc = ~crc_;
+        uint8_t tail[REPORT_TRAILER_LEN] = {(uint8_t)(crc & 0xff), (uint8_t)(crc >> 8)};
+        written_ += out_.write(tail, sizeof(tail));
+        reportEndMessage(out_);
+        return written_;
+    }
+
+private:
+    Print &out_;
+    uint16_t crc_;
+    size_t written_;
+};
+
+} // namespace
+
+size_t reportInventory(Print &out, const UidVec &uids)
+{
+    size_t written = 0;
+    int total = uids.size();
+    int first = 0;
+    do
+    {
+        int count = total - first;
+        uint8_t more = 0;
+        if (count > REPORT_INVENTORY_MAX_UIDS)
+        {
+            count = REPORT_INVENTORY_MAX_UIDS;
+            more = REPORT_INVENTORY_MORE;
+        }
+        FrameWriter frame(out, REPORT_INVENTORY, 1 + count * REPORT_UID_LEN);
+        frame.put(count | more);
+        for (int i = first; i < first + count; i++)
+        {
+            frame.putUid(uids[i]);
+        }
+        written += frame.end();
+        first += count;
+    } while (first < total);
+    return written;
+}
+
+size_t reportBlock(Print &out, const Uid &uid, uint8_t blockNo, const uint8_t *data, uint8_t len)
+{
+    FrameWriter frame(out, REPORT_BLOCK, REPORT_UID_LEN + 1 + len);
+    frame.putUid(uid);
+    frame.put(blockNo);
+    frame.put(data, len);
+    return frame.end();
+}
+
+size_t reportEvent(Print &out, const ReaderEvent &ev)
+{
+    FrameWriter frame(out, REPORT_EVENT, REPORT_EVENT_LEN);
+    frame.put32(ev.timestamp);
+    frame.put(ev.type);
+    frame.put(ev.code);
+    frame.put32(ev.value);
+    frame.putUid(ev.uid);
+    return frame.end();
+}
+
+size_t reportRaw(Print &out, const uint8_t *data, uint16_t len)
+{
+    FrameWriter frame(out, REPORT_RAW, len);
+    frame.put(data, len);
+    return frame.end();
+}
+
+size_t reportText(Print &out, const char *text)
+{
+    uint16_t len = strlen(text);
+    FrameWriter frame(out, REPORT_TEXT, len);
+    frame.put((const uint8_t *)text, len);
+    return frame.end();
+}
+
+size_t reportTrace(Print &out, const PN5180TraceRecord *records, uint8_t count, uint32_t overflows)
+{
+    FrameWriter frame(out, REPORT_TRACE, 1 + 4 + count * REPORT_TRACE_RECORD_LEN);
+    frame.put(count);
+    frame.put32(overflows);
+    for (uint8_t i = 0; i < count; i++)
+    {
+        const PN5180TraceRecord &r = records[i];
+        frame.put32(r.timestamp);
+        frame.put(r.event);
+        frame.put(r.arg);
+        frame.put(r.length & 0xff);
+        frame.put(r.length >> 8);
+        frame.put32(r.value);
+    }
+    return frame.end();
+}
+
+size_t reportProfile(Print &out, uint8_t probe, const PN5180ProfileStats &stats, uint16_t ticksPerUs)
+{
+    FrameWriter frame(out, REPORT_PROFILE, REPORT_PROFILE_HEADER_LEN + PN5180_PROFILE_BUCKETS * 2);
+    frame.put(probe);
+    frame.put(ticksPerUs & 0xff);
+    frame.put(ticksPerUs >> 8);
+    frame.put32(stats.count);
+    frame.put32(stats.count ? stats.min : 0);
+    frame.put32(stats.max);
+    frame.put32((uint32_t)stats.sum);
+    frame.put32((uint32_t)(stats.sum >> 32));
+    frame.put(PN5180_PROFILE_BUCKETS);
+    for (uint8_t i = 0; i < PN5180_PROFILE_BUCKETS; i++)
+    {
+        frame.put(stats.histogram[i] & 0xff);
+        frame.put(stats.histogram[i] >> 8);
+    }
+    return frame.end();
+}
+
+size_t reportCapture(Print &out, uint32_t dropped, const uint8_t *data, uint16_t len,
+                     const uint8_t *wrapped, uint16_t wrappedLen)
+{
+    FrameWriter frame(out, REPORT_CAPTURE, 4 + len + wrappedLen);
+    frame.put32(dropped);
+    frame.put(data, len);
+    frame.put(wrapped, wrappedLen);
+    return frame.end();
+}
+
+bool reportBeginMessage(Print &out, size_t size)
+{
+    if (&out == &uartTx)
+    {
+        return uartTx.beginMessage(size);
+    }
+    return true;
+}
+
+void reportEndMessage(Print &out)
+{
+    if (&out == &uartTx)
+    {
+        uartTx.endMessage();
+    }
+}
+
+void reportFrameSent(Print &out)
+{
+    if (&out == &uartTx)
+    {
+        uartTx.flush();
+    }
+}
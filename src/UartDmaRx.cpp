@@ -0,0 +1,81 @@
+#include <Arduino.h>
+#include "UartDmaRx.h"
+#include "stm32f10x_rcc.h"
+#include "stm32f10x_usart.h"
+#include "stm32f10x_dma.h"
+
+static_assert((UART_RX_BUFFER_SIZE & (UART_RX_BUFFER_SIZE - 1)) == 0, "UART_RX_BUFFER_SIZE must be a power of two");
+
+UartDmaRx uartRx;
+
+UartDmaRx::UartDmaRx() : tail_(0), overruns_(0)
+{
+}
+
+void UartDmaRx::begin()
+{
+    DMA_InitTypeDef DMA_InitStructure;
+
+    RCC_AHBPeriphClockCmd(RCC_AHBPeriph_DMA1, ENABLE);
+
+    DMA_DeInit(UART_RX_DMA_CHANNEL);
+    DMA_InitStructure.DMA_PeripheralBaseAddr = (uint32_t)&UART_PORT->DR;
+    DMA_InitStructure.DMA_MemoryBaseAddr = (uint32_t)buffer_;
+    DMA_InitStructure.DMA_DIR = DMA_DIR_PeripheralSRC;
+    DMA_InitStructure.DMA_BufferSize = UART_RX_BUFFER_SIZE;
+    DMA_InitStructure.DMA_PeripheralInc = DMA_PeripheralInc_Disable;
+    DMA_InitStructure.DMA_MemoryInc = DMA_MemoryInc_Enable;
+    DMA_InitStructure.DMA_PeripheralDataSize = DMA_PeripheralDataSize_Byte;
+    DMA_InitStructure.DMA_MemoryDataSize = DMA_MemoryDataSize_Byte;
+    DMA_InitStructure.DMA_Mode = DMA_Mode_Circular;
+    DMA_InitStructure.DMA_Priority = DMA_Priority_High;
+    DMA_InitStructure.DMA_M2M = DMA_M2M_Disable;
+    DMA_Init(UART_RX_DMA_CHANNEL, &DMA_InitStructure);
+
+    tail_ = 0;
+    USART_DMACmd(UART_PORT, USART_DMAReq_Rx, ENABLE);
+    DMA_Cmd(UART_RX_DMA_CHANNEL, ENABLE);
+}
+
+/*
+ * The channel counts down from UART_RX_BUFFER_SIZE and reloads itself,
+ * so the next byte lands at SIZE - CNDTR.
+ */
+size_t UartDmaRx::writePos() const
+{
+    return (UART_RX_BUFFER_SIZE - DMA_GetCurrDataCounter(UART_RX_DMA_CHANNEL)) & (UART_RX_BUFFER_SIZE - 1);
+}
+
+size_t UartDmaRx::available() const
+{
+    return (writePos() - tail_) & (UART_RX_BUFFER_SIZE - 1);
+}
+
+int UartDmaRx::read()
+{
+    if (writePos() == tail_)
+    {
+        return -1;
+    }
+    uint8_t c = buffer_[tail_];
+    tail_ = (tail_ + 1) & (UART_RX_BUFFER_SIZE - 1);
+    return c;
+}
+
+uint32_t UartDmaRx::overruns()
+{
+    if (USART_GetFlagStatus(UART_PORT, USART_FLAG_ORE) != RESET)
+    {
+        // cleared by the SR read above followed by the next DR read,
+        // which the DMA does for us
+        overruns_++;
+    }
+    return overruns_;
+}
+
+void UartDmaRx::printStats(Print &out)
+{
+    char buf[32];
+    sprintf(buf, "rx: overruns=%lu\n", (unsigned long)overruns());
+    out.print(buf);
+}
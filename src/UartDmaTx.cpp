@@ -0,0 +1,253 @@
+#include <Arduino.h>
+#include "UartDmaTx.h"
+#include "stm32f10x_gpio.h"
+#include "stm32f10x_rcc.h"
+#include "stm32f10x_usart.h"
+#include "stm32f10x_dma.h"
+#include "misc.h"
+
+static_assert((UART_TX_BUFFER_SIZE & (UART_TX_BUFFER_SIZE - 1)) == 0, "UART_TX_BUFFER_SIZE must be a power of two");
+
+UartDmaTx uartTx;
+
+UartDmaTx::UartDmaTx()
+    : head_(0), tail_(0), dmaLen_(0), busy_(false), message_(MESSAGE_NONE), messageDepth_(0),
+      bytesQueued_(0), bytesSent_(0), bytesDropped_(0), messagesDropped_(0), startMillis_(0)
+{
+}
+
+void UartDmaTx::begin(uint32_t baud)
+{
+    GPIO_InitTypeDef GPIO_InitStructure;
+    USART_InitTypeDef USART_InitStructure;
+    DMA_InitTypeDef DMA_InitStructure;
+    NVIC_InitTypeDef NVIC_InitStructure;
+
+    RCC_APB2PeriphClockCmd(UART_GPIO_CLK | RCC_APB2Periph_AFIO | UART_PORT_CLK, ENABLE);
+    RCC_AHBPeriphClockCmd(RCC_AHBPeriph_DMA1, ENABLE);
+
+    GPIO_InitStructure.GPIO_Pin = UART_TX_PIN;
+    GPIO_InitStructure.GPIO_Mode = GPIO_Mode_AF_PP;
+    GPIO_InitStructure.GPIO_Speed = GPIO_Speed_50MHz;
+    GPIO_Init(UART_GPIO_PORT, &GPIO_InitStructure);
+
+    GPIO_InitStructure.GPIO_Pin = UART_RX_PIN;
+    GPIO_InitStructure.GPIO_Mode = GPIO_Mode_IN_FLOATING;
+    GPIO_Init(UART_GPIO_PORT, &GPIO_InitStructure);
+
+    USART_InitStructure.USART_BaudRate = baud;
+    USART_InitStructure.USART_WordLength = USART_WordLength_8b;
+    USART_InitStructure.USART_StopBits = USART_StopBits_1;
+    USART_InitStructure.USART_Parity = USART_Parity_No;
+    USART_InitStructure.USART_HardwareFlowControl = USART_HardwareFlowControl_None;
+    USART_InitStructure.USART_Mode = USART_Mode_Tx | USART_Mode_Rx;
+    USART_Init(UART_PORT, &USART_InitStructure);
+
+    DMA_DeInit(UART_TX_DMA_CHANNEL);
+    DMA_InitStructure.DMA_PeripheralBaseAddr = (uint32_t)&UART_PORT->DR;
+    DMA_InitStructure.DMA_MemoryBaseAddr = (uint32_t)buffer_;
+    DMA_InitStructure.DMA_DIR = DMA_DIR_PeripheralDST;
+    DMA_InitStructure.DMA_BufferSize = 1; // set per transfer in kick()
+    DMA_InitStructure.DMA_PeripheralInc = DMA_PeripheralInc_Disable;
+    DMA_InitStructure.DMA_MemoryInc = DMA_MemoryInc_Enable;
+    DMA_InitStructure.DMA_PeripheralDataSize = DMA_PeripheralDataSize_Byte;
+    DMA_InitStructure.DMA_MemoryDataSize = DMA_MemoryDataSize_Byte;
+    DMA_InitStructure.DMA_Mode = DMA_Mode_Normal;
+    DMA_InitStructure.DMA_Priority = DMA_Priority_Medium;
+    DMA_InitStructure.DMA_M2M = DMA_M2M_Disable;
+    DMA_Init(UART_TX_DMA_CHANNEL, &DMA_InitStructure);
+    DMA_ITConfig(UART_TX_DMA_CHANNEL, DMA_IT_TC, ENABLE);
+
+    NVIC_InitStructure.NVIC_IRQChannel = UART_TX_DMA_IRQn;
+    NVIC_InitStructure.NVIC_IRQChannelPreemptionPriority = 2;
+    NVIC_InitStructure.NVIC_IRQChannelSubPriority = 0;
+    NVIC_InitStructure.NVIC_IRQChannelCmd = ENABLE;
+    NVIC_Init(&NVIC_InitStructure);
+
+    USART_DMACmd(UART_PORT, USART_DMAReq_Tx, ENABLE);
+    USART_Cmd(UART_PORT, ENABLE);
+
+    startMillis_ = millis();
+}
+
+size_t UartDmaTx::write(uint8_t c)
+{
+    return write(&c, 1);
+}
+
+/*
+ * All or nothing: either the whole message is queued or it is dropped.
+ * Only the caller moves head_ and only the interrupt moves tail_, so no
+ * interrupt masking is needed.
+ */
+size_t UartDmaTx::write(const uint8_t *buffer, size_t size)
+{
+    if (MESSAGE_DROP == message_)
+    {
+        return 0; // counted by beginMessage()
+    }
+
+    if (MESSAGE_BLOCK == message_)
+    {
+        size_t left = size;
+        while (left > 0)
+        {
+            size_t room = UART_TX_BUFFER_SIZE - (head_ - tail_);
+            if (room == 0)
+            {
+                continue; // drained by the DMA interrupt
+            }
+            size_t n = (left < room) ? left : room;
+            queue(buffer, n);
+            buffer += n;
+            left -= n;
+        }
+        return size;
+    }
+
+    if (size > UART_TX_BUFFER_SIZE - (head_ - tail_))
+    {
+        bytesDropped_ += size;
+        messagesDropped_++;
+        return 0;
+    }
+    queue(buffer, size);
+    return size;
+}
+
+bool UartDmaTx::beginMessage(size_t size)
+{
+    if (messageDepth_++ > 0)
+    {
+        return MESSAGE_DROP != message_; // part of the outer message, which reserved its room
+    }
+    if (size > UART_TX_BUFFER_SIZE)
+    {
+        message_ = MESSAGE_BLOCK;
+        return true;
+    }
+    if (size > UART_TX_BUFFER_SIZE - (head_ - tail_))
+    {
+        bytesDropped_ += size;
+        messagesDropped_++;
+        message_ = MESSAGE_DROP;
+        return false;
+    }
+    // the free space only grows until the message is written
+    message_ = MESSAGE_NONE;
+    return true;
+}
+
+void UartDmaTx::endMessage()
+{
+    if ((messageDepth_ > 0) && (--messageDepth_ > 0))
+    {
+        return;
+    }
+    message_ = MESSAGE_NONE;
+}
+
+/*
+ * Copy into the ring and start the DMA. head_ is published before busy_
+ * is read: if the interrupt finished just before that it has cleared
+ * busy_ and we restart the channel ourselves, otherwise it will see the
+ * new head_.
+ */
+void UartDmaTx::queue(const uint8_t *buffer, size_t size)
+{
+    uint32_t head = head_;
+    uint32_t pos = head & (UART_TX_BUFFER_SIZE - 1);
+    uint32_t first = UART_TX_BUFFER_SIZE - pos;
+    if (first > size)
+    {
+        first = size;
+    }
+    memcpy(buffer_ + pos, buffer, first);
+    memcpy(buffer_, buffer + first, size - first);
+
+    head_ = head + size;
+    bytesQueued_ += size;
+
+    if (!busy_)
+    {
+        kick();
+    }
+}
+
+/*
+ * Start a DMA transfer for the contiguous part of the ring starting at
+ * tail_. The channel is disabled whenever this runs.
+ */
+void UartDmaTx::kick()
+{
+    uint32_t tail = tail_;
+    uint32_t avail = head_ - tail;
+    if (avail == 0)
+    {
+        busy_ = false;
+        return;
+    }
+
+    uint32_t pos = tail & (UART_TX_BUFFER_SIZE - 1);
+    uint32_t chunk = UART_TX_BUFFER_SIZE - pos;
+    if (chunk > avail)
+    {
+        chunk = avail;
+    }
+
+    dmaLen_ = chunk;
+    busy_ = true;
+    UART_TX_DMA_CHANNEL->CMAR = (uint32_t)(buffer_ + pos);
+    DMA_SetCurrDataCounter(UART_TX_DMA_CHANNEL, chunk);
+    DMA_Cmd(UART_TX_DMA_CHANNEL, ENABLE);
+}
+
+void UartDmaTx::onTransferComplete()
+{
+    DMA_Cmd(UART_TX_DMA_CHANNEL, DISABLE);
+    tail_ = tail_ + dmaLen_;
+    bytesSent_ = bytesSent_ + dmaLen_;
+    kick();
+}
+
+size_t UartDmaTx::pending() const
+{
+    return head_ - tail_;
+}
+
+void UartDmaTx::flush()
+{
+    while (busy_)
+        ; // drained by the DMA interrupt
+    while (RESET == USART_GetFlagStatus(UART_PORT, USART_FLAG_TC))
+        ; // last byte left the shift register
+}
+
+uint32_t UartDmaTx::throughput() const
+{
+    uint32_t elapsed = millis() - startMillis_;
+    if (elapsed == 0)
+    {
+        return 0;
+    }
+    return (uint32_t)((uint64_t)bytesSent_ * 1000 / elapsed);
+}
+
+void UartDmaTx::printStats(Print &out) const
+{
+    char buf[96];
+    sprintf(buf, "tx: sent=%lu queued=%lu dropped=%lu bytes/%lu msgs %lu B/s\n",
+            (unsigned long)bytesSent_, (unsigned long)bytesQueued_,
+            (unsigned long)bytesDropped_, (unsigned long)messagesDropped_,
+            (unsigned long)throughput());
+    out.print(buf);
+}
+
+extern "C" void UART_TX_DMA_IRQHandler(void)
+{
+    if (DMA_GetITStatus(UART_TX_DMA_IT_TC) != RESET)
+    {
+        DMA_ClearITPendingBit(UART_TX_DMA_IT_TC);
+        uartTx.onTransferComplete();
+    }
+}
@@ -0,0 +1,29 @@
+#ifndef __CRC_A_H
+#define __CRC_A_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * ISO14443A CRC_A: polynomial x^16 + x^12 + x^5 + 1, reflected (0x8408),
+ * preset 0x6363, no final XOR. Computed byte-wise from a 512-byte table in
+ * flash, so no RC522 register traffic is needed.
+ *
+ * Example: HALT 50 00 -> CRC bytes 57 CD.
+ */
+#define CRC_A_PRESET 0x6363
+
+// continue a CRC over more data; start with crc = CRC_A_PRESET
+uint16_t CrcAUpdate(uint16_t crc, const uint8_t *data, uint16_t len);
+
+// CRC_A of data, stored LSB first in pOut[0..1] as sent on the air
+void CrcAAppend(const uint8_t *data, uint16_t len, uint8_t *pOut);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
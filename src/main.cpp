@@ -23,21 +23,37 @@
 
 #include <SPI.h>
 #include <MFRC522.h>
+#include "ReportProtocol.h"
+#include "UartDmaTx.h"
+#include "UartDmaRx.h"
+#include "CommandParser.h"
+#include "HexFormat.h"
+#include "PN5180Debug.h"
+#include "PN5180Profile.h"
+#include "PN5180Capture.h"
 #define STM32F10X_LD STM32F10X_LD
 #define RST_PIN A3 // Configurable, see typical pin layout above
 #define SS_PIN A4  // Configurable, see typical pin layout above
+// build with -DREPORT_BINARY (platformio.ini build_flags) to dump buffers as binary
+// report frames for tools/report_decode instead of hex text
 
 MFRC522 mfrc522(SS_PIN, RST_PIN); // Create MFRC522 instance
 
-String inputString = "";
+#ifdef PN5180_CAPTURE
+static_assert(PN5180_CAPTURE_FRAME_MAX <= UART_TX_BUFFER_SIZE,
+              "a REPORT_CAPTURE frame must fit into the UART TX ring");
+#endif
+
+CommandParser parser;
 //*****************************************************************************************//
 void setup()
 {
-  inputString.reserve(256);
-  Serial.begin(9600);                 // Initialize serial communications with the PC
+  uartTx.begin(9600);                 // Initialize serial communications with the PC, DMA-driven TX
+  pn5180LogOut = &uartTx;             // PN5180 log text shares the port with the report frames
+  uartRx.begin();                     // circular DMA RX, no interrupts, no heap
   SPI.begin();                        // Init SPI bus
   mfrc522.PCD_Init();                 // Init MFRC522 card
-  Serial.println(F("INIT SUCCESS:")); // shows in serial that it is ready to read
+  uartTx.println(F("INIT SUCCESS:")); // shows in serial that it is ready to read
 }
 uint32_t loopCnt = 0;
 bool errorFlag = false;
@@ -51,132 +67,179 @@ uint8_t recvlen;
 char buf[64];
 char print_buf[64];
 //*****************************************************************************************//
-void loop()
+#ifndef REPORT_BINARY
+/*
+ * "<count>", "<< <hex dump>" as one message: a reply larger than the TX
+ * ring waits for the UART instead of losing everything past the first
+ * ring full.
+ */
+void printReceived(uint8_t count, const uint8_t *data, size_t len)
 {
+  uartTx.beginMessage(5 + 3 + HEX_ENCODED_LEN(len, ' ') + 2);
+  uartTx.println(count);
+  uartTx.print("<< ");
+  hexDump(uartTx, data, len);
+  uartTx.println("");
+  uartTx.endMessage();
+}
+#endif
 
+/*
+ * Commands arrive as length-prefixed frames (see CommandParser.h):
+ * Length, Command, Parameters
+ */
+void handleCommand(const uint8_t *input, uint8_t inputLen)
+{
+  uartTx.println(input[0], 16);
+  uartTx.println(input[0] == 0xFE);
 
-  if (inputString.length() > 0)
+  if (input[0] == 0XFF)
   {
-    Serial.println(inputString[0], 16);
-    Serial.println(inputString[0] == 0xFE);
-
-    if (inputString[0] == 0XFF)
-    {
-      // Prepare key - all keys are set to FFFFFFFFFFFFh at chip delivery from the factory.
-      MFRC522::MIFARE_Key key;
-      for (byte i = 0; i < 6; i++)
-        key.keyByte[i] = 0xFF;
+    // Prepare key - all keys are set to FFFFFFFFFFFFh at chip delivery from the factory.
+    MFRC522::MIFARE_Key key;
+    for (byte i = 0; i < 6; i++)
+      key.keyByte[i] = 0xFF;
 
-      // some variables we need
-      byte block;
-      byte len;
-      MFRC522::StatusCode status;
+    // some variables we need
+    byte block;
+    byte len;
+    MFRC522::StatusCode status;
 
-      //-------------------------------------------
+    //-------------------------------------------
 
-      // Reset the loop if no new card present on the sensor/reader. This saves the entire process when idle.
-      if (!mfrc522.PICC_IsNewCardPresent())
-      {
-        return;
-      }
+    // Reset the loop if no new card present on the sensor/reader. This saves the entire process when idle.
+    if (!mfrc522.PICC_IsNewCardPresent())
+    {
+      return;
+    }
 
-      // Select one of the cards
-      if (!mfrc522.PICC_ReadCardSerial())
-      {
-        return;
-      }
+    // Select one of the cards
+    if (!mfrc522.PICC_ReadCardSerial())
+    {
+      return;
+    }
 
-      Serial.println(F("**Card Detected:**"));
+    uartTx.println(F("**Card Detected:**"));
 
-      //-------------------------------------------
+    //-------------------------------------------
 
-      mfrc522.PICC_DumpDetailsToSerial(&(mfrc522.uid)); // dump some details about the card
+    // dump some details about the card
+    // " XX XX XX XX SAK: XX", encoded into print_buf and written once
+    uartTx.print(F("Card UID:"));
+    char *p = print_buf;
+    *p++ = ' ';
+    p += hexEncode(p, mfrc522.uid.uidByte, mfrc522.uid.size, ' ');
+    memcpy(p, "SAK: ", 5);
+    hexEncode(p + 5, &mfrc522.uid.sak, 1);
+    uartTx.println(print_buf);
 
-      // mfrc522.PICC_DumpToSerial(&(mfrc522.uid));      //uncomment this to see all blocks in hex
+    // mfrc522.PICC_DumpToSerial(&(mfrc522.uid));      //uncomment this to see all blocks in hex
 
-      //-------------------------------------------
+    //-------------------------------------------
 
-      
-    }
-    else if (inputString[0] == 0XFE)
+    
+  }
+  else if (input[0] == 0XFD)
+  {
+    // UART statistics: throughput and dropped messages, receiver overruns
+    uartTx.printStats(uartTx);
+    uartRx.printStats(uartTx);
+  }
+#if PN5180_TRACE_USED
+  else if (input[0] == 0XFC)
+  {
+    // PN5180 trace records as REPORT_TRACE frames, oldest first
+    pn5180TraceDrain(uartTx);
+  }
+#endif
+#ifdef PN5180_PROFILE
+  else if (input[0] == 0XFB)
+  {
+    // PN5180 latency statistics as REPORT_PROFILE frames; a non-zero parameter clears them afterwards
+    pn5180ProfileReport(uartTx);
+    if ((inputLen > 1) && input[1])
     {
-      cmdlen = 0;
-      byte command = 0x40;
-
-      
-
-      Serial.println("0x40");
-
-      memset(recvbuf, 0, 512);
-      byte b8[1] = {8};
-      byte b7[1] = {7};
-      byte b255[1] = {255};
-      mfrc522.PCD_CommunicateWithPICC(command, 0x30, {}, cmdlen, recvbuf, b255, b7,0, true);
-      // recvlen = nfc.finitepiSendData(cmd, cmdlen, recvbuf);
-      Serial.println(recvlen);
-      Serial.print("<< ");
-      for (int i = 0; i < recvlen; i++)
-      {
-        sprintf(print_buf, "%02X ", recvbuf[i]);
-        Serial.print(print_buf);
-      }
-      Serial.println("");
+      pn5180ProfileReset();
     }
-    else
+  }
+#endif
+#ifdef PN5180_CAPTURE
+  else if (input[0] == 0XFA)
+  {
+    // recorded PN5180 SPI frames as REPORT_CAPTURE frames, for tools/pn5180_replay; empties the recorder
+    pn5180Capture.dump(uartTx);
+  }
+#endif
+  else if (input[0] == 0XFE)
+  {
+    cmdlen = 0;
+    byte command = 0x40;
+
+    
+
+    uartTx.println("0x40");
+
+    memset(recvbuf, 0, 512);
+    byte b8[1] = {8};
+    byte b7[1] = {7};
+    byte b255[1] = {255};
+    mfrc522.PCD_CommunicateWithPICC(command, 0x30, {}, cmdlen, recvbuf, b255, b7,0, true);
+    // recvlen = nfc.finitepiSendData(cmd, cmdlen, recvbuf);
+#ifdef REPORT_BINARY
+    reportRaw(uartTx, recvbuf, recvlen);
+#else
+    printReceived(recvlen, recvbuf, recvlen);
+#endif
+  }
+  else
+  {
+    uartTx.println(">> other command <<" );
+    cmdlen = inputLen;
+    byte command = input[0];
+    if (cmdlen > 1)
     {
-      Serial.println(">> other command <<" );
-      cmdlen = inputString.length();
-      byte command = inputString[0];
-      if (cmdlen > 1)
-      {
-        for (int i = 1; i < cmdlen; i++)
-        {
-          cmd[i] = inputString[i];
-        }
-      }
-      Serial.println(">> " + command);
-      Serial.print(">> ");
-      for (int i = 0; i < cmdlen; i++)
+      for (int i = 1; i < cmdlen; i++)
       {
-        sprintf(print_buf, "%02X ", cmd[i]);
-        Serial.print(print_buf);
+        cmd[i] = input[i];
       }
-      Serial.println("");
-
-      memset(recvbuf, 0, 512);
-      byte b8[1] = {8};
-      byte b7[1] = {7};
-      byte b255[1] = {255};
-      Serial.print("back length : " );
-      Serial.print(*b255 );
-
-      
-      mfrc522.PCD_CommunicateWithPICC(command, 0x00, cmd, cmdlen, recvbuf, b255, b8,0, true);
-      // recvlen = nfc.finitepiSendData(cmd, cmdlen, recvbuf);
-      Serial.println(recvlen);
-      Serial.print("<< ");
-      for (int i = 0; i < sizeof(recvbuf); i++)
-      {
-        sprintf(print_buf, "%02X ", recvbuf[i]);
-        Serial.print(print_buf);
-      }
-      Serial.println("");
     }
-    // clear the string:
-    inputString = "";
+#ifdef REPORT_BINARY
+    reportRaw(uartTx, cmd, cmdlen);
+#else
+    uartTx.println(">> " + command);
+    uartTx.print(">> ");
+    hexDump(uartTx, cmd, cmdlen);
+    uartTx.println("");
+#endif
+
+    memset(recvbuf, 0, 512);
+    byte b8[1] = {8};
+    byte b7[1] = {7};
+    byte b255[1] = {255};
+    uartTx.print("back length : " );
+    uartTx.print(*b255 );
+
+    
+    mfrc522.PCD_CommunicateWithPICC(command, 0x00, cmd, cmdlen, recvbuf, b255, b8,0, true);
+    // recvlen = nfc.finitepiSendData(cmd, cmdlen, recvbuf);
+#ifdef REPORT_BINARY
+    // larger than the TX ring, so this frame waits for the UART
+    reportRaw(uartTx, recvbuf, sizeof(recvbuf));
+#else
+    printReceived(recvlen, recvbuf, sizeof(recvbuf));
+#endif
   }
 }
 
-void serialEvent()
+void loop()
 {
-  while (Serial.available())
+  int c;
+  uartRx.overruns(); // count ORE between two 0xFD requests
+  while ((c = uartRx.read()) >= 0)
   {
-    // get the new byte:
-    char inChar = (char)Serial.read();
-    // add it to the inputString:
-    inputString += inChar;
-    // if the incoming character is a newline, set a flag
-    // so the main loop can do something about it:
-    delay(2);
+    if (parser.feed(c, millis()))
+    {
+      handleCommand(parser.data(), parser.length());
+    }
   }
 }
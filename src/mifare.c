@@ -0,0 +1,283 @@
+#include "stm32f10x.h"
+#include "mifare.h"
+#include "CycleCounter.h"
+
+#define MFC_KEY_B             0x80    // key index flag in the cache
+#define MFC_NO_SECTOR         0xFF
+
+typedef struct
+{
+    unsigned char snr[4];
+    unsigned char sector;
+    unsigned char key;                // index into mfcKeys, | MFC_KEY_B
+} MfcCacheEntry;
+
+static unsigned char mfcKeys[MFC_MAX_KEYS][6] = {
+    {0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF},
+    {0xA0, 0xA1, 0xA2, 0xA3, 0xA4, 0xA5},
+    {0xD3, 0xF7, 0xD3, 0xF7, 0xD3, 0xF7},
+    {0x00, 0x00, 0x00, 0x00, 0x00, 0x00},
+};
+static unsigned char mfcKeyCount = 4;
+
+static MfcCacheEntry mfcCache[MFC_KEY_CACHE_SIZE];
+static unsigned char mfcCacheUsed = 0;
+static unsigned char mfcCacheNext = 0;
+
+// sector the card is currently authenticated for
+static unsigned char mfcSnr[4];
+static unsigned char mfcSector = MFC_NO_SECTOR;
+
+static MfcStats mfcStats;
+
+static char SameSnr(const unsigned char *a, const unsigned char *b)
+{
+    return a[0] == b[0] && a[1] == b[1] && a[2] == b[2] && a[3] == b[3];
+}
+
+static MfcCacheEntry *CacheFind(const unsigned char *pSnr, unsigned char sector)
+{
+    unsigned char i;
+    for (i = 0; i < mfcCacheUsed; i++)
+    {
+        if (mfcCache[i].sector == sector && SameSnr(mfcCache[i].snr, pSnr))
+        {
+            return &mfcCache[i];
+        }
+    }
+    return 0;
+}
+
+static void CacheStore(const unsigned char *pSnr, unsigned char sector, unsigned char key)
+{
+    unsigned char i;
+    MfcCacheEntry *e = CacheFind(pSnr, sector);
+    if (e == 0)
+    {
+        // round robin once full
+        e = &mfcCache[mfcCacheNext];
+        mfcCacheNext = (mfcCacheNext + 1) % MFC_KEY_CACHE_SIZE;
+        if (mfcCacheUsed < MFC_KEY_CACHE_SIZE)
+        {
+            mfcCacheUsed++;
+        }
+    }
+    for (i = 0; i < 4; i++)
+    {
+        e->snr[i] = pSnr[i];
+    }
+    e->sector = sector;
+    e->key = key;
+}
+
+// a failed authentication drops the card out of ACTIVE: wake and select it again
+static char Reactivate(unsigned char *pSnr)
+{
+    unsigned char TagType[2];
+    if (PcdRequest(PICC_REQALL, TagType) != MI_OK)
+    {
+        return MI_ERR;
+    }
+    return PcdSelect(pSnr);
+}
+
+static char TryKey(unsigned char *pSnr, unsigned char block, unsigned char key)
+{
+    mfcStats.auths++;
+    return PcdAuthState((key & MFC_KEY_B) ? PICC_AUTHENT1B : PICC_AUTHENT1A, block,
+                        mfcKeys[key & ~MFC_KEY_B], pSnr);
+}
+
+void MfcSetKeys(const unsigned char keys[][6], unsigned char count)
+{
+    unsigned char i, j;
+    if (count > MFC_MAX_KEYS)
+    {
+        count = MFC_MAX_KEYS;
+    }
+    for (i = 0; i < count; i++)
+    {
+        for (j = 0; j < 6; j++)
+        {
+            mfcKeys[i][j] = keys[i][j];
+        }
+    }
+    mfcKeyCount = count;
+    MfcClearKeyCache();
+}
+
+void MfcClearKeyCache(void)
+{
+    mfcCacheUsed = 0;
+    mfcCacheNext = 0;
+    MfcEndSession();
+}
+
+unsigned char MfcSectorFirstBlock(unsigned char sector)
+{
+    return (sector < 32) ? sector * 4 : 128 + (sector - 32) * 16;
+}
+
+unsigned char MfcSectorBlockCount(unsigned char sector)
+{
+    return (sector < 32) ? 4 : 16;
+}
+
+void MfcEndSession(void)
+{
+    mfcSector = MFC_NO_SECTOR;
+}
+
+/*
+ * The cached key is tried first; otherwise key A then key B of every
+ * candidate, reselecting the card after each failure. Authenticating a
+ * new sector while another one is open is a nested authentication and
+ * needs no reselect.
+ */
+char MfcAuthSector(unsigned char *pSnr, unsigned char sector)
+{
+    unsigned char i, key, cached = MFC_NO_SECTOR;
+    unsigned char block;
+    MfcCacheEntry *e;
+
+    if (mfcSector == sector && SameSnr(mfcSnr, pSnr))
+    {
+        return MI_OK;
+    }
+
+    block = MfcSectorFirstBlock(sector) + MfcSectorBlockCount(sector) - 1;
+    e = CacheFind(pSnr, sector);
+    if (e != 0)
+    {
+        cached = e->key;
+        if (TryKey(pSnr, block, cached) == MI_OK)
+        {
+            mfcStats.cacheHits++;
+            goto opened;
+        }
+        if (Reactivate(pSnr) != MI_OK)
+        {
+            MfcEndSession();
+            return MI_ERR;
+        }
+    }
+
+    for (i = 0; i < 2 * mfcKeyCount; i++)
+    {
+        key = (i < mfcKeyCount) ? i : (unsigned char)((i - mfcKeyCount) | MFC_KEY_B);
+        if (key == cached)
+        {
+            continue;
+        }
+        if (TryKey(pSnr, block, key) == MI_OK)
+        {
+            CacheStore(pSnr, sector, key);
+            goto opened;
+        }
+        if (Reactivate(pSnr) != MI_OK)
+        {
+            break;
+        }
+    }
+    MfcEndSession();
+    return MI_ERR;
+
+opened:
+    for (i = 0; i < 4; i++)
+    {
+        mfcSnr[i] = pSnr[i];
+    }
+    mfcSector = sector;
+    return MI_OK;
+}
+
+char MfcReadSector(unsigned char *pSnr, unsigned char sector, unsigned char *pData)
+{
+    unsigned char i, first, count;
+
+    if (MfcAuthSector(pSnr, sector) != MI_OK)
+    {
+        return MI_ERR;
+    }
+    first = MfcSectorFirstBlock(sector);
+    count = MfcSectorBlockCount(sector);
+    for (i = 0; i < count; i++)
+    {
+        if (PcdRead(first + i, pData + i * MFC_BLOCK_SIZE) != MI_OK)
+        {
+            // a refused block (access bits) drops the card out of ACTIVE
+            MfcEndSession();
+            Reactivate(pSnr);
+            return MI_ERR;
+        }
+    }
+    return MI_OK;
+}
+
+char MfcWriteBlock(unsigned char *pSnr, unsigned char block, unsigned char *pData)
+{
+    unsigned char sector = (block < 128) ? block / 4 : 32 + (block - 128) / 16;
+
+    if (MfcAuthSector(pSnr, sector) != MI_OK)
+    {
+        return MI_ERR;
+    }
+    if (PcdWrite(block, pData) != MI_OK)
+    {
+        MfcEndSession();
+        Reactivate(pSnr);
+        return MI_ERR;
+    }
+    return MI_OK;
+}
+
+unsigned char MfcDumpCard(unsigned char *pSnr, unsigned char sectorCount, unsigned char *pData)
+{
+    unsigned char sector, ok = 0;
+    uint32_t start;
+
+    CycleCounterStart();
+    start = DWT_CYCCNT;
+
+    for (sector = 0; sector < sectorCount; sector++)
+    {
+        if (MfcReadSector(pSnr, sector, pData) == MI_OK)
+        {
+            ok++;
+        }
+        else
+        {
+            mfcStats.sectorErrors++;
+        }
+        pData += MfcSectorBlockCount(sector) * MFC_BLOCK_SIZE;
+    }
+
+    mfcStats.cycles += (uint32_t)(DWT_CYCCNT - start);
+    mfcStats.sectors += ok;
+    mfcStats.cards++;
+    return ok;
+}
+
+const MfcStats *MfcGetStats(void)
+{
+    return &mfcStats;
+}
+
+void MfcResetStats(void)
+{
+    mfcStats.cards = 0;
+    mfcStats.sectors = 0;
+    mfcStats.sectorErrors = 0;
+    mfcStats.auths = 0;
+    mfcStats.cacheHits = 0;
+    mfcStats.cycles = 0;
+}
+
+unsigned long MfcCardsPerSecondX100(void)
+{
+    if (mfcStats.cycles == 0)
+    {
+        return 0;
+    }
+    return (unsigned long)((unsigned long long)mfcStats.cards * 100 * SystemCoreClock / mfcStats.cycles);
+}
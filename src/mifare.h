@@ -0,0 +1,56 @@
+#ifndef __MIFARE_H
+#define __MIFARE_H
+
+#include "rc522.h"
+
+/*
+ * MIFARE Classic sector sessions on top of the rc522 driver.
+ *
+ * A sector is authenticated once and then all of its blocks are read or
+ * written back to back. Which key opened which sector of which card is
+ * remembered in a small cache, so a second dump of the same card
+ * authenticates every sector with one PcdAuthState and no key search.
+ *
+ * Card UIDs are the 4-byte serial numbers of PcdAnticoll/PcdSelect.
+ */
+
+#define MFC_MAX_KEYS          8       // candidate keys tried per sector
+#define MFC_KEY_CACHE_SIZE    64      // card/sector pairs remembered
+#define MFC_BLOCK_SIZE        16
+#define MFC_MAX_SECTOR_BLOCKS 16      // sectors 32-39 of a 4K card
+
+typedef struct
+{
+    unsigned long cards;              // completed MfcDumpCard calls
+    unsigned long sectors;            // sectors read by MfcDumpCard
+    unsigned long sectorErrors;       // sectors no key could open or read
+    unsigned long auths;              // PcdAuthState calls
+    unsigned long cacheHits;          // sectors opened with the cached key
+    unsigned long long cycles;        // DWT cycles spent in MfcDumpCard
+} MfcStats;
+
+// replace the key list (default: FFFFFFFFFFFF, A0A1A2A3A4A5, D3F7D3F7D3F7, 000000000000)
+void MfcSetKeys(const unsigned char keys[][6], unsigned char count);
+void MfcClearKeyCache(void);
+
+unsigned char MfcSectorFirstBlock(unsigned char sector);
+unsigned char MfcSectorBlockCount(unsigned char sector);
+
+// authenticate a sector, unless it is already the open one
+char MfcAuthSector(unsigned char *pSnr, unsigned char sector);
+// forget the open sector (after HALT, reselect or field reset)
+void MfcEndSession(void);
+
+// all blocks of a sector, including the trailer: MfcSectorBlockCount * 16 bytes
+char MfcReadSector(unsigned char *pSnr, unsigned char sector, unsigned char *pData);
+char MfcWriteBlock(unsigned char *pSnr, unsigned char block, unsigned char *pData);
+
+// read sectors 0..sectorCount-1 into pData; returns sectors read
+unsigned char MfcDumpCard(unsigned char *pSnr, unsigned char sectorCount, unsigned char *pData);
+
+const MfcStats *MfcGetStats(void);
+void MfcResetStats(void);
+// dump throughput in cards per second * 100, from the DWT cycle counter
+unsigned long MfcCardsPerSecondX100(void);
+
+#endif
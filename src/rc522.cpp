@@ -0,0 +1,260 @@
+#include "rc522.h"
+#include "Rc522Driver.h"
+
+constexpr Rc522Shadow::Desc Rc522Shadow::desc[];
+
+/*
+ * 默认读卡器，引脚见rc522.h。C接口(PcdXxx)都转发给它；
+ * 其他读卡器直接使用Rc522<>模板。
+ */
+#ifndef RC522_USE_BITBANG
+typedef HwSpi<MF522_SPI_BASE, MF522_SPI_PRESCALER,
+              GpioPin<MF522_SCK_PORT, MF522_SCK_PIN>,
+              GpioPin<MF522_MISO_PORT, MF522_MISO_PIN>,
+              GpioPin<MF522_MOSI_PORT, MF522_MOSI_PIN>,
+              GpioPin<MF522_NSS_PORT, MF522_NSS_PIN> > Mf522Bus;
+#else
+typedef BitBangSpi<GpioPin<MF522_SCK_PORT, MF522_SCK_PIN>,
+                   GpioPin<MF522_MISO_PORT, MF522_MISO_PIN>,
+                   GpioPin<MF522_MOSI_PORT, MF522_MOSI_PIN>,
+                   GpioPin<MF522_NSS_PORT, MF522_NSS_PIN> > Mf522Bus;
+#endif
+
+#ifndef RC522_NO_IRQ
+typedef GpioPin<MF522_IRQ_PORT, MF522_IRQ_PIN> Mf522Irq;
+#else
+typedef NoPin Mf522Irq;
+#endif
+
+static Rc522<Mf522Bus, GpioPin<MF522_RST_PORT, MF522_RST_PIN>, Mf522Irq> rc522;
+
+#ifndef RC522_NO_IRQ
+extern "C" void MF522_IRQHandler(void)
+{
+    rc522.onIrq();
+}
+#endif
+
+void PcdInit(void)
+{
+    rc522.init();
+}
+
+//功    能：复位RC522
+//返    回: 成功返回MI_OK
+char PcdReset(void)
+{
+    return rc522.reset();
+}
+
+//功    能：设置收发超时(RC522内部定时器)
+//参数说明：ms[IN]:毫秒，定时器0.5ms一个tick
+void PcdSetTimeout(unsigned int ms)
+{
+    rc522.setTimeout(ms);
+}
+
+//设置RC632的工作方式
+char M500PcdConfigISOType(unsigned char type)
+{
+    return rc522.configISOType(type);
+}
+
+//开启天线
+//每次启动或关闭天险发射之间应至少有1ms的间隔
+void PcdAntennaOn(void)
+{
+    rc522.antennaOn();
+}
+
+//关闭天线
+void PcdAntennaOff(void)
+{
+    rc522.antennaOff();
+}
+
+//功    能：寻卡
+//参数说明: req_code[IN]:寻卡方式
+//                0x52 = 寻感应区内所有符合14443A标准的卡
+//                0x26 = 寻未进入休眠状态的卡
+//          	  pTagType[OUT]：卡片类型代码
+//                0x4400 = Mifare_UltraLight
+//                0x0400 = Mifare_One(S50)
+//                0x0200 = Mifare_One(S70)
+//                0x0800 = Mifare_Pro(X)
+//                0x4403 = Mifare_DESFire
+//返    回: 成功返回MI_OK
+char PcdRequest(unsigned char req_code,unsigned char *pTagType)
+{
+    return rc522.request(req_code, pTagType);
+}
+
+//功    能：防冲撞
+//参数说明: pSnr[OUT]:卡片序列号，4字节
+//返    回: 成功返回MI_OK
+char PcdAnticoll(unsigned char *pSnr)
+{
+    return rc522.anticoll(pSnr);
+}
+
+//功    能：选定卡片
+//参数说明: pSnr[IN]:卡片序列号，4字节
+//返    回: 成功返回MI_OK
+char PcdSelect(unsigned char *pSnr)
+{
+    return rc522.select(pSnr);
+}
+
+//功    能：完整防冲撞并选卡，支持级联1-3级(4/7/10字节UID)
+//参数说明: pUid[OUT]:UID及最后一级的SAK
+//返    回: 成功返回MI_OK
+char PcdSelectUid(PiccUid *pUid)
+{
+    return rc522.selectUid(pUid);
+}
+
+//功    能：枚举场内所有卡片，每选中一张就令其休眠
+//参数说明: req_code[IN]:第一次寻卡方式，PICC_REQALL同时唤醒已休眠的卡
+//          pUids[OUT]:UID列表
+//          maxCount[IN]:列表容量
+//返    回: 找到的卡片数
+unsigned char PcdEnumerate(unsigned char req_code, PiccUid *pUids, unsigned char maxCount)
+{
+    return rc522.enumerate(req_code, pUids, maxCount);
+}
+
+//功    能：验证卡片密码
+//参数说明: auth_mode[IN]: 密码验证模式
+//                 0x60 = 验证A密钥
+//                 0x61 = 验证B密钥
+//          addr[IN]：块地址
+//          pKey[IN]：密码
+//          pSnr[IN]：卡片序列号，4字节
+//返    回: 成功返回MI_OK
+char PcdAuthState(unsigned char auth_mode,unsigned char addr,unsigned char *pKey,unsigned char *pSnr)
+{
+    return rc522.authState(auth_mode, addr, pKey, pSnr);
+}
+
+//功    能：读取M1卡一块数据
+//参数说明: addr[IN]：块地址
+//          pData[OUT]：读出的数据，16字节
+//返    回: 成功返回MI_OK
+char PcdRead(unsigned char addr,unsigned char *pData)
+{
+    return rc522.read(addr, pData);
+}
+
+//功    能：写数据到M1卡一块
+//参数说明: addr[IN]：块地址
+//          pData[IN]：写入的数据，16字节
+//返    回: 成功返回MI_OK
+char PcdWrite(unsigned char addr,unsigned char *pData)
+{
+    return rc522.write(addr, pData);
+}
+
+//功    能：命令卡片进入休眠状态
+//返    回: 成功返回MI_OK
+char PcdHalt(void)
+{
+    return rc522.halt();
+}
+
+//等待卡离开
+void WaitCardOff(void)
+{
+    rc522.waitCardOff();
+}
+
+//功    能：通过RC522和ISO14443卡通讯
+//参数说明：Command[IN]:RC522命令字
+//          pInData[IN]:通过RC522发送到卡片的数据
+//          InLenByte[IN]:发送数据的字节长度
+//          pOutData[OUT]:接收到的卡片返回数据
+//          *pOutLenBit[OUT]:返回数据的位长度
+char PcdComMF522(unsigned char Command,
+                 unsigned char *pInData,
+                 unsigned char InLenByte,
+                 unsigned char *pOutData,
+                 unsigned int  *pOutLenBit)
+{
+    return rc522.transceive(Command, pInData, InLenByte, pOutData, pOutLenBit);
+}
+
+//计算CRC_A(ISO14443A)，查表软件实现，不访问RC522寄存器
+void CalulateCRC(unsigned char *pIndata,unsigned char len,unsigned char *pOutData)
+{
+    CrcAAppend(pIndata, len, pOutData);
+}
+
+//功    能：读RC632寄存器
+//参数说明：Address[IN]:寄存器地址
+//返    回：读出的值
+unsigned char ReadRawRC(unsigned char Address)
+{
+    return rc522.readReg(Address);
+}
+
+//功    能：写RC632寄存器
+//参数说明：Address[IN]:寄存器地址
+//          value[IN]:写入的值
+void WriteRawRC(unsigned char Address, unsigned char value)
+{
+    rc522.writeReg(Address, value);
+}
+
+//功    能：连续写同一寄存器(FIFO)，地址只发送一次，全程一次片选
+void WriteRawRCBurst(unsigned char Address, const unsigned char *pData, unsigned char len)
+{
+    rc522.writeRegBurst(Address, pData, len);
+}
+
+//功    能：连续读同一寄存器(FIFO)，全程一次片选
+void ReadRawRCBurst(unsigned char Address, unsigned char *pData, unsigned char len)
+{
+    rc522.readRegBurst(Address, pData, len);
+}
+
+//功    能：置RC522寄存器位
+//参数说明：reg[IN]:寄存器地址
+//          mask[IN]:置位值
+void SetBitMask(unsigned char reg,unsigned char mask)
+{
+    rc522.setBitMask(reg, mask);
+}
+
+//功    能：清RC522寄存器位
+//参数说明：reg[IN]:寄存器地址
+//          mask[IN]:清位值
+void ClearBitMask(unsigned char reg,unsigned char mask)
+{
+    rc522.clearBitMask(reg, mask);
+}
+
+//功    能：总线事务统计
+unsigned long PcdBusTransactions(void)
+{
+    return rc522.busTransactions();
+}
+
+unsigned long PcdBusSaved(void)
+{
+    return rc522.busSaved();
+}
+
+void PcdBusStatsReset(void)
+{
+    rc522.busStatsReset();
+}
+
+// Delay 10ms
+void delay_10ms(unsigned int _10ms)
+{
+	unsigned int i, j;
+
+	for(i=0; i<_10ms; i++)
+	{
+		for(j=0; j<60000; j++);
+	}
+}
@@ -1,37 +1,93 @@
 #ifndef __RC522_H
 #define __RC522_H
  
-#define MF522_RST_PIN                    GPIO_Pin_11
-#define MF522_RST_PORT                   GPIOB
-#define MF522_RST_CLK                    RCC_APB2Periph_GPIOB
- 
-#define MF522_MISO_PIN                   GPIO_Pin_10
-#define MF522_MISO_PORT                  GPIOB
-#define MF522_MISO_CLK                   RCC_APB2Periph_GPIOB
- 
-#define MF522_MOSI_PIN                   GPIO_Pin_1
-#define MF522_MOSI_PORT                  GPIOB
-#define MF522_MOSI_CLK                   RCC_APB2Periph_GPIOB
- 
-#define MF522_SCK_PIN                    GPIO_Pin_0
-#define MF522_SCK_PORT                   GPIOB
-#define MF522_SCK_CLK                    RCC_APB2Periph_GPIOB
- 
-#define MF522_NSS_PIN                    GPIO_Pin_7
-#define MF522_NSS_PORT                   GPIOA
-#define MF522_NSS_CLK                    RCC_APB2Periph_GPIOA
- 
-#define RST_H                            GPIO_SetBits(MF522_RST_PORT, MF522_RST_PIN)
-#define RST_L                            GPIO_ResetBits(MF522_RST_PORT, MF522_RST_PIN)
-#define MOSI_H                           GPIO_SetBits(MF522_MOSI_PORT, MF522_MOSI_PIN)
-#define MOSI_L                           GPIO_ResetBits(MF522_MOSI_PORT, MF522_MOSI_PIN)
-#define SCK_H                            GPIO_SetBits(MF522_SCK_PORT, MF522_SCK_PIN)
-#define SCK_L                            GPIO_ResetBits(MF522_SCK_PORT, MF522_SCK_PIN)
-#define NSS_H                            GPIO_SetBits(MF522_NSS_PORT, MF522_NSS_PIN)
-#define NSS_L                            GPIO_ResetBits(MF522_NSS_PORT, MF522_NSS_PIN)
-#define READ_MISO                        GPIO_ReadInputDataBit(MF522_MISO_PORT, MF522_MISO_PIN)
- 
-// 函数原型
+/*
+ * Wiring of the default reader behind the C API below. Ports are base
+ * addresses and pins are numbers: they are template arguments of the
+ * Rc522 driver (Rc522Driver.h), which turns every pin access into one
+ * BSRR/BRR store.
+ */
+#define MF522_RST_PORT                   GPIOB_BASE
+#define MF522_RST_PIN                    11
+ 
+/*
+ * RC522 IRQ output on PA8 / EXTI line 8. The chip is set to drive it
+ * push-pull, active low, and the falling edge ends PcdComMF522's wait.
+ * The default reader needs this line wired: without it every transceive
+ * runs into the backstop below and fails, there is no fallback at run
+ * time. Define RC522_NO_IRQ on boards without it to poll ComIrqReg over
+ * SPI instead.
+ */
+#define MF522_IRQ_PORT                   GPIOA_BASE
+#define MF522_IRQ_PIN                    8
+#define MF522_IRQHandler                 EXTI9_5_IRQHandler
+ 
+/*
+ * The RC522 timer is the transceive deadline: with TPrescaler 0xD3E it
+ * ticks every 0.5 ms and starts at the end of each transmission. The
+ * backstops only end a wait on a dead chip, so they count what one wait
+ * step costs: MF522_IRQ_BACKSTOP spins on the flag set by the EXTI
+ * handler (roughly 0.1 s at 72 MHz), MF522_POLL_BACKSTOP (per transport,
+ * below) ComIrqReg reads when there is no IRQ line, one SPI register
+ * access each.
+ */
+#define MF522_TIMEOUT_MS                 15
+#define MF522_IRQ_BACKSTOP               2000000UL
+ 
+/*
+ * SPI transport.
+ *
+ * By default the RC522 hangs off the SPI2 peripheral: PB13 SCK, PB14 MISO,
+ * PB15 MOSI, NSS on PB12 driven as a GPIO. APB1 runs at 36 MHz, prescaler 4
+ * gives 9 MHz, just below the 10 Mbit/s the MFRC522 accepts. One register
+ * access is two bytes on the wire, about 2 us instead of ~200 us bit-banged.
+ *
+ * Define RC522_USE_BITBANG to fall back to the original software SPI on
+ * PB0 SCK, PB10 MISO, PB1 MOSI, PA7 NSS (e.g. on boards where SPI2 is taken).
+ */
+#ifndef RC522_USE_BITBANG
+ 
+#define MF522_SPI_BASE                   SPI2_BASE
+#define MF522_SPI_PRESCALER              SPI_BaudRatePrescaler_4
+#define MF522_POLL_BACKSTOP              25000UL     // ~2 us per read: about 50 ms
+ 
+#define MF522_MISO_PORT                  GPIOB_BASE
+#define MF522_MISO_PIN                   14
+#define MF522_MOSI_PORT                  GPIOB_BASE
+#define MF522_MOSI_PIN                   15
+#define MF522_SCK_PORT                   GPIOB_BASE
+#define MF522_SCK_PIN                    13
+#define MF522_NSS_PORT                   GPIOB_BASE
+#define MF522_NSS_PIN                    12
+ 
+#else
+ 
+#define MF522_MISO_PORT                  GPIOB_BASE
+#define MF522_MISO_PIN                   10
+#define MF522_MOSI_PORT                  GPIOB_BASE
+#define MF522_MOSI_PIN                   1
+#define MF522_SCK_PORT                   GPIOB_BASE
+#define MF522_SCK_PIN                    0
+#define MF522_NSS_PORT                   GPIOA_BASE
+#define MF522_NSS_PIN                    7
+#define MF522_POLL_BACKSTOP              250UL       // ~200 us per read: about 50 ms
+ 
+#endif
+ 
+// 卡片UID，级联1-3级：4、7或10字节
+#define PICC_UID_MAX          10
+typedef struct
+{
+    unsigned char size;                      // 4, 7 or 10
+    unsigned char uidByte[PICC_UID_MAX];
+    unsigned char sak;                       // SAK of the last cascade level
+} PiccUid;
+ 
+#ifdef __cplusplus
+extern "C" {
+#endif
+ 
+// 函数原型，作用于默认读卡器
 void PcdInit(void);
 char PcdReset(void);
 void PcdAntennaOn(void);
@@ -39,6 +95,8 @@ void PcdAntennaOff(void);
 char PcdRequest(unsigned char req_code,unsigned char *pTagType);
 char PcdAnticoll(unsigned char *pSnr);
 char PcdSelect(unsigned char *pSnr);
+char PcdSelectUid(PiccUid *pUid);
+unsigned char PcdEnumerate(unsigned char req_code, PiccUid *pUids, unsigned char maxCount);
 char PcdAuthState(unsigned char auth_mode,unsigned char addr,unsigned char *pKey,unsigned char *pSnr);
 char PcdRead(unsigned char addr,unsigned char *pData);
 char PcdWrite(unsigned char addr,unsigned char *pData);
@@ -53,12 +111,22 @@ char PcdComMF522(unsigned char Command,
 void CalulateCRC(unsigned char *pIndata,unsigned char len,unsigned char *pOutData);
 void WriteRawRC(unsigned char Address,unsigned char value);
 unsigned char ReadRawRC(unsigned char Address);
+void WriteRawRCBurst(unsigned char Address,const unsigned char *pData,unsigned char len);
+void ReadRawRCBurst(unsigned char Address,unsigned char *pData,unsigned char len);
 void SetBitMask(unsigned char reg,unsigned char mask);
 void ClearBitMask(unsigned char reg,unsigned char mask);
+unsigned long PcdBusTransactions(void);
+unsigned long PcdBusSaved(void);
+void PcdBusStatsReset(void);
 char M500PcdConfigISOType(unsigned char type);
+void PcdSetTimeout(unsigned int ms);
 void delay_10ms(unsigned int _10ms);
 void WaitCardOff(void);
  
+#ifdef __cplusplus
+}
+#endif
+ 
 // MF522命令字
 #define PCD_IDLE              0x00               //取消当前命令
 #define PCD_AUTHENT           0x0E               //验证密钥
@@ -74,6 +142,8 @@ void WaitCardOff(void);
 #define PICC_REQALL           0x52               //寻天线区内全部卡
 #define PICC_ANTICOLL1        0x93               //防冲撞
 #define PICC_ANTICOLL2        0x95               //防冲撞
+#define PICC_ANTICOLL3        0x97               //防冲撞
+#define PICC_CASCADE_TAG      0x88               //级联标志CT
 #define PICC_AUTHENT1A        0x60               //验证A密钥
 #define PICC_AUTHENT1B        0x61               //验证B密钥
 #define PICC_READ             0x30               //读块
@@ -165,5 +235,6 @@ void WaitCardOff(void);
 #define MI_OK                          (char)0
 #define MI_NOTAGERR                    (char)(-1)
 #define MI_ERR                         (char)(-2)
+#define MI_COLLERR                     (char)(-3)    //位冲突，已收到冲突前的数据
  
-#endif
\ No newline at end of file
+#endif
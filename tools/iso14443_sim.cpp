@@ -0,0 +1,480 @@
+// NAME: iso14443_sim.cpp
+//
+// DESC: Host check for ISO14443A anticollision (PN5180ISO14443): runs the
+//       real driver on the PN5180 model of tools/mock/PN5180Chip.h in front
+//       of a simulated field of several cards. The field answers bit by bit
+//       as cards do, so UIDs that agree up to some bit collide there, and
+//       the model reports the collision the way the PN5180 does: RX_COLL_POS
+//       counts from bit 0 of the first received byte, RX_BIT_ALIGN bits
+//       included.
+//
+//       Fixed fields cover 4, 7 and 10-byte UIDs, cards sharing their whole
+//       CL1 (or CL1 and CL2), collisions inside a partial byte and in the
+//       last UID byte, and halted cards; random fields mix all of these.
+//
+// Build: g++ -std=gnu++11 -O2 -DARDUINO -Itools/mock -Iinclude -Isrc tools/iso14443_sim.cpp
+//            src/PN5180.cpp src/PN5180ISO14443.cpp src/PN5180Debug.cpp src/HexFormat.cpp
+//            src/ReportProtocol.cpp -o iso14443_sim
+// Usage: iso14443_sim [-v] [fields]
+//        -v prints every frame on air; fields is the number of random
+//        fields (default 2000). Exit status 0 when every field was fully
+//        enumerated.
+//
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+#include "PN5180Chip.h"
+#include "PN5180ISO14443.h"
+#include "UartDmaTxStub.h"
+
+enum CardState
+{
+    CARD_IDLE,
+    CARD_READY,
+    CARD_ACTIVE,
+    CARD_HALT
+};
+
+struct Card
+{
+    uint8_t uid[ISO14443_UID_MAX];
+    uint8_t size;
+    uint8_t sak; // SAK of the last level
+    CardState state;
+    uint8_t level;
+
+    uint8_t levels() const { return (4 == size) ? 1 : (7 == size) ? 2 : 3; }
+
+    // CT and three UID bytes, or the last four, then BCC
+    void levelBits(uint8_t level, uint8_t out[5]) const
+    {
+        if (level + 1 < levels())
+        {
+            out[0] = ISO14443_CASCADE_TAG;
+            memcpy(out + 1, uid + 3 * level, 3);
+        }
+        else
+        {
+            memcpy(out, uid + 3 * level, 4);
+        }
+        out[4] = out[0] ^ out[1] ^ out[2] ^ out[3];
+    }
+};
+
+static int bitAt(const uint8_t *b, int i)
+{
+    return (b[i / 8] >> (i % 8)) & 1;
+}
+
+/*
+ * ISO14443-3 type A PICCs: REQA, WUPA, ANTICOLLISION, SELECT and HLTA.
+ * Anticollision answers start right behind the bits the reader sent, so
+ * with RX_BIT_ALIGN n the first received bit lands in bit n of byte 0.
+ * Where the cards disagree the bit is a collision: RX_COLL_POS is the
+ * position of the first one in the reception buffer, RX_BIT_ALIGN bits
+ * included, and later bits read as the OR of all cards.
+ */
+class CardField : public PN5180Field
+{
+public:
+    CardField() : verbose(false) {}
+
+    std::vector<Card> cards;
+    bool verbose;
+
+    void rfOff() override
+    {
+        for (size_t i = 0; i < cards.size(); i++)
+        {
+            cards[i].state = CARD_IDLE;
+        }
+    }
+
+    void transmit(PN5180Chip &chip, const uint8_t *d, uint16_t len, uint8_t validBits) override
+    {
+        if (verbose)
+        {
+            printf("  >>");
+            for (uint16_t i = 0; i < len; i++)
+            {
+                printf(" %02X", d[i]);
+            }
+            printf(" /%u%s align %u\n", validBits, chip.txCrc() ? " CRC" : "", chip.rxAlign());
+        }
+
+        bool crc = chip.txCrc();
+        if ((1 == len) && (7 == validBits) && !crc && ((ISO14443_REQA == d[0]) || (ISO14443_WUPA == d[0])))
+        {
+            request(chip, ISO14443_WUPA == d[0]);
+        }
+        else if ((2 == len) && crc && (ISO14443_HLTA == d[0]) && (0 == d[1]))
+        {
+            for (size_t i = 0; i < cards.size(); i++)
+            {
+                if (CARD_ACTIVE == cards[i].state)
+                {
+                    cards[i].state = CARD_HALT;
+                }
+            }
+        }
+        else if ((len >= 2) && ((ISO14443_SEL_CL1 == d[0]) || (ISO14443_SEL_CL2 == d[0]) ||
+                                (ISO14443_SEL_CL3 == d[0])))
+        {
+            uint8_t level = (d[0] - ISO14443_SEL_CL1) / 2;
+            if ((7 == len) && (0x70 == d[1]) && crc)
+            {
+                select(chip, level, d + 2);
+            }
+            else if (!crc)
+            {
+                anticollision(chip, level, d, len, validBits);
+            }
+        }
+    }
+
+private:
+    void answer(PN5180Chip &chip, const uint8_t *b, uint16_t len, uint8_t lastBits, uint32_t errors)
+    {
+        if (verbose)
+        {
+            printf("  <<");
+            for (uint16_t i = 0; i < len; i++)
+            {
+                printf(" %02X", b[i]);
+            }
+            printf(" /%u%s\n", lastBits, (errors & RX_COLLISION_DETECTED) ? " collision" : "");
+        }
+        chip.receive(b, len, lastBits, errors);
+    }
+
+    void request(PN5180Chip &chip, bool wakeup)
+    {
+        bool any = false;
+        for (size_t i = 0; i < cards.size(); i++)
+        {
+            Card &c = cards[i];
+            if ((CARD_IDLE == c.state) || (wakeup && (CARD_HALT == c.state)))
+            {
+                c.state = CARD_READY;
+                c.level = 0;
+                any = true;
+            }
+            else if (CARD_HALT != c.state)
+            {
+                c.state = CARD_IDLE;
+            }
+        }
+        if (any)
+        {
+            // ATQA of every UID size, so several cards collide in it
+            uint8_t atqa[2] = {0x04, 0x00};
+            bool differ = false;
+            uint8_t first = 0xff;
+            for (size_t i = 0; i < cards.size(); i++)
+            {
+                if (CARD_READY == cards[i].state)
+                {
+                    uint8_t size = (cards[i].levels() - 1) << 6;
+                    atqa[0] |= size;
+                    differ |= (0xff != first) && (first != size);
+                    first = size;
+                }
+            }
+            answer(chip, atqa, 2, 0, differ ? (RX_COLLISION_DETECTED | RX_DATA_INTEGRITY_ERROR) : 0);
+        }
+    }
+
+    void anticollision(PN5180Chip &chip, uint8_t level, const uint8_t *d, uint16_t len, uint8_t validBits)
+    {
+        uint8_t nvb = d[1];
+        int known = ((nvb >> 4) - 2) * 8 + (nvb & 0x0f);
+        if ((known < 0) || (known >= 40) || ((nvb & 0x0f) != validBits) ||
+            (len != 2 + (known + 7) / 8))
+        {
+            return;
+        }
+
+        std::vector<const Card *> match;
+        for (size_t i = 0; i < cards.size(); i++)
+        {
+            const Card &c = cards[i];
+            if ((CARD_READY != c.state) || (c.level != level))
+            {
+                continue;
+            }
+            uint8_t lb[5];
+            c.levelBits(level, lb);
+            bool same = true;
+            for (int b = 0; (b < known) && same; b++)
+            {
+                same = bitAt(lb, b) == bitAt(d + 2, b);
+            }
+            if (same)
+            {
+                match.push_back(&c);
+            }
+        }
+        if (match.empty())
+        {
+            return;
+        }
+
+        int align = chip.rxAlign();
+        if (align != known % 8)
+        {
+            return; // the cards answer, but the reader would misplace the bits
+        }
+        uint8_t rx[6] = {0};
+        int collision = -1;
+        for (int b = known; b < 40; b++)
+        {
+            int ones = 0;
+            for (size_t i = 0; i < match.size(); i++)
+            {
+                uint8_t lb[5];
+                match[i]->levelBits(level, lb);
+                ones += bitAt(lb, b);
+            }
+            int pos = align + (b - known);
+            if (ones)
+            {
+                rx[pos / 8] |= 1 << (pos % 8);
+            }
+            if ((collision < 0) && (ones != 0) && (ones != (int)match.size()))
+            {
+                collision = pos;
+            }
+        }
+        int bits = align + 40 - known;
+        uint32_t errors = 0;
+        if (collision >= 0)
+        {
+            errors = RX_COLLISION_DETECTED | RX_DATA_INTEGRITY_ERROR | ((uint32_t)collision << 19);
+        }
+        answer(chip, rx, (bits + 7) / 8, bits % 8, errors);
+    }
+
+    void select(PN5180Chip &chip, uint8_t level, const uint8_t *levelUid)
+    {
+        int selected = 0;
+        uint8_t sak = 0;
+        bool differ = false;
+        for (size_t i = 0; i < cards.size(); i++)
+        {
+            Card &c = cards[i];
+            if ((CARD_READY != c.state) || (c.level != level))
+            {
+                continue;
+            }
+            uint8_t lb[5];
+            c.levelBits(level, lb);
+            if (memcmp(lb, levelUid, 5))
+            {
+                c.state = CARD_IDLE;
+                continue;
+            }
+            uint8_t cardSak = c.sak;
+            if (level + 1 < c.levels())
+            {
+                c.level++;
+                cardSak = ISO14443_SAK_CASCADE;
+            }
+            else
+            {
+                c.state = CARD_ACTIVE;
+            }
+            differ |= selected && (cardSak != sak);
+            sak = cardSak;
+            selected++;
+        }
+        // cards sharing this level (a CL1 of two double-size UIDs) answer alike
+        if (selected)
+        {
+            answer(chip, &sak, 1, 0, differ ? (RX_COLLISION_DETECTED | RX_DATA_INTEGRITY_ERROR) : 0);
+        }
+    }
+};
+
+static CardField field;
+static int failed = 0;
+
+static Card makeCard(const char *hex)
+{
+    Card c;
+    memset(&c, 0, sizeof(c));
+    c.size = strlen(hex) / 2;
+    for (uint8_t i = 0; i < c.size; i++)
+    {
+        unsigned v;
+        sscanf(hex + 2 * i, "%2x", &v);
+        c.uid[i] = v;
+    }
+    c.sak = 0x08;
+    c.state = CARD_IDLE;
+    return c;
+}
+
+static void printUid(const uint8_t *uid, uint8_t size)
+{
+    for (uint8_t i = 0; i < size; i++)
+    {
+        printf("%02X", uid[i]);
+    }
+}
+
+// enumerate() the field once and check that every card was found and halted
+static bool runField(const char *name, uint32_t &frames)
+{
+    PN5180ISO14443 nfc(PN5180_CHIP_NSS, PN5180_CHIP_BUSY, PN5180_CHIP_RST);
+    ISO14443Card out[16];
+
+    pn5180Chip.clearCounters();
+    pn5180Chip.setTimeLimit(10000000000ULL);
+    nfc.begin();
+    nfc.setupRF();
+    uint8_t count = nfc.enumerate(out, 16);
+    frames = pn5180Chip.frames();
+    nfc.setRF_off();
+
+    bool good = (count == field.cards.size());
+    for (uint8_t i = 0; good && (i < count); i++)
+    {
+        bool found = false;
+        for (size_t k = 0; k < field.cards.size(); k++)
+        {
+            const Card &c = field.cards[k];
+            found |= (c.size == out[i].uidLength) && !memcmp(c.uid, out[i].uid, c.size) && (c.sak == out[i].sak);
+        }
+        good = found;
+    }
+
+    if (!good && name)
+    {
+        printf("%s: %u of %u cards:", name, count, (unsigned)field.cards.size());
+        for (size_t k = 0; k < field.cards.size(); k++)
+        {
+            printf(" ");
+            printUid(field.cards[k].uid, field.cards[k].size);
+        }
+        printf(", found");
+        for (uint8_t i = 0; i < count; i++)
+        {
+            printf(" ");
+            printUid(out[i].uid, out[i].uidLength);
+        }
+        printf("\n");
+    }
+    return good;
+}
+
+static void fixedField(const char *name, const std::vector<const char *> &uids)
+{
+    field.cards.clear();
+    for (size_t i = 0; i < uids.size(); i++)
+    {
+        field.cards.push_back(makeCard(uids[i]));
+    }
+    uint32_t frames;
+    bool good = runField(name, frames);
+    failed |= !good;
+    printf("%-44s %s, %u frames\n", name, good ? "ok" : "FAILED", frames);
+}
+
+int main(int argc, char **argv)
+{
+    int arg = 1;
+    if ((arg < argc) && !strcmp(argv[arg], "-v"))
+    {
+        field.verbose = true;
+        arg++;
+    }
+    int runs = (arg < argc) ? atoi(argv[arg]) : 2000;
+    pn5180Chip.attach(&field);
+
+    fixedField("one 4-byte UID", {"01020304"});
+    fixedField("one 7-byte UID", {"04112233445566"});
+    fixedField("one 10-byte UID", {"04112233445566778899"});
+    fixedField("4, 7 and 10 bytes: collision at CT", {"11223344", "04A1A2A3A4A5A6", "04B1B2B3B4B5B6B7B8B9"});
+    fixedField("7-byte UIDs sharing CL1", {"04AABB11223344", "04AABB55667788"});
+    fixedField("10-byte UIDs sharing CL1 and CL2", {"04AABBCCDDEE01020304", "04AABBCCDDEE05060708"});
+    fixedField("collision in bit 3 of byte 1", {"10200000", "10280000"});
+    fixedField("collision in bit 7 of byte 2", {"A5A50100", "A5A58100"});
+    fixedField("collision in the last UID byte", {"01020304", "01020305", "01020306"});
+    fixedField("all bits of byte 0 collide", {"00FFFFFF", "FF000000"});
+
+    // halted cards stay quiet for REQA, WUPA wakes them
+    field.cards.clear();
+    field.cards.push_back(makeCard("0A0B0C0D"));
+    field.cards.push_back(makeCard("04010203040506"));
+    field.cards[1].state = CARD_HALT;
+    uint32_t frames;
+    bool good = runField("halted card, WUPA", frames);
+    failed |= !good;
+    printf("%-44s %s, %u frames\n", "one card halted before WUPA", good ? "ok" : "FAILED", frames);
+
+    // random fields of up to six cards, some sharing their first bytes
+    srand(1);
+    int ok = 0;
+    uint64_t totalFrames = 0;
+    uint32_t totalCards = 0;
+    field.verbose = false;
+    for (int r = 0; r < runs; r++)
+    {
+        field.cards.clear();
+        int n = 1 + rand() % 6;
+        for (int i = 0; i < n; i++)
+        {
+            Card c;
+            memset(&c, 0, sizeof(c));
+            int s = rand() % 3;
+            c.size = (0 == s) ? 4 : (1 == s) ? 7 : 10;
+            for (int k = 0; k < c.size; k++)
+            {
+                c.uid[k] = rand();
+            }
+            if ((i > 0) && (rand() % 3 == 0))
+            {
+                memcpy(c.uid, field.cards[0].uid, 3 + rand() % 4);
+            }
+            if ((4 == c.size) && (ISO14443_CASCADE_TAG == c.uid[0]))
+            {
+                c.uid[0] = 0x11; // 0x88 is CT, not a single-size UID byte
+            }
+            bool duplicate = false;
+            for (size_t k = 0; k < field.cards.size(); k++)
+            {
+                uint8_t a[5], b[5];
+                const Card &o = field.cards[k];
+                // two cards agreeing on every level would be one card to the reader
+                for (uint8_t l = 0; l < 3; l++)
+                {
+                    if ((l < c.levels()) && (l < o.levels()))
+                    {
+                        c.levelBits(l, a);
+                        o.levelBits(l, b);
+                        duplicate |= !memcmp(a, b, 5) && (l + 1 == c.levels() || l + 1 == o.levels());
+                    }
+                }
+            }
+            if (duplicate)
+            {
+                i--;
+                continue;
+            }
+            c.sak = (rand() & 1) ? 0x08 : 0x20;
+            c.state = (rand() % 4 == 0) ? CARD_HALT : CARD_IDLE;
+            field.cards.push_back(c);
+        }
+        bool good = runField("random field", frames);
+        ok += good;
+        totalFrames += frames;
+        totalCards += n;
+    }
+    failed |= (ok != runs);
+    printf("%d/%d random fields fully enumerated, %.1f frames per card\n", ok, runs,
+           totalCards ? (double)totalFrames / totalCards : 0.0);
+
+    printf("%s\n", failed ? "FAILED" : "ok");
+    return failed;
+}
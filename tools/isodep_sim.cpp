@@ -0,0 +1,379 @@
+// NAME: isodep_sim.cpp
+//
+// DESC: Host check for the ISO-DEP transport (PN5180ISODEP): runs the real
+//       driver on the PN5180 model of tools/mock/PN5180Chip.h in front of a
+//       simulated ISO14443-4 card that follows the PICC block rules. The
+//       card answers each command APDU with its bytes reversed, up to 300
+//       random bytes and 90 00, so every chaining direction is exercised.
+//
+//       Scenarios: a clean link; frames lost towards the card; answers lost
+//       towards the reader; answers with a CRC error; the card asking for
+//       S(WTX); all of them together. ATS with random FSCI 0-8 and FWI
+//       0-14, APDUs of up to 600 bytes. A recovered APDU must return the
+//       right data, a failed one must fail with an error, never wrong data.
+//
+//       Last it counts the SPI traffic of one short APDU in steady state
+//       (TIMER1 already set up), per host interface command and register.
+//
+// Build: g++ -std=gnu++11 -O2 -DARDUINO -Itools/mock -Iinclude -Isrc tools/isodep_sim.cpp
+//            src/PN5180.cpp src/PN5180ISO14443.cpp src/PN5180ISODEP.cpp src/PN5180Debug.cpp
+//            src/HexFormat.cpp src/ReportProtocol.cpp -o isodep_sim
+// Usage: isodep_sim [-v] [cards]
+//        -v prints the frames of the first failed APDUs; cards is the number
+//        of cards per scenario, three APDUs each (default 300). Exit status
+//        0 when no scenario returned wrong data and the clean link never
+//        failed.
+//
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include "PN5180Chip.h"
+#include "PN5180ISODEP.h"
+#include "UartDmaTxStub.h"
+
+typedef std::vector<uint8_t> Bytes;
+
+struct Scenario
+{
+    const char *name;
+    double loseTx;  // the card does not hear the frame
+    double loseRx;  // the reader does not hear the answer
+    double corrupt; // the answer arrives with a CRC error
+    double wtx;     // the card asks for more time before answering an APDU
+};
+
+static bool chance(double p)
+{
+    return rand() < p * RAND_MAX;
+}
+
+/*
+ * One ISO14443-4 PICC, already selected: RATS, then I-, R- and S-blocks
+ * without CID and NAD, ISO14443-4 7.5.3 and 7.5.4. The last block sent is
+ * kept for R(NAK) and for an R(ACK) repeating the current block number.
+ */
+class IsoDepCard : public PN5180Field
+{
+public:
+    IsoDepCard() : fsci(8), fwi(4) { reset(); }
+
+    uint8_t fsci;
+    uint8_t fwi;
+    Scenario link;
+    std::vector<std::string> log;
+
+    void reset()
+    {
+        blockNum_ = 1;
+        chain_.clear();
+        pending_.clear();
+        last_.clear();
+        wtxBlock_.clear();
+        log.clear();
+    }
+
+    void rfOff() override { reset(); }
+
+    void transmit(PN5180Chip &chip, const uint8_t *d, uint16_t len, uint8_t validBits) override
+    {
+        char line[96];
+        bool lostTx = chance(link.loseTx);
+        Bytes out;
+        bool answered = !lostTx && chip.txCrc() && chip.rxCrc() && (0 == validBits) && (len > 0) && picc(d, len, out);
+        bool lostRx = answered && chance(link.loseRx);
+        bool corrupt = answered && !lostRx && chance(link.corrupt);
+        snprintf(line, sizeof(line), "PCD %02X len %u%s -> %s %02X len %u%s", d[0], len, lostTx ? " lost" : "",
+                 answered ? "PICC" : "none", answered ? out[0] : 0, (unsigned)out.size(),
+                 lostRx ? " lost" : corrupt ? " CRC error" : "");
+        log.push_back(line);
+
+        if (answered && !lostRx)
+        {
+            chip.receive(out.data(), out.size(), 0, corrupt ? RX_DATA_INTEGRITY_ERROR : 0);
+        }
+    }
+
+private:
+    uint16_t fsd_;
+    uint8_t blockNum_;
+    Bytes chain_;    // command INF received so far
+    Bytes pending_;  // response INF not yet sent
+    Bytes last_;     // last block sent, for retransmission
+    Bytes wtxBlock_; // answer held back behind S(WTX)
+
+    Bytes nextIBlock()
+    {
+        uint16_t maxInf = fsd_ - 3;
+        size_t n = pending_.size();
+        bool more = n > maxInf;
+        if (more)
+        {
+            n = maxInf;
+        }
+        Bytes f(pending_.begin(), pending_.begin() + n);
+        f.insert(f.begin(), ISODEP_PCB_I | blockNum_ | (more ? ISODEP_PCB_CHAINING : 0));
+        pending_.erase(pending_.begin(), pending_.begin() + n);
+        return f;
+    }
+
+    bool picc(const uint8_t *d, uint16_t len, Bytes &out)
+    {
+        static const uint16_t fsdTable[9] = {16, 24, 32, 40, 48, 64, 96, 128, 256};
+        uint8_t pcb = d[0];
+
+        if ((ISODEP_RATS == pcb) && (2 == len))
+        {
+            fsd_ = fsdTable[((d[1] >> 4) < 8) ? (d[1] >> 4) : 8];
+            uint8_t ats[5] = {5, (uint8_t)(ISODEP_T0_TB | ISODEP_T0_TC | ISODEP_T0_TA | fsci), 0x80,
+                              (uint8_t)(fwi << 4), 0x00};
+            out.assign(ats, ats + sizeof(ats));
+            blockNum_ = 1;
+            return true;
+        }
+        if ((pcb & 0xE2) == 0x02) // I-block
+        {
+            if ((pcb & ISODEP_PCB_BLOCK_NUM) == blockNum_)
+            {
+                out = last_; // the reader repeats a block we already took
+                return true;
+            }
+            blockNum_ = pcb & ISODEP_PCB_BLOCK_NUM;
+            chain_.insert(chain_.end(), d + 1, d + len);
+            if (pcb & ISODEP_PCB_CHAINING)
+            {
+                out.assign(1, ISODEP_PCB_R_ACK | blockNum_);
+                last_ = out;
+                return true;
+            }
+            pending_.assign(chain_.rbegin(), chain_.rend());
+            for (int extra = rand() % 300; extra > 0; extra--)
+            {
+                pending_.push_back(rand());
+            }
+            pending_.push_back(0x90);
+            pending_.push_back(0x00);
+            chain_.clear();
+            if (chance(link.wtx))
+            {
+                wtxBlock_ = nextIBlock();
+                out.assign(1, ISODEP_PCB_S_WTX);
+                out.push_back(1 + rand() % 59);
+                last_ = out;
+                return true;
+            }
+            out = nextIBlock();
+            last_ = out;
+            return true;
+        }
+        if ((pcb & 0xC7) == 0xC2) // S-block
+        {
+            if (((pcb & 0x30) == 0x30) && !wtxBlock_.empty())
+            {
+                out = wtxBlock_;
+                wtxBlock_.clear();
+                last_ = out;
+                return true;
+            }
+            if ((pcb & 0x30) == 0x00)
+            {
+                out.assign(1, ISODEP_PCB_S_DESELECT);
+                return true;
+            }
+            return false;
+        }
+        if ((pcb & 0xE6) == 0xA2) // R-block
+        {
+            uint8_t bn = pcb & ISODEP_PCB_BLOCK_NUM;
+            if (!(pcb & ISODEP_PCB_NAK))
+            {
+                if (bn != blockNum_)
+                {
+                    // acknowledges our chained block: send the next part
+                    blockNum_ = bn;
+                    out = nextIBlock();
+                    last_ = out;
+                    return true;
+                }
+                out = last_;
+                return true;
+            }
+            if (bn == blockNum_)
+            {
+                out = last_;
+                return true;
+            }
+            out.assign(1, ISODEP_PCB_R_ACK | blockNum_);
+            return true;
+        }
+        return false;
+    }
+};
+
+static IsoDepCard card;
+static int failed = 0;
+
+static void runScenario(const Scenario &s, int cards, bool verbose)
+{
+    PN5180ISODEP dep(PN5180_CHIP_NSS, PN5180_CHIP_BUSY, PN5180_CHIP_RST);
+    int ok = 0, errors = 0, wrong = 0, shown = 0;
+    uint64_t frames = 0;
+    Scenario clean = {"", 0, 0, 0, 0};
+
+    pn5180Chip.setTimeLimit(600000000000ULL);
+    dep.begin();
+    dep.reset();
+    for (int n = 0; n < cards; n++)
+    {
+        card.fsci = rand() % 9;
+        card.fwi = rand() % (ISODEP_FWI_MAX + 1);
+        card.link = clean;
+
+        // a new card in the field, RATS on a clean link
+        pn5180Chip.setTimeLimit(600000000000ULL);
+        if (pn5180Chip.rfOn())
+        {
+            dep.setRF_off();
+        }
+        dep.setupRF();
+        card.reset();
+        if ((ISO14443_EC_OK != dep.rats()) || (dep.fwi() != card.fwi))
+        {
+            printf("%s: RATS failed\n", s.name);
+            failed = 1;
+            return;
+        }
+
+        card.link = s;
+        for (int k = 0; k < 3; k++)
+        {
+            Bytes c(1 + rand() % 600);
+            for (size_t i = 0; i < c.size(); i++)
+            {
+                c[i] = rand();
+            }
+            static uint8_t resp[1024];
+            uint16_t respLen;
+            card.log.clear();
+            pn5180Chip.clearCounters();
+            ISO14443ErrorCode rc;
+            try
+            {
+                rc = dep.apdu(c.data(), c.size(), resp, sizeof(resp), respLen);
+            }
+            catch (PN5180Chip::Stuck &stuck)
+            {
+                printf("%s: APDU still waiting at %.3f s\n", s.name, stuck.ns * 1e-9);
+                for (size_t i = 0; i < card.log.size(); i++)
+                {
+                    printf("  %s\n", card.log[i].c_str());
+                }
+                failed = 1;
+                return;
+            }
+            frames += pn5180Chip.frames();
+
+            if (ISO14443_EC_OK != rc)
+            {
+                errors++;
+                if (verbose && (shown++ < 2))
+                {
+                    printf("%s: APDU failed with %d\n", s.name, rc);
+                    for (size_t i = 0; i < card.log.size(); i++)
+                    {
+                        printf("  %s\n", card.log[i].c_str());
+                    }
+                }
+                break; // block numbers are out of step now, take the next card
+            }
+            bool good = (respLen >= c.size() + 2) && (0x90 == resp[respLen - 2]) && (0x00 == resp[respLen - 1]);
+            for (size_t i = 0; good && (i < c.size()); i++)
+            {
+                good = resp[i] == c[c.size() - 1 - i];
+            }
+            ok += good;
+            wrong += !good;
+        }
+    }
+    if (wrong || (errors && (0 == s.loseTx + s.loseRx + s.corrupt)))
+    {
+        failed = 1;
+    }
+    printf("%-26s %5d ok, %3d failed, %d wrong, %.1f frames per APDU%s\n", s.name, ok, errors, wrong,
+           (ok + errors + wrong) ? (double)frames / (ok + errors + wrong) : 0.0,
+           (wrong || (errors && !(s.loseTx + s.loseRx + s.corrupt))) ? "  FAILED" : "");
+}
+
+// SPI traffic of a short APDU once TIMER1 is set up for the card
+static void steadyState()
+{
+    PN5180ISODEP dep(PN5180_CHIP_NSS, PN5180_CHIP_BUSY, PN5180_CHIP_RST);
+    Scenario clean = {"", 0, 0, 0, 0};
+    uint8_t c[5] = {0x00, 0xA4, 0x04, 0x00, 0x00};
+    uint8_t resp[512];
+    uint16_t respLen;
+
+    card.link = clean;
+    card.fsci = 8;
+    card.fwi = 4;
+    dep.begin();
+    dep.reset();
+    dep.setupRF();
+    card.reset();
+    dep.rats();
+    dep.apdu(c, sizeof(c), resp, sizeof(resp), respLen);
+
+    srand(7); // a single-block answer
+    pn5180Chip.clearCounters();
+    ISO14443ErrorCode rc = dep.apdu(c, sizeof(c), resp, sizeof(resp), respLen);
+    if ((ISO14443_EC_OK != rc) || (1 != pn5180Chip.frames()))
+    {
+        printf("steady state: rc %d, %u frames\n", rc, pn5180Chip.frames());
+        failed = 1;
+        return;
+    }
+    uint32_t writes = 0;
+    for (int r = 0; r < 64; r++)
+    {
+        writes += pn5180Chip.registerWrites(r);
+    }
+    printf("short APDU: %u SPI frames: %u register writes (%u IRQ_CLEAR, %u SYSTEM_CONFIG, %u TIMER1), "
+           "%u RF_STATUS, %u IRQ_STATUS and %u RX_STATUS reads, %u SEND_DATA, %u READ_DATA\n",
+           pn5180Chip.spiFrames(), writes, pn5180Chip.registerWrites(IRQ_CLEAR),
+           pn5180Chip.registerWrites(SYSTEM_CONFIG),
+           pn5180Chip.registerWrites(TIMER1_CONFIG) + pn5180Chip.registerWrites(TIMER1_RELOAD),
+           pn5180Chip.registerReads(RF_STATUS), pn5180Chip.registerReads(IRQ_STATUS),
+           pn5180Chip.registerReads(RX_STATUS), pn5180Chip.commands(0x09), pn5180Chip.commands(0x0A));
+}
+
+int main(int argc, char **argv)
+{
+    int arg = 1;
+    bool verbose = false;
+    if ((arg < argc) && !strcmp(argv[arg], "-v"))
+    {
+        verbose = true;
+        arg++;
+    }
+    int cards = (arg < argc) ? atoi(argv[arg]) : 300;
+    pn5180Chip.attach(&card);
+
+    static const Scenario scenarios[] = {
+        {"clean link", 0, 0, 0, 0},
+        {"3% lost towards the card", 0.03, 0, 0, 0},
+        {"3% lost towards reader", 0, 0.03, 0, 0},
+        {"3% CRC errors", 0, 0, 0.03, 0},
+        {"20% WTX", 0, 0, 0, 0.2},
+        {"all of them", 0.03, 0.03, 0.03, 0.2},
+    };
+    srand(3);
+    for (size_t i = 0; i < sizeof(scenarios) / sizeof(scenarios[0]); i++)
+    {
+        runScenario(scenarios[i], cards, verbose);
+    }
+    steadyState();
+
+    printf("%s\n", failed ? "FAILED" : "ok");
+    return failed;
+}
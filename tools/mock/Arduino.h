@@ -0,0 +1,106 @@
+// NAME: Arduino.h
+//
+// DESC: Host stand-in for the Arduino core, just enough to build the PN5180
+//       driver into Linux tools (tools/pn5180_replay.cpp). Not used by the
+//       firmware. Time, pins and the SPI bus are provided by the tool.
+//
+#ifndef MOCK_ARDUINO_H
+#define MOCK_ARDUINO_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+
+typedef uint8_t byte;
+typedef bool boolean;
+
+#define HIGH 1
+#define LOW 0
+#define INPUT 0
+#define OUTPUT 1
+#define INPUT_PULLUP 2
+
+#define A3 3
+#define A4 4
+#define SS 10
+#define MOSI 11
+#define MISO 12
+#define SCK 13
+
+class __FlashStringHelper;
+#define F(s) ((const __FlashStringHelper *)(s))
+
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t value);
+int digitalRead(uint8_t pin);
+
+inline bool isPrintable(int c) { return isprint(c); }
+
+class Print
+{
+public:
+    virtual ~Print() {}
+    virtual size_t write(uint8_t c) = 0;
+    virtual size_t write(const uint8_t *buffer, size_t size)
+    {
+        size_t n = 0;
+        while (size--)
+        {
+            n += write(*buffer++);
+        }
+        return n;
+    }
+    size_t write(const char *s) { return write((const uint8_t *)s, strlen(s)); }
+
+    size_t print(const char *s) { return write(s); }
+    size_t print(const __FlashStringHelper *s) { return write((const char *)s); }
+    size_t print(char c) { return write((uint8_t)c); }
+    size_t print(unsigned long long v, int base = 10)
+    {
+        char b[24];
+        snprintf(b, sizeof(b), (16 == base) ? "%llX" : "%llu", v);
+        return write(b);
+    }
+    size_t print(long long v, int base = 10)
+    {
+        return (v < 0 && 10 == base) ? print('-') + print((unsigned long long)-v) : print((unsigned long long)v, base);
+    }
+    size_t print(unsigned long v, int base = 10) { return print((unsigned long long)v, base); }
+    size_t print(long v, int base = 10) { return print((long long)v, base); }
+    size_t print(unsigned int v, int base = 10) { return print((unsigned long long)v, base); }
+    size_t print(int v, int base = 10) { return print((long long)v, base); }
+    size_t print(unsigned char v, int base = 10) { return print((unsigned long long)v, base); }
+
+    size_t println() { return write("\n"); }
+    template <typename T>
+    size_t println(T v) { return print(v) + println(); }
+    template <typename T>
+    size_t println(T v, int base) { return print(v, base) + println(); }
+};
+
+class Stream : public Print
+{
+public:
+    virtual int available() { return 0; }
+    virtual int read() { return -1; }
+};
+
+// driver messages go to stderr so they do not mix with a tool's report
+class HardwareSerial : public Stream
+{
+public:
+    void begin(unsigned long) {}
+    size_t write(uint8_t c) override { return fwrite(&c, 1, 1, stderr); }
+    using Print::write;
+};
+
+extern HardwareSerial Serial;
+
+#endif /* MOCK_ARDUINO_H */
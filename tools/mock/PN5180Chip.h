@@ -0,0 +1,400 @@
+// NAME: PN5180Chip.h
+//
+// DESC: Host model of a PN5180 behind its SPI host interface, for Linux
+//       tools that run the real driver (src/PN5180*.cpp) against simulated
+//       cards. It decodes the host interface commands, keeps the registers
+//       the driver uses, drives BUSY and IRQ_STATUS, and hands every
+//       SEND_DATA to a PN5180Field that plays the cards.
+//
+//       It also defines the time, pin and SPI functions declared by the
+//       other tools/mock headers, so include it in exactly one file of a
+//       tool. Time is simulated: every clock read costs a microsecond, so
+//       polling loops make progress, and a wait that never ends throws
+//       PN5180Chip::Stuck instead of hanging the tool.
+//
+#ifndef MOCK_PN5180CHIP_H
+#define MOCK_PN5180CHIP_H
+
+#include <Arduino.h>
+#include <SPI.h>
+#include <vector>
+#include "PN5180.h"
+
+// pins to construct the driver with
+#define PN5180_CHIP_NSS 1
+#define PN5180_CHIP_BUSY 2
+#define PN5180_CHIP_RST 3
+
+// SYSTEM_CONFIG command field and RF_STATUS transceive state
+#define PN5180_CHIP_COMMAND_MASK 0x07
+#define PN5180_CHIP_COMMAND_TRANSCEIVE 0x03
+#define PN5180_CHIP_STATE_SHIFT 24
+
+// one TIMER1 tick at the 212 kHz prescaler, in ns
+#define PN5180_CHIP_T1_TICK_NS 4720ULL
+
+class PN5180Chip;
+
+/*
+ * The cards in front of the antenna. transmit() sees each frame the PN5180
+ * puts on air and answers through PN5180Chip::receive(), or stays silent.
+ */
+class PN5180Field
+{
+public:
+    virtual ~PN5180Field() {}
+
+    // the cards lose power when the field goes off, reset included
+    virtual void rfOn() {}
+    virtual void rfOff() {}
+
+    virtual void transmit(PN5180Chip &chip, const uint8_t *data, uint16_t len, uint8_t validBits) = 0;
+};
+
+class PN5180Chip
+{
+public:
+    // a busy wait that outlived the time limit
+    struct Stuck
+    {
+        uint64_t ns;
+    };
+
+    PN5180Chip()
+        : field_(0), nowNs_(0), limitNs_(10000000000ULL), busyUntilNs_(0), timerAtNs_(0), nssLow_(false),
+          rstLow_(false), rfOn_(false), readFrame_(false), rfConfig_(0xff), state_(0), irq_(0), rxLen_(0),
+          sendData_(0)
+    {
+        memset(regs_, 0, sizeof(regs_));
+        memset(eeprom_, 0, sizeof(eeprom_));
+        clearCounters();
+    }
+
+    void attach(PN5180Field *field) { field_ = field; }
+
+    // throw Stuck once the simulated time passes ns
+    void setTimeLimit(uint64_t ns) { limitNs_ = nowNs_ + ns; }
+
+    uint64_t nowNs() const { return nowNs_; }
+    bool rfOn() const { return rfOn_; }
+    // TX configuration of the last LOAD_RF_CONFIG: 0x00 ISO14443A 106 kbit/s, 0x0D ISO15693
+    uint8_t rfConfig() const { return rfConfig_; }
+
+    // framing of the frame on air, from CRC_TX_CONFIG and CRC_RX_CONFIG
+    bool txCrc() const { return regs_[CRC_TX_CONFIG] & TX_CRC_ENABLE; }
+    bool rxCrc() const { return regs_[CRC_RX_CONFIG] & RX_CRC_ENABLE; }
+    uint8_t rxAlign() const { return (regs_[CRC_RX_CONFIG] & RX_BIT_ALIGN_MASK) >> RX_BIT_ALIGN_SHIFT; }
+    uint32_t reg(uint8_t r) const { return regs_[r]; }
+
+    /*
+     * The answer to the last frame: bytes as they land in the reception
+     * buffer (RX_BIT_ALIGN already applied), valid bits of the last byte
+     * (0 = all) and the RX_STATUS error bits, collision position included.
+     */
+    void receive(const uint8_t *data, uint16_t len, uint8_t lastBits = 0, uint32_t errors = 0)
+    {
+        rxLen_ = (len < sizeof(rxBuffer_)) ? len : sizeof(rxBuffer_);
+        memcpy(rxBuffer_, data, rxLen_);
+        regs_[RX_STATUS] = rxLen_ | ((uint32_t)(lastBits & 7) << 13) | errors;
+        irq_ |= RX_SOF_DET_IRQ_STAT | RX_IRQ_STAT;
+        timerAtNs_ = 0; // TIMER1 stops when reception starts
+    }
+
+    // counters since clearCounters()
+    uint32_t commands(uint8_t code) const { return commands_[code]; }
+    uint32_t registerWrites(uint8_t r) const { return writes_[r]; }
+    uint32_t registerReads(uint8_t r) const { return reads_[r]; }
+    uint32_t spiFrames() const { return frames_; }
+    uint32_t frames() const { return sendData_; }
+    void clearCounters()
+    {
+        memset(commands_, 0, sizeof(commands_));
+        memset(writes_, 0, sizeof(writes_));
+        memset(reads_, 0, sizeof(reads_));
+        frames_ = 0;
+        sendData_ = 0;
+    }
+
+    /*
+     * Host side, called from the pin and SPI shims
+     */
+    void advance(uint64_t ns)
+    {
+        nowNs_ += ns;
+        if (nowNs_ > limitNs_)
+        {
+            Stuck s = {nowNs_};
+            throw s;
+        }
+    }
+
+    void nss(bool low)
+    {
+        if (low)
+        {
+            nssLow_ = true;
+            readFrame_ = !response_.empty();
+            frame_.clear();
+            return;
+        }
+        if (!nssLow_)
+        {
+            return; // begin() parks NSS high
+        }
+        nssLow_ = false;
+        frames_++;
+        busyUntilNs_ = nowNs_ + 20000;
+        if (readFrame_)
+        {
+            response_.clear();
+        }
+        else
+        {
+            execute();
+        }
+    }
+
+    void rst(bool low)
+    {
+        if (rstLow_ && !low)
+        {
+            memset(regs_, 0, sizeof(regs_));
+            irq_ = IDLE_IRQ_STAT;
+            state_ = 0;
+            timerAtNs_ = 0;
+            if (rfOn_ && field_)
+            {
+                field_->rfOff();
+            }
+            rfOn_ = false;
+            busyUntilNs_ = nowNs_ + 2000000; // boot
+        }
+        rstLow_ = low;
+    }
+
+    uint8_t transfer(uint8_t data)
+    {
+        advance(8000000000ULL / SPI.clock());
+        size_t i = frame_.size();
+        frame_.push_back(data);
+        return (readFrame_ && (i < response_.size())) ? response_[i] : 0xff;
+    }
+
+    int busy()
+    {
+        if (nssLow_ || (nowNs_ < busyUntilNs_))
+        {
+            return HIGH;
+        }
+        return LOW;
+    }
+
+private:
+    void execute()
+    {
+        if (frame_.empty())
+        {
+            return;
+        }
+        const uint8_t *f = frame_.data();
+        uint8_t code = f[0];
+        commands_[code]++;
+        response_.clear();
+
+        switch (code)
+        {
+        case 0x00: // WRITE_REGISTER
+        case 0x01: // WRITE_REGISTER_OR_MASK
+        case 0x02: // WRITE_REGISTER_AND_MASK
+            if (frame_.size() >= 6)
+            {
+                uint32_t v = f[2] | (f[3] << 8) | (f[4] << 16) | ((uint32_t)f[5] << 24);
+                uint8_t r = f[1] & 0x3f;
+                writeRegister(r, (0x01 == code) ? (regs_[r] | v) : (0x02 == code) ? (regs_[r] & v) : v);
+            }
+            break;
+        case 0x04: // READ_REGISTER
+        {
+            uint32_t v = readRegister(f[1] & 0x3f);
+            for (int i = 0; i < 4; i++)
+            {
+                response_.push_back(v >> (8 * i));
+            }
+            break;
+        }
+        case 0x07: // READ_EEPROM
+            response_.assign(eeprom_ + f[1], eeprom_ + f[1] + f[2]);
+            break;
+        case 0x09: // SEND_DATA
+            sendData(f + 2, frame_.size() - 2, f[1]);
+            break;
+        case 0x0A: // READ_DATA
+            response_.assign(rxBuffer_, rxBuffer_ + sizeof(rxBuffer_));
+            break;
+        case 0x11: // LOAD_RF_CONFIG
+            // ISO15693 configurations switch both CRCs on, ISO14443A 106 kbit/s off
+            rfConfig_ = f[1];
+            regs_[CRC_TX_CONFIG] = (0x0D == f[1] || 0x0E == f[1]) ? TX_CRC_ENABLE : 0;
+            regs_[CRC_RX_CONFIG] = (0x0D == f[1] || 0x0E == f[1]) ? RX_CRC_ENABLE : 0;
+            busyUntilNs_ = nowNs_ + 300000;
+            break;
+        case 0x16: // RF_ON: no TX_RFON_IRQ when the field is already on
+            if (!rfOn_)
+            {
+                rfOn_ = true;
+                irq_ |= TX_RFON_IRQ_STAT;
+                if (field_)
+                {
+                    field_->rfOn();
+                }
+            }
+            break;
+        case 0x17: // RF_OFF
+            if (rfOn_)
+            {
+                rfOn_ = false;
+                irq_ |= TX_RFOFF_IRQ_STAT;
+                if (field_)
+                {
+                    field_->rfOff();
+                }
+            }
+            break;
+        }
+    }
+
+    void writeRegister(uint8_t r, uint32_t v)
+    {
+        writes_[r]++;
+        if (IRQ_CLEAR == r)
+        {
+            irq_ &= ~v;
+            return;
+        }
+        regs_[r] = v;
+        if (SYSTEM_CONFIG == r)
+        {
+            state_ = ((v & PN5180_CHIP_COMMAND_MASK) == PN5180_CHIP_COMMAND_TRANSCEIVE) ? PN5180_TS_WaitTransmit
+                                                                                       : PN5180_TS_Idle;
+        }
+    }
+
+    uint32_t readRegister(uint8_t r)
+    {
+        reads_[r]++;
+        if (IRQ_STATUS == r)
+        {
+            if (timerAtNs_ && (nowNs_ >= timerAtNs_))
+            {
+                irq_ |= TIMER1_IRQ_STAT;
+                timerAtNs_ = 0;
+            }
+            return irq_;
+        }
+        if (RF_STATUS == r)
+        {
+            return (uint32_t)state_ << PN5180_CHIP_STATE_SHIFT;
+        }
+        return regs_[r];
+    }
+
+    void sendData(const uint8_t *data, uint16_t len, uint8_t validBits)
+    {
+        if (PN5180_TS_WaitTransmit != state_)
+        {
+            return; // the real chip raises a general error here
+        }
+        sendData_++;
+        state_ = PN5180_TS_WaitReceive;
+        regs_[RX_STATUS] = 0;
+        irq_ |= TX_IRQ_STAT;
+
+        uint32_t t1 = regs_[TIMER1_CONFIG];
+        if ((t1 & T1_ENABLE) && (t1 & T1_START_ON_TX_ENDED))
+        {
+            timerAtNs_ = nowNs_ + (regs_[TIMER1_RELOAD] & T1_RELOAD_MAX) * PN5180_CHIP_T1_TICK_NS + 1;
+        }
+        if (rfOn_ && field_)
+        {
+            field_->transmit(*this, data, len, validBits);
+        }
+    }
+
+    PN5180Field *field_;
+    uint64_t nowNs_;
+    uint64_t limitNs_;
+    uint64_t busyUntilNs_;
+    uint64_t timerAtNs_;
+    bool nssLow_;
+    bool rstLow_;
+    bool rfOn_;
+    bool readFrame_; // the frame clocking out the last command's response
+    uint8_t rfConfig_;
+    uint8_t state_;
+    uint32_t irq_;
+    uint32_t regs_[64];
+    uint8_t eeprom_[256];
+    uint8_t rxBuffer_[508];
+    uint16_t rxLen_;
+    std::vector<uint8_t> frame_;
+    std::vector<uint8_t> response_;
+
+    uint32_t commands_[256];
+    uint32_t writes_[64];
+    uint32_t reads_[64];
+    uint32_t frames_;
+    uint32_t sendData_;
+};
+
+PN5180Chip pn5180Chip;
+
+/*
+ * Arduino and SPI shims the driver links against
+ */
+HardwareSerial Serial;
+SPIClass SPI;
+
+unsigned long millis()
+{
+    pn5180Chip.advance(1000);
+    return pn5180Chip.nowNs() / 1000000;
+}
+
+unsigned long micros()
+{
+    pn5180Chip.advance(1000);
+    return pn5180Chip.nowNs() / 1000;
+}
+
+void delay(unsigned long ms) { pn5180Chip.advance(ms * 1000000ULL); }
+void delayMicroseconds(unsigned int us) { pn5180Chip.advance(us * 1000ULL); }
+void pinMode(uint8_t, uint8_t) {}
+
+void digitalWrite(uint8_t pin, uint8_t value)
+{
+    if (PN5180_CHIP_NSS == pin)
+    {
+        pn5180Chip.nss(LOW == value);
+    }
+    else if (PN5180_CHIP_RST == pin)
+    {
+        pn5180Chip.rst(LOW == value);
+    }
+}
+
+int digitalRead(uint8_t pin)
+{
+    if (PN5180_CHIP_BUSY == pin)
+    {
+        pn5180Chip.advance(1000);
+        return pn5180Chip.busy();
+    }
+    return LOW;
+}
+
+uint8_t SPIClass::transfer(uint8_t data)
+{
+    return pn5180Chip.transfer(data);
+}
+
+#endif /* MOCK_PN5180CHIP_H */
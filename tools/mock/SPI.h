@@ -0,0 +1,42 @@
+// NAME: SPI.h
+//
+// DESC: Host stand-in for the Arduino SPI library; the tool defines
+//       SPIClass::transfer() and the SPI object.
+//
+#ifndef MOCK_SPI_H
+#define MOCK_SPI_H
+
+#include <Arduino.h>
+
+#define MSBFIRST 1
+#define SPI_MODE0 0
+
+class SPISettings
+{
+public:
+    SPISettings(uint32_t clock = 4000000, uint8_t bitOrder = MSBFIRST, uint8_t dataMode = SPI_MODE0)
+        : clock(clock), bitOrder(bitOrder), dataMode(dataMode)
+    {
+    }
+    uint32_t clock;
+    uint8_t bitOrder;
+    uint8_t dataMode;
+};
+
+class SPIClass
+{
+public:
+    void begin() {}
+    void end() {}
+    void beginTransaction(SPISettings settings) { clock_ = settings.clock; }
+    void endTransaction() {}
+    uint8_t transfer(uint8_t data);
+    uint32_t clock() const { return clock_; }
+
+private:
+    uint32_t clock_ = 4000000;
+};
+
+extern SPIClass SPI;
+
+#endif /* MOCK_SPI_H */
@@ -0,0 +1,24 @@
+// NAME: UartDmaTxStub.h
+//
+// DESC: Host definitions of uartTx (include/UartDmaTx.h) for Linux tools
+//       that link src/ReportProtocol.cpp. Everything written goes straight
+//       to Serial: no ring, so nothing is dropped and nothing waits.
+//
+//       Include it in exactly one file of a tool.
+//
+#ifndef MOCK_UARTDMATXSTUB_H
+#define MOCK_UARTDMATXSTUB_H
+
+#include <Arduino.h>
+#include "UartDmaTx.h"
+
+UartDmaTx uartTx;
+
+UartDmaTx::UartDmaTx() {}
+size_t UartDmaTx::write(uint8_t c) { return Serial.write(c); }
+size_t UartDmaTx::write(const uint8_t *buffer, size_t size) { return Serial.write(buffer, size); }
+bool UartDmaTx::beginMessage(size_t) { return true; }
+void UartDmaTx::endMessage() {}
+void UartDmaTx::flush() {}
+
+#endif /* MOCK_UARTDMATXSTUB_H */
@@ -0,0 +1,448 @@
+// NAME: pn5180_replay.cpp
+//
+// DESC: Linux replay of PN5180 SPI captures (include/PN5180Capture.h).
+//       Runs the real driver against a mock bus that answers every read
+//       from the capture and checks every frame the driver sends against
+//       it, so a protocol change shows up as the first diverging frame.
+//       Time is simulated: SPI bytes at the driver's SPI clock, BUSY as
+//       recorded, delay() as called, which makes the reported bus time
+//       comparable between driver versions.
+//
+// Build: g++ -std=gnu++11 -O2 -DARDUINO -Itools/mock -Iinclude -Isrc tools/pn5180_replay.cpp
+//            src/PN5180.cpp src/PN5180ISO14443.cpp src/PN5180ISO15693.cpp src/PN5180Poller.cpp
+//            src/PN5180Debug.cpp src/HexFormat.cpp src/ReportProtocol.cpp -o pn5180_replay
+// Usage: pn5180_replay [-v] scenario capture
+//        capture is the raw serial output containing the REPORT_CAPTURE
+//        frames of command 0xFA; anything else in it is skipped.
+//        scenario is what the firmware ran while recording, repeated until
+//        the capture ends:
+//          list       print the capture, run nothing
+//          inventory  PN5180ISO15693::setupRF(), then getInventory()
+//          search     PN5180ISO15693::setupRF(), then search_all()
+//          enumerate  PN5180ISO14443::setupRF(), then enumerate()
+//          poll       PN5180Poller::poll()
+//        Dump once before the operation so the capture starts with it.
+//        Exit status: 0 capture replayed, 1 divergence, 2 usage or input.
+//
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+#include <Arduino.h>
+#include <SPI.h>
+#include "ReportProtocol.h"
+#include "PN5180ISO14443.h"
+#include "PN5180ISO15693.h"
+#include "PN5180Poller.h"
+#include "UartDmaTxStub.h"
+
+#define NSS_PIN 1
+#define BUSY_PIN 2
+#define RST_PIN 3
+
+struct Record
+{
+    uint8_t flags;
+    uint16_t busyUs;
+    std::vector<uint8_t> bytes;
+};
+
+static const char *commandName(uint8_t code)
+{
+    switch (code)
+    {
+    case 0x00:
+        return "WRITE_REGISTER";
+    case 0x01:
+        return "WRITE_REGISTER_OR_MASK";
+    case 0x02:
+        return "WRITE_REGISTER_AND_MASK";
+    case 0x04:
+        return "READ_REGISTER";
+    case 0x07:
+        return "READ_EEPROM";
+    case 0x09:
+        return "SEND_DATA";
+    case 0x0A:
+        return "READ_DATA";
+    case 0x0B:
+        return "SWITCH_MODE";
+    case 0x11:
+        return "LOAD_RF_CONFIG";
+    case 0x16:
+        return "RF_ON";
+    case 0x17:
+        return "RF_OFF";
+    default:
+        return "?";
+    }
+}
+
+static void printBytes(const uint8_t *b, size_t n)
+{
+    for (size_t i = 0; i < n; i++)
+    {
+        printf(" %02X", b[i]);
+    }
+}
+
+static void printRecord(size_t index, const Record &r)
+{
+    bool miso = r.flags & REPORT_CAPTURE_MISO;
+    printf("%6zu %s busy=%5uus", index, miso ? "<<" : ">>", r.busyUs);
+    if (!miso && !r.bytes.empty())
+    {
+        printf(" %-23s", commandName(r.bytes[0]));
+    }
+    printBytes(r.bytes.data(), r.bytes.size());
+    printf("\n");
+}
+
+/*
+ * Mock bus: the capture, a cursor into it and the simulated clock
+ */
+class ReplayBus
+{
+public:
+    struct End
+    {
+    };
+    struct Divergence
+    {
+        size_t index;
+        std::vector<uint8_t> sent;
+    };
+
+    ReplayBus() : verbose(false), cursor_(0), nowNs_(0), busyUntilNs_(0), nssLow_(false),
+                  spiNs_(0), busyNs_(0), delayNs_(0), bytes_(0)
+    {
+        memset(commands_, 0, sizeof(commands_));
+    }
+
+    std::vector<Record> records;
+    bool verbose;
+
+    void advance(uint64_t ns) { nowNs_ += ns; }
+    void sleep(uint64_t ns)
+    {
+        nowNs_ += ns;
+        delayNs_ += ns;
+    }
+    uint64_t nowNs() const { return nowNs_; }
+
+    void nss(bool low)
+    {
+        if (low)
+        {
+            if (cursor_ >= records.size())
+            {
+                throw End();
+            }
+            nssLow_ = true;
+            frame_.clear();
+            return;
+        }
+        if (!nssLow_)
+        {
+            return; // begin() parks NSS high
+        }
+
+        nssLow_ = false;
+        const Record &r = records[cursor_];
+        bool miso = r.flags & REPORT_CAPTURE_MISO;
+        // a read frame clocks out 0xFF bytes
+        bool same = miso ? (frame_ == std::vector<uint8_t>(r.bytes.size(), 0xff)) : (frame_ == r.bytes);
+        if (!same)
+        {
+            Divergence d = {cursor_, frame_};
+            throw d;
+        }
+        if (verbose)
+        {
+            printRecord(cursor_, r);
+        }
+        if (!miso && !r.bytes.empty())
+        {
+            commands_[r.bytes[0]]++;
+        }
+        busyUntilNs_ = nowNs_ + r.busyUs * 1000ULL;
+        cursor_++;
+    }
+
+    uint8_t transfer(uint8_t data)
+    {
+        uint64_t ns = 8000000000ULL / SPI.clock();
+        nowNs_ += ns;
+        spiNs_ += ns;
+        bytes_++;
+
+        frame_.push_back(data);
+        const Record &r = records[cursor_];
+        if ((r.flags & REPORT_CAPTURE_MISO) && (frame_.size() <= r.bytes.size()))
+        {
+            return r.bytes[frame_.size() - 1];
+        }
+        return 0xff;
+    }
+
+    // BUSY is high during a frame and until the recorded busy time has passed
+    int busy()
+    {
+        if (nssLow_)
+        {
+            return HIGH;
+        }
+        if (nowNs_ < busyUntilNs_)
+        {
+            busyNs_ += busyUntilNs_ - nowNs_;
+            nowNs_ = busyUntilNs_;
+            return HIGH;
+        }
+        return LOW;
+    }
+
+    void printSummary() const
+    {
+        printf("replayed %zu of %zu records, %llu SPI bytes\n", cursor_, records.size(),
+               (unsigned long long)bytes_);
+        printf("bus time %.3f ms: SPI %.3f ms, BUSY %.3f ms, driver delays %.3f ms\n", nowNs_ / 1e6, spiNs_ / 1e6,
+               busyNs_ / 1e6, delayNs_ / 1e6);
+        for (int i = 0; i < 256; i++)
+        {
+            if (commands_[i])
+            {
+                printf("  %-23s %u\n", commandName(i), commands_[i]);
+            }
+        }
+    }
+
+private:
+    size_t cursor_;
+    uint64_t nowNs_;
+    uint64_t busyUntilNs_;
+    bool nssLow_;
+    std::vector<uint8_t> frame_;
+    uint64_t spiNs_;
+    uint64_t busyNs_;
+    uint64_t delayNs_;
+    uint64_t bytes_;
+    uint32_t commands_[256];
+};
+
+static ReplayBus bus;
+
+/*
+ * Arduino and SPI shims the driver links against; uartTx is in UartDmaTxStub.h
+ */
+HardwareSerial Serial;
+SPIClass SPI;
+
+// every clock read costs a microsecond, so a polling loop always makes progress
+unsigned long millis()
+{
+    bus.advance(1000);
+    return bus.nowNs() / 1000000;
+}
+
+unsigned long micros()
+{
+    bus.advance(1000);
+    return bus.nowNs() / 1000;
+}
+
+void delay(unsigned long ms) { bus.sleep(ms * 1000000ULL); }
+void delayMicroseconds(unsigned int us) { bus.sleep(us * 1000ULL); }
+void pinMode(uint8_t, uint8_t) {}
+
+void digitalWrite(uint8_t pin, uint8_t value)
+{
+    if (NSS_PIN == pin)
+    {
+        bus.nss(LOW == value);
+    }
+}
+
+int digitalRead(uint8_t pin)
+{
+    return (BUSY_PIN == pin) ? bus.busy() : LOW;
+}
+
+uint8_t SPIClass::transfer(uint8_t data)
+{
+    return bus.transfer(data);
+}
+
+// records of one REPORT_CAPTURE frame
+static void addFrame(const ReportDecoder &dec, uint32_t frame, std::vector<Record> &records)
+{
+    const uint8_t *p = dec.payload();
+    uint32_t dropped = p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+    if (dropped)
+    {
+        fprintf(stderr, "warning: %u records dropped before frame %u\n", dropped, frame);
+    }
+    for (uint16_t i = 4; i + REPORT_CAPTURE_HEADER_LEN <= dec.length();)
+    {
+        Record r;
+        uint16_t len = p[i + 1] | (p[i + 2] << 8);
+        r.flags = p[i];
+        r.busyUs = p[i + 3] | (p[i + 4] << 8);
+        i += REPORT_CAPTURE_HEADER_LEN;
+        if (i + len > dec.length())
+        {
+            fprintf(stderr, "warning: truncated record in frame %u\n", frame);
+            break;
+        }
+        r.bytes.assign(p + i, p + i + len);
+        records.push_back(r);
+        i += len;
+    }
+}
+
+static bool load(const char *path, std::vector<Record> &records)
+{
+    FILE *f = fopen(path, "rb");
+    if (!f)
+    {
+        perror(path);
+        return false;
+    }
+
+    static ReportDecoder dec;
+    int c;
+    uint32_t frames = 0;
+    while ((c = fgetc(f)) != EOF)
+    {
+        if (!dec.feed((uint8_t)c))
+        {
+            continue;
+        }
+        do
+        {
+            if ((REPORT_CAPTURE == dec.type()) && (dec.length() >= 4))
+            {
+                addFrame(dec, frames++, records);
+            }
+        } while (dec.next());
+    }
+    while (dec.finish())
+    {
+        if ((REPORT_CAPTURE == dec.type()) && (dec.length() >= 4))
+        {
+            addFrame(dec, frames++, records);
+        }
+    }
+    fclose(f);
+    if (dec.crcErrors() || dec.oversized())
+    {
+        fprintf(stderr, "warning: %u frames with a bad CRC or length skipped\n", dec.crcErrors() + dec.oversized());
+    }
+    return true;
+}
+
+static void runScenario(const char *scenario)
+{
+    PN5180ISO14443 iso14443(NSS_PIN, BUSY_PIN, RST_PIN);
+    PN5180ISO15693 iso15693(NSS_PIN, BUSY_PIN, RST_PIN);
+
+    if (!strcmp(scenario, "inventory"))
+    {
+        iso15693.begin();
+        iso15693.setupRF();
+        for (;;)
+        {
+            Uid uid;
+            iso15693.getInventory(uid);
+        }
+    }
+    else if (!strcmp(scenario, "search"))
+    {
+        iso15693.begin();
+        iso15693.setupRF();
+        for (;;)
+        {
+            iso15693.search_all();
+        }
+    }
+    else if (!strcmp(scenario, "enumerate"))
+    {
+        ISO14443Card cards[8];
+        iso14443.begin();
+        iso14443.setupRF();
+        for (;;)
+        {
+            iso14443.enumerate(cards, 8);
+        }
+    }
+    else if (!strcmp(scenario, "poll"))
+    {
+        PN5180Poller poller(iso14443, iso15693);
+        PN5180PollResult result;
+        iso14443.begin();
+        for (;;)
+        {
+            poller.poll(result);
+        }
+    }
+}
+
+int main(int argc, char **argv)
+{
+    int arg = 1;
+    if ((arg < argc) && !strcmp(argv[arg], "-v"))
+    {
+        bus.verbose = true;
+        arg++;
+    }
+    if (argc - arg != 2)
+    {
+        fprintf(stderr, "usage: %s [-v] list|inventory|search|enumerate|poll capture\n", argv[0]);
+        return 2;
+    }
+    const char *scenario = argv[arg];
+    if (!load(argv[arg + 1], bus.records))
+    {
+        return 2;
+    }
+
+    if (!strcmp(scenario, "list"))
+    {
+        for (size_t i = 0; i < bus.records.size(); i++)
+        {
+            printRecord(i, bus.records[i]);
+        }
+        return 0;
+    }
+    if (strcmp(scenario, "inventory") && strcmp(scenario, "search") && strcmp(scenario, "enumerate") &&
+        strcmp(scenario, "poll"))
+    {
+        fprintf(stderr, "unknown scenario %s\n", scenario);
+        return 2;
+    }
+    if (bus.records.empty())
+    {
+        fprintf(stderr, "no capture records in %s\n", argv[arg + 1]);
+        return 2;
+    }
+
+    try
+    {
+        runScenario(scenario);
+    }
+    catch (const ReplayBus::End &)
+    {
+        bus.printSummary();
+        return 0;
+    }
+    catch (const ReplayBus::Divergence &d)
+    {
+        bus.printSummary();
+        printf("DIVERGENCE at record %zu\n  capture:", d.index);
+        printRecord(d.index, bus.records[d.index]);
+        printf("  driver: %s", bus.records[d.index].flags & REPORT_CAPTURE_MISO ? "<<" : ">>");
+        printBytes(d.sent.data(), d.sent.size());
+        printf("\n");
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,255 @@
+// NAME: poller_check.cpp
+//
+// DESC: Host check for PN5180Poller: runs the real poller and protocol
+//       drivers on the PN5180 model of tools/mock/PN5180Chip.h in front of
+//       an ISO14443A card and an ISO15693 label that answer only under
+//       their own RF configuration.
+//
+//       Checks that RF_ON on a field that is already on returns instead of
+//       waiting for a TX_RFON_IRQ that never comes, that the poller starts
+//       from a field someone else left on, how many LOAD_RF_CONFIG, RF_OFF
+//       and RF_ON an empty field, one technology and both cards cost, and
+//       that both cards are found in turn.
+//
+// Build: g++ -std=gnu++11 -O2 -DARDUINO -Itools/mock -Iinclude -Isrc tools/poller_check.cpp
+//            src/PN5180.cpp src/PN5180ISO14443.cpp src/PN5180ISO15693.cpp src/PN5180Poller.cpp
+//            src/PN5180Debug.cpp src/HexFormat.cpp src/ReportProtocol.cpp -o poller_check
+// Usage: poller_check
+//        exit status 0 when every check passed
+//
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "PN5180Chip.h"
+#include "PN5180Poller.h"
+#include "UartDmaTxStub.h"
+
+static int failed = 0;
+
+#define CHECK(cond, ...)           \
+    do                             \
+    {                              \
+        if (!(cond))               \
+        {                          \
+            printf(__VA_ARGS__);   \
+            printf("\n");          \
+            failed = 1;            \
+        }                          \
+    } while (0)
+
+#define RF_CONFIG_ISO14443A 0x00
+#define RF_CONFIG_ISO15693 0x0D
+
+/*
+ * One ISO14443A card with a single-size UID (REQA/WUPA, ANTICOLLISION and
+ * SELECT of cascade level 1, HLTA) and one ISO15693 label answering a
+ * 1-slot INVENTORY whose mask matches. Both lose power with the field.
+ */
+class TwoCardField : public PN5180Field
+{
+public:
+    TwoCardField() : cardPresent(false), labelPresent(false), cardState_(IDLE) {}
+
+    static const uint8_t cardUid[4];
+    static const uint64_t labelUid = 0xE004A1B2C3D4E574ULL; // low byte matches the driver's 8-bit mask
+
+    bool cardPresent;
+    bool labelPresent;
+
+    void rfOff() override { cardState_ = IDLE; }
+
+    void transmit(PN5180Chip &chip, const uint8_t *d, uint16_t len, uint8_t validBits) override
+    {
+        if (RF_CONFIG_ISO14443A == chip.rfConfig())
+        {
+            if (cardPresent)
+            {
+                card(chip, d, len, validBits);
+            }
+        }
+        else if ((RF_CONFIG_ISO15693 == chip.rfConfig()) && labelPresent)
+        {
+            label(chip, d, len);
+        }
+    }
+
+private:
+    enum
+    {
+        IDLE,
+        READY,
+        ACTIVE,
+        HALT
+    } cardState_;
+
+    void card(PN5180Chip &chip, const uint8_t *d, uint16_t len, uint8_t validBits)
+    {
+        uint8_t level[5];
+        memcpy(level, cardUid, 4);
+        level[4] = level[0] ^ level[1] ^ level[2] ^ level[3];
+
+        if ((1 == len) && (7 == validBits) && ((ISO14443_REQA == d[0]) || (ISO14443_WUPA == d[0])))
+        {
+            if ((IDLE == cardState_) || ((HALT == cardState_) && (ISO14443_WUPA == d[0])))
+            {
+                uint8_t atqa[2] = {0x04, 0x00};
+                cardState_ = READY;
+                chip.receive(atqa, 2);
+            }
+        }
+        else if ((READY == cardState_) && (2 == len) && (ISO14443_SEL_CL1 == d[0]) && (0x20 == d[1]))
+        {
+            chip.receive(level, 5);
+        }
+        else if ((READY == cardState_) && (7 == len) && (ISO14443_SEL_CL1 == d[0]) && chip.txCrc() &&
+                 !memcmp(d + 2, level, 5))
+        {
+            uint8_t sak = 0x08;
+            cardState_ = ACTIVE;
+            chip.receive(&sak, 1);
+        }
+        else if ((2 == len) && (ISO14443_HLTA == d[0]) && chip.txCrc())
+        {
+            cardState_ = HALT;
+        }
+    }
+
+    void label(PN5180Chip &chip, const uint8_t *d, uint16_t len)
+    {
+        // flags, INVENTORY, mask length 8, one mask byte
+        if ((4 == len) && (0x01 == d[1]) && (8 == d[2]) && (d[3] == (uint8_t)labelUid) && chip.txCrc())
+        {
+            uint8_t resp[10] = {0x00, 0x00};
+            Uid(labelUid).toBytes(resp + 2);
+            chip.receive(resp, sizeof(resp));
+        }
+    }
+};
+
+const uint8_t TwoCardField::cardUid[4] = {0x11, 0x22, 0x33, 0x44};
+
+static TwoCardField field;
+
+struct RfCost
+{
+    uint32_t loads;
+    uint32_t rfOff;
+    uint32_t rfOn;
+};
+
+static RfCost rfCost()
+{
+    RfCost c = {pn5180Chip.commands(0x11), pn5180Chip.commands(0x17), pn5180Chip.commands(0x16)};
+    return c;
+}
+
+static void report(const char *name, int rounds, const RfCost &c)
+{
+    printf("%-38s %3d rounds: %3u LOAD_RF_CONFIG, %3u RF_OFF, %3u RF_ON\n", name, rounds, c.loads, c.rfOff, c.rfOn);
+}
+
+int main()
+{
+    PN5180ISO14443 iso14443(PN5180_CHIP_NSS, PN5180_CHIP_BUSY, PN5180_CHIP_RST);
+    PN5180ISO15693 iso15693(PN5180_CHIP_NSS, PN5180_CHIP_BUSY, PN5180_CHIP_RST);
+    PN5180Poller poller(iso14443, iso15693);
+    PN5180PollResult result;
+
+    pn5180Chip.attach(&field);
+    try
+    {
+        iso14443.begin();
+        iso14443.reset();
+
+        // RF_ON twice: the second one gets no TX_RFON_IRQ and must give up
+        pn5180Chip.setTimeLimit(100000000000ULL);
+        CHECK(iso14443.setupRF(), "setupRF() from a field that is off failed");
+        uint64_t t0 = pn5180Chip.nowNs();
+        CHECK(!iso14443.setRF_on(), "setRF_on() on a field that is on reported success");
+        uint64_t waited = (pn5180Chip.nowNs() - t0) / 1000000;
+        // plus the last IRQ_STATUS read, two SPI frames of at least 3 ms each
+        CHECK(waited <= PN5180_RF_TIMEOUT_MS + 6, "setRF_on() on a field that is on took %u ms",
+              (unsigned)waited);
+        printf("RF_ON on a field that is on: false after %u ms\n", (unsigned)waited);
+
+        // the field is still on from above: the first round must not hang in RF_ON
+        pn5180Chip.setTimeLimit(100000000000ULL);
+        pn5180Chip.clearCounters();
+        const int rounds = 100;
+        for (int i = 0; i < rounds; i++)
+        {
+            CHECK(!poller.poll(result), "empty field: round %d found a card", i);
+        }
+        RfCost empty = rfCost();
+        report("empty field, field left on before", rounds, empty);
+        for (int t = 0; t < PN5180_POLL_TECH_COUNT; t++)
+        {
+            CHECK(poller.stats((PN5180PollTech)t).attempts == (uint32_t)rounds,
+                  "empty field: technology %d tried %u times, want %d", t, poller.stats((PN5180PollTech)t).attempts,
+                  rounds);
+        }
+        CHECK(empty.loads <= (uint32_t)rounds + 1, "empty field: more than one LOAD_RF_CONFIG per round");
+        CHECK(empty.rfOn == empty.loads, "empty field: %u RF_ON for %u switches", empty.rfOn, empty.loads);
+
+        // one technology: its configuration stays loaded
+        pn5180Chip.setTimeLimit(100000000000ULL);
+        poller.enable(PN5180_POLL_ISO15693, false);
+        poller.poll(result);
+        pn5180Chip.clearCounters();
+        for (int i = 0; i < rounds; i++)
+        {
+            poller.poll(result);
+        }
+        RfCost one = rfCost();
+        report("ISO14443A only", rounds, one);
+        CHECK((0 == one.loads) && (0 == one.rfOff) && (0 == one.rfOn), "one technology reloaded its configuration");
+
+        // both cards: found in turn, each with its own UID
+        pn5180Chip.setTimeLimit(100000000000ULL);
+        poller.enable(PN5180_POLL_ISO15693, true);
+        poller.resetStats();
+        field.cardPresent = true;
+        field.labelPresent = true;
+        pn5180Chip.clearCounters();
+        int found[PN5180_POLL_TECH_COUNT] = {0, 0};
+        for (int i = 0; i < rounds; i++)
+        {
+            if (!poller.poll(result))
+            {
+                CHECK(false, "both cards: round %d found nothing", i);
+                continue;
+            }
+            found[result.tech]++;
+            if (PN5180_POLL_ISO14443A == result.tech)
+            {
+                CHECK((4 == result.iso14443.uidLength) && !memcmp(result.iso14443.uid, TwoCardField::cardUid, 4),
+                      "both cards: wrong ISO14443A UID in round %d", i);
+            }
+            else
+            {
+                CHECK(result.iso15693.value() == TwoCardField::labelUid, "both cards: wrong ISO15693 UID in round %d",
+                      i);
+            }
+        }
+        RfCost both = rfCost();
+        report("both cards", rounds, both);
+        CHECK((found[0] == rounds / 2) && (found[1] == rounds / 2), "both cards: found %d and %d times", found[0],
+              found[1]);
+        CHECK(both.loads <= (uint32_t)rounds, "both cards: more than one LOAD_RF_CONFIG per round");
+        for (int t = 0; t < PN5180_POLL_TECH_COUNT; t++)
+        {
+            const PN5180PollStats &s = poller.stats((PN5180PollTech)t);
+            printf("  %-10s found %3u, latency %u/%u/%u us min/avg/max\n",
+                   (PN5180_POLL_ISO14443A == t) ? "ISO14443A" : "ISO15693", s.found, s.latencyMinUs,
+                   s.found ? s.latencySumUs / s.found : 0, s.latencyMaxUs);
+        }
+    }
+    catch (PN5180Chip::Stuck &stuck)
+    {
+        printf("driver still waiting at %.3f s\n", stuck.ns * 1e-9);
+        failed = 1;
+    }
+
+    printf("%s\n", failed ? "FAILED" : "ok");
+    return failed;
+}
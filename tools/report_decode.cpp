@@ -0,0 +1,272 @@
+// NAME: report_decode.cpp
+//
+// DESC: Linux decoder for the binary report frames (include/ReportProtocol.h).
+//
+// Build: g++ -std=c++11 -O2 -Iinclude tools/report_decode.cpp -o report_decode
+// Usage: report_decode [device|file] [baud]
+//        reads stdin when no path is given; a tty is switched to raw mode
+//        at the given baud rate (default 9600).
+//
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <termios.h>
+#include "ReportProtocol.h"
+
+static uint32_t le32(const uint8_t *p)
+{
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static void printUid(const uint8_t *p)
+{
+    for (int i = REPORT_UID_LEN - 1; i >= 0; i--) // LSB first on the wire
+    {
+        printf("%02X", p[i]);
+    }
+}
+
+static void printHex(const uint8_t *p, size_t len)
+{
+    for (size_t i = 0; i < len; i++)
+    {
+        printf("%02X%s", p[i], (i + 1 < len) ? " " : "");
+    }
+}
+
+static const char *eventName(uint8_t type)
+{
+    switch (type)
+    {
+    case 1:
+        return "TAG_SEEN";
+    case 2:
+        return "READ_DONE";
+    case 3:
+        return "ERROR";
+    case 4:
+        return "SPI_DONE";
+    default:
+        return "?";
+    }
+}
+
+static const char *traceName(uint8_t event)
+{
+    static const char *names[] = {"?", "WRITE_REG", "WRITE_REG_OR", "WRITE_REG_AND", "READ_REG", "READ_EEPROM",
+                                  "SEND_DATA", "READ_DATA", "LOAD_RF_CONFIG", "RF_ON", "RF_OFF", "SPI_FRAME",
+                                  "ISO15693_CMD", "ISO15693_ERROR", "ISO15693_INVENTORY",
+                                  "ISO15693_READ_BLOCK", "ISO15693_WRITE_BLOCK"};
+    return (event < sizeof(names) / sizeof(names[0])) ? names[event] : "?";
+}
+
+// probe numbers of PN5180Profile.h: regions, then one per host command code from 6 on
+static void printProbe(uint8_t probe)
+{
+    static const char *regions[] = {"SPI_FRAME", "BUSY_WAIT", "RF_EXCHANGE", "ISO15693_CMD", "SEARCH_ALL",
+                                    "CALC_POINT"};
+    static const char *commands[] = {"WRITE_REGISTER", "WRITE_REGISTER_OR_MASK", "WRITE_REGISTER_AND_MASK", 0,
+                                     "READ_REGISTER", 0, 0, "READ_EEPROM", 0, "SEND_DATA", "READ_DATA",
+                                     "SWITCH_MODE", 0, 0, 0, 0, 0, "LOAD_RF_CONFIG", 0, 0, 0, 0, "RF_ON", "RF_OFF"};
+    const uint8_t nRegions = sizeof(regions) / sizeof(regions[0]);
+    if (probe < nRegions)
+    {
+        printf("%-24s", regions[probe]);
+        return;
+    }
+    uint8_t code = probe - nRegions;
+    if ((code < sizeof(commands) / sizeof(commands[0])) && commands[code])
+    {
+        printf("%-24s", commands[code]);
+    }
+    else
+    {
+        printf("COMMAND 0x%02X            ", code);
+    }
+}
+
+static void printFrame(const ReportDecoder &dec)
+{
+    const uint8_t *p = dec.payload();
+    uint16_t len = dec.length();
+
+    switch (dec.type())
+    {
+    case REPORT_INVENTORY:
+    {
+        uint8_t count = len ? (p[0] & ~REPORT_INVENTORY_MORE) : 0;
+        printf("INVENTORY count=%u%s", count, (len && (p[0] & REPORT_INVENTORY_MORE)) ? " (continued)" : "");
+        for (int i = 0; i < count && 1 + (i + 1) * REPORT_UID_LEN <= len; i++)
+        {
+            printf(" ");
+            printUid(p + 1 + i * REPORT_UID_LEN);
+        }
+        printf("\n");
+        break;
+    }
+    case REPORT_CAPTURE:
+    {
+        // records are listed by tools/pn5180_replay
+        uint32_t records = 0;
+        for (uint16_t i = 4; i + REPORT_CAPTURE_HEADER_LEN <= len; records++)
+        {
+            i += REPORT_CAPTURE_HEADER_LEN + (p[i + 1] | (p[i + 2] << 8));
+        }
+        printf("CAPTURE dropped=%u records=%u\n", (len >= 4) ? le32(p) : 0, records);
+        break;
+    }
+    case REPORT_PROFILE:
+    {
+        if (len < REPORT_PROFILE_HEADER_LEN)
+        {
+            printf("PROFILE (short)\n");
+            break;
+        }
+        double tpu = (p[1] | (p[2] << 8)) ? (double)(p[1] | (p[2] << 8)) : 1.0;
+        uint32_t count = le32(p + 3);
+        uint64_t sum = le32(p + 15) | ((uint64_t)le32(p + 19) << 32);
+        printf("PROFILE ");
+        printProbe(p[0]);
+        printf(" n=%-8u min=%.1fus avg=%.1fus max=%.1fus\n", count, le32(p + 7) / tpu,
+               count ? sum / tpu / count : 0.0, le32(p + 11) / tpu);
+        uint8_t buckets = p[23];
+        for (int b = 0; b < buckets && REPORT_PROFILE_HEADER_LEN + 2 * (b + 1) <= len; b++)
+        {
+            uint16_t n = p[24 + 2 * b] | (p[25 + 2 * b] << 8);
+            if (n)
+            {
+                bool last = (b == buckets - 1);
+                printf("  %s%6uus %u\n", last ? ">=" : "< ", last ? (1u << b) : (2u << b), n);
+            }
+        }
+        break;
+    }
+    case REPORT_BLOCK:
+        if (len < REPORT_UID_LEN + 1)
+        {
+            printf("BLOCK (short frame)\n");
+            break;
+        }
+        printf("BLOCK uid=");
+        printUid(p);
+        printf(" block=%u data=", p[REPORT_UID_LEN]);
+        printHex(p + REPORT_UID_LEN + 1, len - REPORT_UID_LEN - 1);
+        printf("\n");
+        break;
+    case REPORT_EVENT:
+        if (len < REPORT_EVENT_LEN)
+        {
+            printf("EVENT (short frame)\n");
+            break;
+        }
+        printf("EVENT t=%uus %s code=0x%02X value=%u uid=", le32(p), eventName(p[4]), p[5], le32(p + 6));
+        printUid(p + 10);
+        printf("\n");
+        break;
+    case REPORT_RAW:
+        printf("RAW len=%u: ", len);
+        printHex(p, len);
+        printf("\n");
+        break;
+    case REPORT_TEXT:
+        printf("TEXT %.*s\n", (int)len, (const char *)p);
+        break;
+    case REPORT_TRACE:
+    {
+        uint8_t count = (len >= 5) ? p[0] : 0;
+        printf("TRACE count=%u overflows=%u\n", count, (len >= 5) ? le32(p + 1) : 0);
+        for (int i = 0; i < count && 5 + (i + 1) * REPORT_TRACE_RECORD_LEN <= len; i++)
+        {
+            const uint8_t *r = p + 5 + i * REPORT_TRACE_RECORD_LEN;
+            printf("  t=%uus %-20s arg=0x%02X len=%u value=0x%08X\n", le32(r), traceName(r[4]), r[5],
+                   r[6] | (r[7] << 8), le32(r + 8));
+        }
+        break;
+    }
+    default:
+        printf("TYPE 0x%02X len=%u: ", dec.type(), len);
+        printHex(p, len);
+        printf("\n");
+        break;
+    }
+}
+
+static speed_t baudFlag(long baud)
+{
+    switch (baud)
+    {
+    case 9600:
+        return B9600;
+    case 19200:
+        return B19200;
+    case 38400:
+        return B38400;
+    case 57600:
+        return B57600;
+    case 115200:
+        return B115200;
+    case 230400:
+        return B230400;
+    case 460800:
+        return B460800;
+    case 921600:
+        return B921600;
+    default:
+        return B9600;
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    int fd = STDIN_FILENO;
+    if (argc > 1)
+    {
+        fd = open(argv[1], O_RDONLY | O_NOCTTY);
+        if (fd < 0)
+        {
+            perror(argv[1]);
+            return 1;
+        }
+        struct termios tio;
+        if (tcgetattr(fd, &tio) == 0)
+        {
+            cfmakeraw(&tio);
+            speed_t speed = baudFlag(argc > 2 ? atol(argv[2]) : 9600);
+            cfsetispeed(&tio, speed);
+            cfsetospeed(&tio, speed);
+            tcsetattr(fd, TCSANOW, &tio);
+        }
+    }
+
+    static ReportDecoder dec;
+    uint8_t buf[256];
+    uint32_t frames = 0;
+    ssize_t n;
+    while ((n = read(fd, buf, sizeof(buf))) > 0)
+    {
+        for (ssize_t i = 0; i < n; i++)
+        {
+            if (dec.feed(buf[i]))
+            {
+                do
+                {
+                    printFrame(dec);
+                    frames++;
+                } while (dec.next());
+                fflush(stdout);
+            }
+        }
+    }
+
+    while (dec.finish())
+    {
+        printFrame(dec);
+        frames++;
+    }
+
+    fprintf(stderr, "%u frames, %u CRC errors, %u oversized, %u bytes skipped\n", frames, dec.crcErrors(),
+            dec.oversized(), dec.skippedBytes());
+    return 0;
+}
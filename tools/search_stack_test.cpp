@@ -0,0 +1,231 @@
+// NAME: search_stack_test.cpp
+//
+// DESC: Host check for SearchStack and SearchNode (include/MyStd.h): runs
+//       the traversal of PN5180ISO15693::search_all() against a modelled
+//       field, including the fields that drive the stack to its 64-entry
+//       worst case, and checks push/pop at capacity.
+//
+// Build: g++ -std=gnu++11 -O2 -DARDUINO -Itools/mock -Iinclude tools/search_stack_test.cpp -o search_stack_test
+// Usage: search_stack_test
+//        exit status 0 when every check passed
+//
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+#include "MyStd.h"
+
+static int failed = 0;
+
+#define CHECK(cond, ...)           \
+    do                             \
+    {                              \
+        if (!(cond))               \
+        {                          \
+            printf(__VA_ARGS__);   \
+            printf("\n");          \
+            failed = 1;            \
+        }                          \
+    } while (0)
+
+/*
+ * Tags in the field. A 1-slot inventory with a mask of length bits is
+ * answered by every unquieted tag whose low bits match: 0, 1 or a
+ * collision. With collideAll every query of fewer than 64 bits collides,
+ * as if the field held a tag below every branch.
+ */
+struct Field
+{
+    std::vector<uint64_t> tags;
+    bool collideAll;
+    uint32_t queries;
+
+    Field() : collideAll(false), queries(0) {}
+
+    uint8_t inventory(uint64_t mask, uint8_t length, Uid &uid)
+    {
+        queries++;
+        if (collideAll)
+        {
+            uid = Uid(mask);
+            return (length < ISO15693_UID_BITS) ? 2 : 1;
+        }
+        uint64_t bits = (length >= 64) ? ~0ULL : ((1ULL << length) - 1);
+        uint8_t found = 0;
+        for (size_t i = 0; i < tags.size(); i++)
+        {
+            if (((tags[i] ^ mask) & bits) == 0)
+            {
+                uid = Uid(tags[i]);
+                found++;
+            }
+        }
+        return (found > 1) ? 2 : found;
+    }
+
+    void quiet(const Uid &uid)
+    {
+        for (size_t i = 0; i < tags.size(); i++)
+        {
+            if (tags[i] == uid.value())
+            {
+                tags.erase(tags.begin() + i);
+                return;
+            }
+        }
+    }
+};
+
+struct SearchResult
+{
+    UidVec found;
+    int highWater;
+    uint32_t rejected;
+};
+
+// the loop of PN5180ISO15693::search_all(), search_once() answered by the field
+static void searchAll(Field &field, SearchResult &result, uint32_t maxQueries)
+{
+    SearchStack stack;
+    stack.push(SearchNode(0, 0, 0));
+    result.found.clear();
+    result.highWater = stack.size();
+    result.rejected = 0;
+
+    SearchNode tmp;
+    uint8_t ret;
+    Uid uid;
+
+    while (!stack.empty() && field.queries < maxQueries)
+    {
+        stack.pop(tmp);
+
+        uint8_t position = tmp.position();
+        uint64_t mask = tmp.mask;
+        if (tmp.bit())
+        {
+            mask |= ((uint64_t)1 << position);
+        }
+        else
+        {
+            mask &= ~((uint64_t)1 << position);
+        }
+
+        ret = field.inventory(mask, position + 1, uid);
+
+        if (tmp.bit() == 0)
+        {
+            result.rejected += !stack.push(SearchNode(mask, position, 1));
+        }
+
+        if (ret == 0)
+        {
+        }
+        else if (ret == 1)
+        {
+            result.found.insert(uid);
+            field.quiet(uid);
+        }
+        else if (position + 1 < ISO15693_UID_BITS)
+        {
+            result.rejected += !stack.push(SearchNode(mask, position + 1, 0));
+        }
+        if (stack.size() > result.highWater)
+        {
+            result.highWater = stack.size();
+        }
+    }
+}
+
+static void checkContainer()
+{
+    CHECK(sizeof(SearchNode) == 9, "SearchNode is %u bytes, want 9", (unsigned)sizeof(SearchNode));
+
+    SearchNode deepest(0x8000000000000001ULL, 63, 1);
+    CHECK(deepest.position() == 63 && deepest.bit() == 1 && deepest.mask == 0x8000000000000001ULL,
+          "SearchNode(63, 1) reads back as (%u, %u)", deepest.position(), deepest.bit());
+
+    SearchStack stack;
+    for (int i = 0; i < ISO15693_UID_BITS; i++)
+    {
+        CHECK(stack.push(SearchNode((uint64_t)1 << i, i, i & 1)), "push %d refused below capacity", i);
+    }
+    CHECK(stack.isFull() && stack.size() == ISO15693_UID_BITS, "full stack holds %d", stack.size());
+    CHECK(!stack.push(SearchNode(0, 0, 0)), "push on a full stack accepted");
+    CHECK(stack.size() == ISO15693_UID_BITS, "push on a full stack changed the size to %d", stack.size());
+
+    SearchNode node;
+    for (int i = ISO15693_UID_BITS - 1; i >= 0; i--)
+    {
+        CHECK(stack.pop(node) && node.position() == i && node.bit() == (i & 1) && node.mask == ((uint64_t)1 << i),
+              "pop %d returned position %u", i, node.position());
+    }
+    CHECK(stack.empty() && !stack.pop(node), "stack not empty after popping everything");
+}
+
+static void checkField(const char *name, Field &field, uint32_t maxQueries, int wantHighWater)
+{
+    std::vector<uint64_t> tags = field.tags;
+    SearchResult result;
+    searchAll(field, result, maxQueries);
+
+    CHECK(result.rejected == 0, "%s: %u pushes refused", name, result.rejected);
+    CHECK(result.highWater <= ISO15693_UID_BITS, "%s: stack reached %d", name, result.highWater);
+    CHECK(wantHighWater < 0 || result.highWater == wantHighWater, "%s: stack reached %d, want %d", name,
+          result.highWater, wantHighWater);
+    if (!field.collideAll)
+    {
+        CHECK(result.found.size() == (int)tags.size(), "%s: found %d of %u tags", name, result.found.size(),
+              (unsigned)tags.size());
+        for (size_t i = 0; i < tags.size(); i++)
+        {
+            CHECK(result.found.contains(Uid(tags[i])), "%s: tag %u not found", name, (unsigned)i);
+        }
+    }
+    printf("%-34s %5u queries, stack high water %2d/%d\n", name, field.queries, result.highWater,
+           ISO15693_UID_BITS);
+}
+
+int main()
+{
+    checkContainer();
+
+    // a collision at every prefix: the depth-first walk reaches bit 63
+    Field everyBranch;
+    everyBranch.collideAll = true;
+    checkField("collision below every branch", everyBranch, 4096, ISO15693_UID_BITS);
+
+    // two tags that differ only in the last bit: every 0 in the shared
+    // 63-bit prefix leaves its 1-sibling on the stack, so all zeros is worst
+    Field lastBit;
+    lastBit.tags.push_back(0x0000000000000000ULL);
+    lastBit.tags.push_back(0x8000000000000000ULL);
+    checkField("two tags, last bit differs", lastBit, 1u << 20, ISO15693_UID_BITS);
+
+    Field single;
+    single.tags.push_back(0xE004010203040506ULL);
+    checkField("one tag", single, 1u << 20, 1);
+
+    Field empty;
+    checkField("empty field", empty, 1u << 20, 1);
+
+    // a full UidVec of tags from one manufacturer
+    Field full;
+    srand(1);
+    while (full.tags.size() < UIDVEC_CAPACITY)
+    {
+        uint64_t tag = 0xE004000000000000ULL | (((uint64_t)rand() << 16) ^ (uint64_t)rand());
+        bool duplicate = false;
+        for (size_t i = 0; i < full.tags.size(); i++)
+        {
+            duplicate |= (full.tags[i] == tag);
+        }
+        if (!duplicate)
+        {
+            full.tags.push_back(tag);
+        }
+    }
+    checkField("100 tags, one manufacturer", full, 1u << 20, -1);
+
+    printf("%s\n", failed ? "FAILED" : "ok");
+    return failed;
+}
@@ -0,0 +1,183 @@
+// NAME: uidset_bench.cpp
+//
+// DESC: Host check and benchmark for UidHashSet (include/MyStd.h) against
+//       the heap-allocated, linear-scan UidVec it replaced, filling both
+//       the way search_all does: every UID reported more than once.
+//
+// Build: g++ -std=gnu++11 -O2 -DARDUINO -Itools/mock -Iinclude tools/uidset_bench.cpp -o uidset_bench
+// Usage: uidset_bench [iterations]
+//
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "MyStd.h"
+
+// the former UidVec: 100 int64_t on the heap, contains() scans them all
+class LinearUidVec
+{
+public:
+    LinearUidVec()
+    {
+        data_ = new int64_t[100];
+        memset(data_, 0, sizeof(int64_t) * 100);
+        cnt_ = 0;
+    }
+
+    ~LinearUidVec() { delete[] data_; }
+
+    LinearUidVec(const LinearUidVec &) = delete;
+    LinearUidVec &operator=(const LinearUidVec &) = delete;
+
+    int8_t size() const { return cnt_; }
+
+    bool contains(const int64_t &uid) const
+    {
+        for (int i = 0; i < cnt_; i++)
+        {
+            if (data_[i] - uid == 0)
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    bool insert(const int64_t &uid)
+    {
+        if (cnt_ >= 99)
+        {
+            return false;
+        }
+        if (contains(uid))
+        {
+            return false;
+        }
+        data_[cnt_++] = uid;
+        return true;
+    }
+
+    void clear()
+    {
+        memset(data_, 0, sizeof(int64_t) * 100);
+        cnt_ = 0;
+    }
+
+    const int64_t &operator[](const int &index) const { return data_[index]; }
+
+private:
+    int64_t *data_;
+    int8_t cnt_;
+};
+
+#define BENCH_UIDS 99
+
+static double now()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// ISO15693 UIDs: E0, manufacturer, then random serial bits
+static void makeUids(uint64_t *uids, int n)
+{
+    srand(1);
+    for (int i = 0; i < n; i++)
+    {
+        uint64_t serial = ((uint64_t)rand() << 31) ^ (uint64_t)rand();
+        uids[i] = 0xE004000000000000ULL | (serial & 0x0000FFFFFFFFFFFFULL);
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    static uint64_t uids[BENCH_UIDS];
+    makeUids(uids, BENCH_UIDS);
+
+    static UidVec set;
+    static LinearUidVec vec;
+    int failed = 0;
+
+    // same answers, same discovery order
+    for (int pass = 0; pass < 2; pass++)
+    {
+        for (int i = 0; i < BENCH_UIDS; i++)
+        {
+            bool a = set.insert(Uid(uids[i]));
+            bool b = vec.insert((int64_t)uids[i]);
+            if (a != b || a != (pass == 0))
+            {
+                printf("pass %d, uid %d: hash set %d, linear %d\n", pass, i, a, b);
+                failed = 1;
+            }
+        }
+    }
+    for (int i = 0; i < BENCH_UIDS; i++)
+    {
+        if (set[i].value() != (uint64_t)vec[i] || !set.contains(Uid(uids[i])))
+        {
+            printf("uid %d differs\n", i);
+            failed = 1;
+        }
+    }
+    if (set.size() != vec.size() || set.contains(Uid(0xE004000000000000ULL)))
+    {
+        printf("size %d, want %d\n", set.size(), vec.size());
+        failed = 1;
+    }
+
+    // the hash set holds its full capacity, then refuses
+    set.clear();
+    for (int i = 0; i < UIDVEC_CAPACITY; i++)
+    {
+        if (!set.insert(Uid(0xE004000000000000ULL + i)))
+        {
+            printf("insert %d refused below capacity\n", i);
+            failed = 1;
+        }
+    }
+    if (set.insert(Uid(0xE0040000FFFFFFFFULL)) || set.size() != UIDVEC_CAPACITY)
+    {
+        printf("insert beyond capacity accepted\n");
+        failed = 1;
+    }
+    if (failed)
+    {
+        return 1;
+    }
+
+    // one search_all: every UID found twice
+    long iterations = argc > 1 ? atol(argv[1]) : 100000;
+    volatile int sink = 0;
+    double t0 = now();
+    for (long n = 0; n < iterations; n++)
+    {
+        set.clear();
+        for (int pass = 0; pass < 2; pass++)
+        {
+            for (int i = 0; i < BENCH_UIDS; i++)
+            {
+                sink += set.insert(Uid(uids[i]));
+            }
+        }
+    }
+    double t1 = now();
+    for (long n = 0; n < iterations; n++)
+    {
+        vec.clear();
+        for (int pass = 0; pass < 2; pass++)
+        {
+            for (int i = 0; i < BENCH_UIDS; i++)
+            {
+                sink += vec.insert((int64_t)uids[i]);
+            }
+        }
+    }
+    double t2 = now();
+
+    printf("%d UIDs: same results and order, capacity %d enforced\n", BENCH_UIDS, UIDVEC_CAPACITY);
+    printf("fill with duplicates: hash set %.2f us, linear %.2f us; %u static bytes against %u + 800 heap\n",
+           (t1 - t0) * 1e6 / iterations, (t2 - t1) * 1e6 / iterations, (unsigned)sizeof(UidVec),
+           (unsigned)sizeof(LinearUidVec));
+    return 0;
+}